@@ -0,0 +1,675 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Persistent cache of extracted payloads and what we learned about
+ * the files in them.
+ *
+ * Entries live under ri->analysis_cache and are named after the
+ * SHA-256 header digest of the package, e.g. ab/abcdef.../ (with a -s
+ * suffix for payloads unpacked with --stream, which are not complete).
+ * Each entry holds:
+ *
+ *     tree/        the extracted payload
+ *     files.json   the rpmfile_t for the payload, including the
+ *                  checksums and MIME types computed so far
+ *     size         the size of the payload in bytes
+ *
+ * When extract_rpm() is handed a package that is in the cache, the
+ * tree is linked in to the working directory and the file list is
+ * read back, so the payload is neither decompressed nor analyzed
+ * again.  Entries are created under a unique temporary name (ending
+ * in .tmp.XXXXXX) and renamed in to place, and files.json is replaced
+ * the same way, so several runs and threads may share the cache.  An
+ * entry written by a different version of the cache format is
+ * ignored.
+ *
+ * Each hit updates the modification time of the entry directory so
+ * prune_analysis_cache() can remove the least recently used entries
+ * first once the cache is larger than ri->analysis_cache_size.  It
+ * adds up the recorded sizes rather than walking every entry.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <rpm/header.h>
+#include <json.h>
+
+#include "rpminspect.h"
+
+static const mode_t dirmode = S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH;
+
+/* An entry in the cache, used while pruning */
+struct cached_entry {
+    char *path;
+    struct timespec mtime;
+    unsigned long long size;
+};
+
+/*
+ * Returns the cache entry directory for the package or NULL if the
+ * cache is disabled or the package has no header digest.
+ */
+static char *entry_path(const struct rpminspect *ri, Header hdr)
+{
+    const char *digest = NULL;
+    char *ret = NULL;
+
+    assert(ri != NULL);
+
+    if (ri->analysis_cache == NULL || hdr == NULL) {
+        return NULL;
+    }
+
+    if ((digest = headerGetString(hdr, RPMTAG_SHA256HEADER)) == NULL &&
+        (digest = headerGetString(hdr, RPMTAG_SHA1HEADER)) == NULL) {
+        return NULL;
+    }
+
+    xasprintf(&ret, "%s/%.2s/%s%s", ri->analysis_cache, digest, digest, ri->stream_payloads ? "-s" : "");
+    return ret;
+}
+
+/*
+ * Recreate one payload file from the src tree at dst.  Directories
+ * and symlinks are made fresh, regular files are linked.
+ */
+static bool link_entry(const rpmfile_entry_t *file, const char *src, const char *dst)
+{
+    char target[PATH_MAX + 1];
+    char *dir = NULL;
+    ssize_t len;
+    int r;
+
+    if (S_ISDIR(file->st.st_mode)) {
+        return mkdirp((char *) dst, dirmode) == 0;
+    }
+
+    /* the payload does not always list parent directories first */
+    dir = strdup(dst);
+    assert(dir != NULL);
+    r = mkdirp(dirname(dir), dirmode);
+    free(dir);
+
+    if (r != 0) {
+        return false;
+    }
+
+    if (S_ISLNK(file->st.st_mode)) {
+        if ((len = readlink(src, target, PATH_MAX)) == -1) {
+            return false;
+        }
+
+        target[len] = '\0';
+        return symlink(target, dst) == 0;
+    }
+
+    return linkfile(src, dst) == 0;
+}
+
+static void add_int(struct json_object *obj, const char *key, int64_t value)
+{
+    json_object_object_add(obj, key, json_object_new_int64(value));
+}
+
+static int64_t get_int(struct json_object *obj, const char *key)
+{
+    struct json_object *value = NULL;
+
+    if (!json_object_object_get_ex(obj, key, &value)) {
+        return 0;
+    }
+
+    return json_object_get_int64(value);
+}
+
+static const char *get_string(struct json_object *obj, const char *key)
+{
+    struct json_object *value = NULL;
+
+    if (!json_object_object_get_ex(obj, key, &value)) {
+        return NULL;
+    }
+
+    return json_object_get_string(value);
+}
+
+/*
+ * Create an empty file with a unique name for replacing path and
+ * return its name, or NULL on failure.
+ */
+static char *make_tmpfile(const char *path)
+{
+    char *tmp = NULL;
+    int fd;
+
+    xasprintf(&tmp, "%s.XXXXXX", path);
+
+    if ((fd = mkstemp(tmp)) == -1) {
+        free(tmp);
+        return NULL;
+    }
+
+    fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    close(fd);
+    return tmp;
+}
+
+/* Write files.json for the file list in to the entry directory */
+static bool write_files(const char *entry, const rpmfile_t *files)
+{
+    struct json_object *top = NULL;
+    struct json_object *array = NULL;
+    struct json_object *obj = NULL;
+    rpmfile_entry_t *file = NULL;
+    char *path = NULL;
+    char *tmp = NULL;
+    bool ret = true;
+
+    top = json_object_new_object();
+    add_int(top, "version", ANALYSIS_CACHE_VERSION);
+    array = json_object_new_array();
+
+    TAILQ_FOREACH(file, files, items) {
+        obj = json_object_new_object();
+        json_object_object_add(obj, "path", json_object_new_string(file->localpath));
+        json_object_object_add(obj, "extracted", json_object_new_boolean(file->fullpath != NULL));
+        add_int(obj, "idx", file->idx);
+        add_int(obj, "dev", file->st.st_dev);
+        add_int(obj, "ino", file->st.st_ino);
+        add_int(obj, "mode", file->st.st_mode);
+        add_int(obj, "nlink", file->st.st_nlink);
+        add_int(obj, "uid", file->st.st_uid);
+        add_int(obj, "gid", file->st.st_gid);
+        add_int(obj, "rdev", file->st.st_rdev);
+        add_int(obj, "size", file->st.st_size);
+        add_int(obj, "atime", file->st.st_atime);
+        add_int(obj, "mtime", file->st.st_mtime);
+        add_int(obj, "ctime", file->st.st_ctime);
+
+        /* fields filled in by the inspections are read under the file lock */
+        lock_file_entry(file);
+
+        if (file->checksum) {
+            json_object_object_add(obj, "checksum", json_object_new_string(file->checksum));
+        }
+
+        if (file->type_id) {
+            json_object_object_add(obj, "type", json_object_new_string(intern_string(file->type_id)));
+        }
+
+        unlock_file_entry(file);
+        json_object_array_add(array, obj);
+    }
+
+    json_object_object_add(top, "files", array);
+
+    xasprintf(&path, "%s/files.json", entry);
+
+    if ((tmp = make_tmpfile(path)) == NULL ||
+        json_object_to_file_ext(tmp, top, JSON_C_TO_STRING_PLAIN) != 0 || rename(tmp, path) != 0) {
+        DEBUG_PRINT("unable to write %s\n", path);
+
+        if (tmp != NULL) {
+            unlink(tmp);
+        }
+
+        ret = false;
+    }
+
+    json_object_put(top);
+    free(tmp);
+    free(path);
+    return ret;
+}
+
+/* Returns the bytes of payload data in the file list */
+static unsigned long long payload_size(const rpmfile_t *files)
+{
+    rpmfile_entry_t *file = NULL;
+    unsigned long long size = 0;
+
+    TAILQ_FOREACH(file, files, items) {
+        if (file->fullpath != NULL && S_ISREG(file->st.st_mode)) {
+            size += file->st.st_size;
+        }
+    }
+
+    return size;
+}
+
+/* Record the size of the entry's payload in the entry directory */
+static bool write_size(const char *entry, unsigned long long size)
+{
+    FILE *fp = NULL;
+    char *path = NULL;
+    char *tmp = NULL;
+    bool ret = false;
+
+    xasprintf(&path, "%s/size", entry);
+
+    if ((tmp = make_tmpfile(path)) != NULL && (fp = fopen(tmp, "w")) != NULL) {
+        ret = (fprintf(fp, "%llu\n", size) > 0);
+        ret = (fclose(fp) == 0) && ret && (rename(tmp, path) == 0);
+    }
+
+    if (!ret && tmp != NULL) {
+        DEBUG_PRINT("unable to write %s\n", path);
+        unlink(tmp);
+    }
+
+    free(tmp);
+    free(path);
+    return ret;
+}
+
+/*
+ * Read files.json from the entry directory.  Returns NULL if there is
+ * no usable entry.
+ */
+static rpmfile_t *read_files(const char *entry, Header hdr, const char *output_dir)
+{
+    struct json_object *top = NULL;
+    struct json_object *array = NULL;
+    struct json_object *obj = NULL;
+    struct json_object *value = NULL;
+    rpmfile_t *files = NULL;
+    rpmfile_entry_t *file = NULL;
+    const char *s = NULL;
+    char *path = NULL;
+    size_t i;
+
+    xasprintf(&path, "%s/files.json", entry);
+    top = json_object_from_file(path);
+    free(path);
+
+    if (top == NULL) {
+        return NULL;
+    }
+
+    if (get_int(top, "version") != ANALYSIS_CACHE_VERSION || !json_object_object_get_ex(top, "files", &array)) {
+        json_object_put(top);
+        return NULL;
+    }
+
+    files = new_files();
+
+    for (i = 0; i < json_object_array_length(array); i++) {
+        obj = json_object_array_get_idx(array, i);
+
+        if ((s = get_string(obj, "path")) == NULL) {
+            free_files(files);
+            json_object_put(top);
+            return NULL;
+        }
+
+        file = new_file_entry(files);
+        file->rpm_header = hdr;
+        file->localpath = arena_strdup(files->arena, s);
+        file->idx = get_int(obj, "idx");
+        file->st.st_dev = get_int(obj, "dev");
+        file->st.st_ino = get_int(obj, "ino");
+        file->st.st_mode = get_int(obj, "mode");
+        file->st.st_nlink = get_int(obj, "nlink");
+        file->st.st_uid = get_int(obj, "uid");
+        file->st.st_gid = get_int(obj, "gid");
+        file->st.st_rdev = get_int(obj, "rdev");
+        file->st.st_size = get_int(obj, "size");
+        file->st.st_atime = get_int(obj, "atime");
+        file->st.st_mtime = get_int(obj, "mtime");
+        file->st.st_ctime = get_int(obj, "ctime");
+
+        if (json_object_object_get_ex(obj, "extracted", &value) && json_object_get_boolean(value)) {
+            file->fullpath = arena_printf(files->arena, "%s/%s", output_dir, file->localpath);
+        }
+
+        if ((s = get_string(obj, "checksum")) != NULL) {
+            file->checksum = strdup(s);
+        }
+
+        if ((s = get_string(obj, "type")) != NULL) {
+            file->type_id = intern_id(s);
+        }
+
+        TAILQ_INSERT_TAIL(files, file, items);
+    }
+
+    json_object_put(top);
+    return files;
+}
+
+/*
+ * If the payload of the package is in the analysis cache, recreate it
+ * in output_dir and return its file list.  Returns NULL if the cache
+ * is disabled, the package is not cached or something went wrong, in
+ * which case the caller extracts the package as usual.
+ */
+rpmfile_t *load_analysis(const struct rpminspect *ri, Header hdr, const char *output_dir)
+{
+    char *entry = NULL;
+    char *src = NULL;
+    rpmfile_t *files = NULL;
+    rpmfile_entry_t *file = NULL;
+
+    assert(output_dir != NULL);
+
+    if ((entry = entry_path(ri, hdr)) == NULL) {
+        return NULL;
+    }
+
+    if ((files = read_files(entry, hdr, output_dir)) == NULL) {
+        free(entry);
+        return NULL;
+    }
+
+    if (mkdir(output_dir, dirmode) == -1) {
+        fprintf(stderr, _("*** Unable to create directory %s: %s\n"), output_dir, strerror(errno));
+        fflush(stderr);
+        free_files(files);
+        free(entry);
+        return NULL;
+    }
+
+    TAILQ_FOREACH(file, files, items) {
+        if (file->fullpath == NULL) {
+            continue;
+        }
+
+        xasprintf(&src, "%s/tree/%s", entry, file->localpath);
+
+        if (!link_entry(file, src, file->fullpath)) {
+            DEBUG_PRINT("unable to use cached %s: %s\n", src, strerror(errno));
+            free(src);
+            free_files(files);
+            rmtree(output_dir, true, false);
+            free(entry);
+            return NULL;
+        }
+
+        free(src);
+    }
+
+    DEBUG_PRINT("using cached analysis %s for %s\n", entry, output_dir);
+
+    /* most recently used */
+    utimensat(AT_FDCWD, entry, NULL, 0);
+    free(entry);
+    return files;
+}
+
+/*
+ * Add a freshly extracted payload to the analysis cache.  Failing to
+ * cache a payload is not an error.
+ */
+void store_analysis(const struct rpminspect *ri, Header hdr, const rpmfile_t *files)
+{
+    char *entry = NULL;
+    char *tmp = NULL;
+    char *dst = NULL;
+    rpmfile_entry_t *file = NULL;
+    bool ok = true;
+
+    if (files == NULL || (entry = entry_path(ri, hdr)) == NULL) {
+        return;
+    }
+
+    if (access(entry, F_OK) == 0) {
+        free(entry);
+        return;
+    }
+
+    /*
+     * Build the entry under a temporary name of its own, the same
+     * package may be stored by another thread or run at the same time.
+     */
+    dst = strdup(entry);
+    assert(dst != NULL);
+    ok = (mkdirp(dirname(dst), dirmode) == 0);
+    free(dst);
+    xasprintf(&tmp, "%s.tmp.XXXXXX", entry);
+
+    if (!ok || mkdtemp(tmp) == NULL) {
+        DEBUG_PRINT("unable to cache analysis for %s: %s\n", entry, strerror(errno));
+        free(tmp);
+        free(entry);
+        return;
+    }
+
+    chmod(tmp, dirmode);
+    xasprintf(&dst, "%s/tree", tmp);
+    ok = (mkdir(dst, dirmode) == 0);
+    free(dst);
+
+    TAILQ_FOREACH(file, files, items) {
+        if (!ok) {
+            break;
+        }
+
+        if (file->fullpath == NULL) {
+            continue;
+        }
+
+        xasprintf(&dst, "%s/tree/%s", tmp, file->localpath);
+        ok = link_entry(file, file->fullpath, dst);
+        free(dst);
+    }
+
+    if (ok) {
+        ok = write_files(tmp, files) && write_size(tmp, payload_size(files));
+    }
+
+    if (!ok || rename(tmp, entry) != 0) {
+        DEBUG_PRINT("unable to cache analysis for %s: %s\n", entry, strerror(errno));
+        rmtree(tmp, true, false);
+    }
+
+    free(tmp);
+    free(entry);
+    return;
+}
+
+/*
+ * Return the payload size recorded for a cache entry.  Entries made
+ * before sizes were recorded get theirs from files.json, once.
+ */
+static unsigned long long entry_size(const char *entry)
+{
+    FILE *fp = NULL;
+    char *path = NULL;
+    rpmfile_t *files = NULL;
+    unsigned long long size = 0;
+
+    xasprintf(&path, "%s/size", entry);
+    fp = fopen(path, "r");
+    free(path);
+
+    if (fp != NULL) {
+        if (fscanf(fp, "%llu", &size) != 1) {
+            size = 0;
+        }
+
+        fclose(fp);
+        return size;
+    }
+
+    if ((files = read_files(entry, NULL, entry)) != NULL) {
+        size = payload_size(files);
+        write_size(entry, size);
+        free_files(files);
+    }
+
+    return size;
+}
+
+
+static int cmp_mtime(const void *a, const void *b)
+{
+    const struct cached_entry *x = a;
+    const struct cached_entry *y = b;
+
+    if (x->mtime.tv_sec != y->mtime.tv_sec) {
+        return (x->mtime.tv_sec < y->mtime.tv_sec) ? -1 : 1;
+    } else if (x->mtime.tv_nsec != y->mtime.tv_nsec) {
+        return (x->mtime.tv_nsec < y->mtime.tv_nsec) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Remove the least recently used entries from the analysis cache
+ * until it is no larger than ri->analysis_cache_size.  Entries still
+ * being written by another run are left alone, unless they are old
+ * enough to have been left behind by a run that died.
+ */
+static void prune_analysis_cache(const struct rpminspect *ri)
+{
+    DIR *top = NULL;
+    DIR *sub = NULL;
+    struct dirent *de = NULL;
+    struct dirent *se = NULL;
+    struct stat sb;
+    struct cached_entry *entries = NULL;
+    size_t nentries = 0;
+    size_t alloc = 0;
+    size_t i;
+    unsigned long long total = 0;
+    char *dir = NULL;
+    char *path = NULL;
+
+    if ((top = opendir(ri->analysis_cache)) == NULL) {
+        return;
+    }
+
+    /* gather every cached entry */
+    while ((de = readdir(top)) != NULL) {
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+
+        xasprintf(&dir, "%s/%s", ri->analysis_cache, de->d_name);
+
+        if ((sub = opendir(dir)) == NULL) {
+            free(dir);
+            continue;
+        }
+
+        while ((se = readdir(sub)) != NULL) {
+            if (se->d_name[0] == '.') {
+                continue;
+            }
+
+            xasprintf(&path, "%s/%s", dir, se->d_name);
+
+            if (stat(path, &sb) != 0 || !S_ISDIR(sb.st_mode)) {
+                free(path);
+                continue;
+            }
+
+            /* a temporary entry from store_analysis() */
+            if (strstr(se->d_name, ".tmp.") != NULL) {
+                if (sb.st_mtime < time(NULL) - ANALYSIS_CACHE_TMP_AGE && rmtree(path, true, false) == 0) {
+                    DEBUG_PRINT("removed stale %s from the analysis cache\n", path);
+                }
+
+                free(path);
+                continue;
+            }
+
+            if (nentries == alloc) {
+                alloc = (alloc == 0) ? 64 : alloc * 2;
+                entries = realloc(entries, alloc * sizeof(*entries));
+                assert(entries != NULL);
+            }
+
+            entries[nentries].path = path;
+            entries[nentries].mtime = sb.st_mtim;
+            entries[nentries].size = entry_size(path);
+            total += entries[nentries].size;
+            nentries++;
+        }
+
+        closedir(sub);
+        free(dir);
+    }
+
+    closedir(top);
+
+    /* oldest first */
+    if (total > ri->analysis_cache_size) {
+        qsort(entries, nentries, sizeof(*entries), cmp_mtime);
+    }
+
+    for (i = 0; i < nentries; i++) {
+        if (total > ri->analysis_cache_size && rmtree(entries[i].path, true, false) == 0) {
+            DEBUG_PRINT("pruned %s from the analysis cache\n", entries[i].path);
+            total -= entries[i].size;
+        }
+
+        free(entries[i].path);
+    }
+
+    free(entries);
+    return;
+}
+
+/*
+ * After the inspections have run, record the checksums and MIME types
+ * they computed so the next run does not compute them again.
+ */
+void save_analysis_cache(const struct rpminspect *ri)
+{
+    rpmpeer_entry_t *peer = NULL;
+    char *entry = NULL;
+
+    assert(ri != NULL);
+
+    if (ri->analysis_cache == NULL || ri->peers == NULL) {
+        return;
+    }
+
+    TAILQ_FOREACH(peer, ri->peers, items) {
+        if (peer->before_files && (entry = entry_path(ri, peer->before_hdr)) != NULL) {
+            if (access(entry, F_OK) == 0) {
+                write_files(entry, peer->before_files);
+            }
+
+            free(entry);
+        }
+
+        if (peer->after_files && (entry = entry_path(ri, peer->after_hdr)) != NULL) {
+            if (access(entry, F_OK) == 0) {
+                write_files(entry, peer->after_files);
+            }
+
+            free(entry);
+        }
+    }
+
+    prune_analysis_cache(ri);
+    return;
+}
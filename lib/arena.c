@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Arena allocator.  Memory is handed out from large blocks and is
+ * only given back all at once by arena_free().  This suits the many
+ * small strings that live exactly as long as the structure holding
+ * them, e.g. the keys of a hashmap_t.  An arena must not be used by
+ * more than one thread at a time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+
+#include "rpminspect.h"
+
+/* Every allocation is aligned for any type */
+#define ARENA_ALIGN 16
+
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+
+/* The block header is followed by size bytes of memory */
+struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+};
+
+#define BLOCK_DATA(b) ((unsigned char *) (b) + ALIGN_UP(sizeof(struct arena_block)))
+
+struct _arena_t {
+    struct arena_block *head;
+};
+
+arena_t *arena_new(void)
+{
+    arena_t *arena = NULL;
+
+    arena = calloc(1, sizeof(*arena));
+    assert(arena != NULL);
+    return arena;
+}
+
+/* Return size bytes of memory that live until arena_free() */
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    struct arena_block *block = NULL;
+    size_t bsize;
+    void *ret = NULL;
+
+    assert(arena != NULL);
+
+    size = ALIGN_UP(size);
+    block = arena->head;
+
+    if (block == NULL || (block->size - block->used) < size) {
+        /* big requests get a block of their own */
+        bsize = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+        block = malloc(ALIGN_UP(sizeof(*block)) + bsize);
+        assert(block != NULL);
+        block->size = bsize;
+        block->used = 0;
+
+        /* keep allocating from the block with the most room left */
+        if (arena->head != NULL && bsize == size) {
+            block->next = arena->head->next;
+            arena->head->next = block;
+        } else {
+            block->next = arena->head;
+            arena->head = block;
+        }
+    }
+
+    ret = BLOCK_DATA(block) + block->used;
+    block->used += size;
+    return ret;
+}
+
+char *arena_strdup(arena_t *arena, const char *s)
+{
+    size_t len;
+    char *ret = NULL;
+
+    assert(s != NULL);
+
+    len = strlen(s) + 1;
+    ret = arena_alloc(arena, len);
+    memcpy(ret, s, len);
+    return ret;
+}
+
+/* Like xasprintf(), but the string lives in the arena */
+char *arena_printf(arena_t *arena, const char *fmt, ...)
+{
+    va_list ap;
+    int len;
+    char *ret = NULL;
+
+    assert(fmt != NULL);
+
+    va_start(ap, fmt);
+    len = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    assert(len >= 0);
+
+    ret = arena_alloc(arena, len + 1);
+    va_start(ap, fmt);
+    vsnprintf(ret, len + 1, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+/* Bytes of memory the arena holds, including unused room in its blocks */
+size_t arena_size(const arena_t *arena)
+{
+    const struct arena_block *block = NULL;
+    size_t ret = 0;
+
+    if (arena == NULL) {
+        return 0;
+    }
+
+    for (block = arena->head; block != NULL; block = block->next) {
+        ret += ALIGN_UP(sizeof(*block)) + block->size;
+    }
+
+    return ret;
+}
+
+void arena_free(arena_t *arena)
+{
+    struct arena_block *block = NULL;
+
+    if (arena == NULL) {
+        return;
+    }
+
+    while (arena->head != NULL) {
+        block = arena->head;
+        arena->head = block->next;
+        free(block);
+    }
+
+    free(arena);
+    return;
+}
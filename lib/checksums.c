@@ -1,4 +1,4 @@
-/* Calculate an MD5, SHA-1, or SHA-256 checksum for a file. */
+/* Calculate MD5, SHA-1, SHA-256, and fast checksums for a file. */
 
 /* {{{ Apache License version 2.0
  */
@@ -22,39 +22,398 @@
 /* }}} */
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <endian.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <assert.h>
-#include <openssl/md5.h>
-#include <openssl/sha.h>
+#include <openssl/evp.h>
+#include <rpm/header.h>
+#include <rpm/rpmtd.h>
+#include <rpm/rpmpgp.h>
 
 #include "rpminspect.h"
 
 /*
- * Take in a file, return a checksum.
- * NOTE: The caller is responsible for freeing the string returned by
- *       this function.
+ * Files are fed to the digests this much at a time.  The slice is
+ * small enough to stay in cache while every requested digest runs
+ * over it.  Files that cannot be mapped are read in chunks this big.
  */
-char *compute_checksum(const char *filename, mode_t *st_mode, enum checksum type)
+#define CHECKSUM_CHUNK (1024 * 1024)
+
+/* FASTSUM is XXH64 with a seed of 0 */
+#define XXH_PRIME64_1 UINT64_C(0x9E3779B185EBCA87)
+#define XXH_PRIME64_2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define XXH_PRIME64_3 UINT64_C(0x165667B19E3779F9)
+#define XXH_PRIME64_4 UINT64_C(0x85EBCA77C2B2AE63)
+#define XXH_PRIME64_5 UINT64_C(0x27D4EB2F165667C5)
+
+struct xxh64_state {
+    uint64_t v[4];
+    uint64_t total;
+    unsigned char mem[32];
+    size_t memsize;
+};
+
+struct _checksum_ctx_t {
+    unsigned int types;
+    EVP_MD_CTX *md[NUM_CHECKSUMS];
+    struct xxh64_state xxh;
+};
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const unsigned char *p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return le64toh(v);
+}
+
+static inline uint32_t read32(const unsigned char *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return le32toh(v);
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh64_round(0, val);
+    return (acc * XXH_PRIME64_1) + XXH_PRIME64_4;
+}
+
+static void xxh64_init(struct xxh64_state *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->v[0] = XXH_PRIME64_1 + XXH_PRIME64_2;
+    s->v[1] = XXH_PRIME64_2;
+    s->v[2] = 0;
+    s->v[3] = -XXH_PRIME64_1;
+}
+
+static void xxh64_stripes(struct xxh64_state *s, const unsigned char *p)
+{
+    s->v[0] = xxh64_round(s->v[0], read64(p));
+    s->v[1] = xxh64_round(s->v[1], read64(p + 8));
+    s->v[2] = xxh64_round(s->v[2], read64(p + 16));
+    s->v[3] = xxh64_round(s->v[3], read64(p + 24));
+}
+
+static void xxh64_update(struct xxh64_state *s, const unsigned char *p, size_t len)
+{
+    const unsigned char *end = p + len;
+    size_t n;
+
+    s->total += len;
+
+    /* top up a partial stripe left from the last call */
+    if (s->memsize > 0) {
+        n = sizeof(s->mem) - s->memsize;
+
+        if (len < n) {
+            memcpy(s->mem + s->memsize, p, len);
+            s->memsize += len;
+            return;
+        }
+
+        memcpy(s->mem + s->memsize, p, n);
+        xxh64_stripes(s, s->mem);
+        p += n;
+        s->memsize = 0;
+    }
+
+    while ((size_t) (end - p) >= sizeof(s->mem)) {
+        xxh64_stripes(s, p);
+        p += sizeof(s->mem);
+    }
+
+    if (p < end) {
+        memcpy(s->mem, p, end - p);
+        s->memsize = end - p;
+    }
+}
+
+static uint64_t xxh64_final(const struct xxh64_state *s)
+{
+    const unsigned char *p = s->mem;
+    const unsigned char *end = s->mem + s->memsize;
+    uint64_t h;
+
+    if (s->total >= sizeof(s->mem)) {
+        h = rotl64(s->v[0], 1) + rotl64(s->v[1], 7) + rotl64(s->v[2], 12) + rotl64(s->v[3], 18);
+        h = xxh64_merge(h, s->v[0]);
+        h = xxh64_merge(h, s->v[1]);
+        h = xxh64_merge(h, s->v[2]);
+        h = xxh64_merge(h, s->v[3]);
+    } else {
+        h = XXH_PRIME64_5;
+    }
+
+    h += s->total;
+
+    while (p + 8 <= end) {
+        h ^= xxh64_round(0, read64(p));
+        h = (rotl64(h, 27) * XXH_PRIME64_1) + XXH_PRIME64_4;
+        p += 8;
+    }
+
+    if (p + 4 <= end) {
+        h ^= (uint64_t) read32(p) * XXH_PRIME64_1;
+        h = (rotl64(h, 23) * XXH_PRIME64_2) + XXH_PRIME64_3;
+        p += 4;
+    }
+
+    while (p < end) {
+        h ^= (*p) * XXH_PRIME64_5;
+        h = rotl64(h, 11) * XXH_PRIME64_1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static const EVP_MD *checksum_md(enum checksum type)
+{
+    switch (type) {
+        case MD5SUM:
+            return EVP_md5();
+        case SHA1SUM:
+            return EVP_sha1();
+        case SHA256SUM:
+            return EVP_sha256();
+        default:
+            return NULL;
+    }
+}
+
+static char *hexstring(const unsigned char *digest, unsigned int len)
+{
+    char *ret = NULL;
+    unsigned int i;
+
+    ret = calloc((len * 2) + 1, sizeof(char));
+    assert(ret != NULL);
+
+    for (i = 0; i < len; i++) {
+        sprintf(&ret[i * 2], "%02x", (unsigned int) digest[i]);
+    }
+
+    return ret;
+}
+
+/*
+ * Start computing the checksums selected in types, a mask built with
+ * CHECKSUM_MASK().  Feed the data through checksum_update() and get
+ * the results from checksum_end().  The digests go through OpenSSL's
+ * EVP interface so the fastest implementation for the CPU is used.
+ */
+checksum_ctx_t *checksum_begin(unsigned int types)
+{
+    checksum_ctx_t *ctx = NULL;
+    const EVP_MD *md = NULL;
+    int i;
+
+    ctx = calloc(1, sizeof(*ctx));
+    assert(ctx != NULL);
+    ctx->types = types;
+
+    for (i = 0; i < NUM_CHECKSUMS; i++) {
+        if (!(types & CHECKSUM_MASK(i)) || (md = checksum_md(i)) == NULL) {
+            continue;
+        }
+
+        ctx->md[i] = EVP_MD_CTX_new();
+        assert(ctx->md[i] != NULL);
+
+        if (EVP_DigestInit_ex(ctx->md[i], md, NULL) != 1) {
+            fprintf(stderr, _("*** Unable to initialize %s digest\n"), EVP_MD_name(md));
+            fflush(stderr);
+            abort();
+        }
+    }
+
+    if (types & CHECKSUM_MASK(FASTSUM)) {
+        xxh64_init(&ctx->xxh);
+    }
+
+    return ctx;
+}
+
+void checksum_update(checksum_ctx_t *ctx, const void *data, size_t len)
+{
+    int i;
+
+    assert(ctx != NULL);
+
+    for (i = 0; i < NUM_CHECKSUMS; i++) {
+        if (ctx->md[i] != NULL) {
+            EVP_DigestUpdate(ctx->md[i], data, len);
+        }
+    }
+
+    if (ctx->types & CHECKSUM_MASK(FASTSUM)) {
+        xxh64_update(&ctx->xxh, data, len);
+    }
+}
+
+/*
+ * Finish the checksums and free ctx.  Each requested checksum is
+ * stored as a hex string in sums[type], which must have room for
+ * NUM_CHECKSUMS entries.  Other entries are set to NULL.  The caller
+ * must free the strings.
+ */
+void checksum_end(checksum_ctx_t *ctx, char **sums)
+{
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned char fast[sizeof(uint64_t)];
+    unsigned int len = 0;
+    uint64_t h;
+    int i;
+
+    assert(ctx != NULL);
+    assert(sums != NULL);
+
+    for (i = 0; i < NUM_CHECKSUMS; i++) {
+        sums[i] = NULL;
+
+        if (ctx->md[i] == NULL) {
+            continue;
+        }
+
+        EVP_DigestFinal_ex(ctx->md[i], digest, &len);
+        EVP_MD_CTX_free(ctx->md[i]);
+        sums[i] = hexstring(digest, len);
+    }
+
+    /* written most significant byte first, like xxhsum(1) */
+    if (ctx->types & CHECKSUM_MASK(FASTSUM)) {
+        h = xxh64_final(&ctx->xxh);
+
+        for (i = sizeof(fast) - 1; i >= 0; i--) {
+            fast[i] = h & 0xff;
+            h >>= 8;
+        }
+
+        sums[FASTSUM] = hexstring(fast, sizeof(fast));
+    }
+
+    free(ctx);
+}
+
+/*
+ * Feed a file to ctx.  Regular files are mapped and handed over a
+ * slice at a time; anything that cannot be mapped is read in large
+ * chunks.  Either way the kernel is told the file is read front to
+ * back so it reads ahead aggressively.
+ */
+static bool checksum_fd(checksum_ctx_t *ctx, int fd, const char *filename)
+{
+    struct stat sb;
+    unsigned char *map = NULL;
+    void *buf = NULL;
+    ssize_t len;
+    off_t off;
+    size_t n;
+    bool ret = true;
+
+    (void) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0 && (uintmax_t) sb.st_size <= SIZE_MAX) {
+        map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (map != MAP_FAILED) {
+            (void) madvise(map, sb.st_size, MADV_SEQUENTIAL);
+
+            for (off = 0; off < sb.st_size; off += n) {
+                n = sb.st_size - off;
+
+                if (n > CHECKSUM_CHUNK) {
+                    n = CHECKSUM_CHUNK;
+                }
+
+                checksum_update(ctx, map + off, n);
+            }
+
+            munmap(map, sb.st_size);
+            return true;
+        }
+    }
+
+    if (posix_memalign(&buf, sysconf(_SC_PAGESIZE), CHECKSUM_CHUNK) != 0) {
+        fprintf(stderr, "%s (%d): %s\n", __func__, __LINE__, strerror(errno));
+        fflush(stderr);
+        return false;
+    }
+
+    while ((len = read(fd, buf, CHECKSUM_CHUNK)) != 0) {
+        if (len == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            fprintf(stderr, _("*** Error reading %s: %s\n"), filename, strerror(errno));
+            fflush(stderr);
+            ret = false;
+            break;
+        }
+
+        checksum_update(ctx, buf, len);
+    }
+
+    free(buf);
+    return ret;
+}
+
+/*
+ * Take in a file and compute every checksum selected in types with a
+ * single pass over the data.  The results are stored in sums as
+ * described for checksum_end().  Returns false if the file could not
+ * be read, in which case every entry in sums is NULL.
+ */
+bool compute_checksums(const char *filename, mode_t *st_mode, unsigned int types, char **sums)
 {
     struct stat sb;
     mode_t *mode = NULL;
-    unsigned char buf[BUFSIZ];
-    int input, len, i;
-    char *ret = NULL;
-    unsigned char digest[BUFSIZ];
-    MD5_CTX md5c;
-    SHA_CTX sha1c;
-    SHA256_CTX sha256c;
+    int input;
+    int i;
+    bool ok;
+    checksum_ctx_t *ctx = NULL;
+
+    assert(filename != NULL);
+    assert(sums != NULL);
+
+    for (i = 0; i < NUM_CHECKSUMS; i++) {
+        sums[i] = NULL;
+    }
 
     /* if the user did not provide a mode_t, get it */
     if (st_mode == NULL) {
         if (lstat(filename, &sb) != 0) {
-            return NULL;
+            return false;
         }
 
         mode = &sb.st_mode;
@@ -67,102 +426,174 @@ char *compute_checksum(const char *filename, mode_t *st_mode, enum checksum type
         S_ISFIFO(*mode) || S_ISSOCK(*mode)) {
         fprintf(stderr, _("*** Cannot calculate checksum on devices or fifos: %s\n"), filename);
         fflush(stderr);
-        return NULL;
+        return false;
     }
 
-    /*
-     * This holds all possible digest type computations.  if any future digest
-     * is larger than BUFSIZ, hopefully we update this and get faster systems.
-     */
-    memset(&buf, '\0', BUFSIZ);
-    memset(&digest, '\0', BUFSIZ);
+    /* read in the file to generate the requested checksums */
+    if ((input = open(filename, O_RDONLY | O_CLOEXEC)) == -1) {
+        fprintf(stderr, _("*** Unable to open %s: %s\n"), filename, strerror(errno));
+        fflush(stderr);
+        return false;
+    }
 
-    /* Initialize the correct context based on the checksum type. */
-    if (type == MD5SUM) {
-        MD5_Init(&md5c);
-    } else if (type == SHA1SUM) {
-        SHA1_Init(&sha1c);
-    } else if (type == SHA256SUM) {
-        SHA256_Init(&sha256c);
+    ctx = checksum_begin(types);
+    ok = checksum_fd(ctx, input, filename);
+    checksum_end(ctx, sums);
+    close(input);
+
+    if (!ok) {
+        for (i = 0; i < NUM_CHECKSUMS; i++) {
+            free(sums[i]);
+            sums[i] = NULL;
+        }
     }
 
-    /* read in the file to generate the requested checksum */
-    if ((input = open(filename, O_RDONLY)) == -1) {
-        fprintf(stderr, _("*** Unable to open %s: %s\n"), filename, strerror(errno));
-        fflush(stderr);
+    return ok;
+}
+
+/*
+ * Take in a file, return a checksum.
+ * NOTE: The caller is responsible for freeing the string returned by
+ *       this function.
+ */
+char *compute_checksum(const char *filename, mode_t *st_mode, enum checksum type)
+{
+    char *sums[NUM_CHECKSUMS];
+
+    if (type == NULLSUM || type >= NUM_CHECKSUMS) {
         return NULL;
     }
 
-    if ((len = read(input, buf, sizeof(buf))) == -1) {
-        fprintf(stderr, "%s (%d): %s\n", __func__, __LINE__, strerror(errno));
-        fflush(stderr);
+    if (!compute_checksums(filename, st_mode, CHECKSUM_MASK(type), sums)) {
         return NULL;
     }
 
-    while (len > 0) {
-        /* update the correct context based on the checksum type */
-        if (type == MD5SUM) {
-            MD5_Update(&md5c, buf, len);
-        } else if (type == SHA1SUM) {
-            SHA1_Update(&sha1c, buf, len);
-        } else if (type == SHA256SUM) {
-            SHA256_Update(&sha256c, buf, len);
-        }
+    return sums[type];
+}
 
-        if ((len = read(input, buf, sizeof(buf))) == -1) {
-            fprintf(stderr, "%s (%d): %s\n", __func__, __LINE__, strerror(errno));
-            fflush(stderr);
-            return NULL;
-        }
-    }
+/*
+ * Return the SHA-256 digest the package header records for this
+ * file, or NULL if there is none.  Older packages use MD5 file
+ * digests and those are not used.  The string belongs to the header.
+ */
+const char *get_header_digest(const rpmfile_entry_t *file)
+{
+    rpmtd td = NULL;
+    const char *ret = NULL;
 
-    if (close(input) == -1) {
-        fprintf(stderr, "%s (%d): %s\n", __func__, __LINE__, strerror(errno));
-        fflush(stderr);
+    assert(file != NULL);
+
+    if (file->rpm_header == NULL || file->idx < 0 ||
+        headerGetNumber(file->rpm_header, RPMTAG_FILEDIGESTALGO) != PGPHASHALGO_SHA256) {
         return NULL;
     }
 
-    /* finalize the correct context type and determine the loop length */
-    if (type == MD5SUM) {
-        MD5_Final(digest, &md5c);
-        len = MD5_DIGEST_LENGTH;
-    } else if (type == SHA1SUM) {
-        SHA1_Final(digest, &sha1c);
-        len = SHA_DIGEST_LENGTH;
-    } else if (type == SHA256SUM) {
-        SHA256_Final(digest, &sha256c);
-        len = SHA256_DIGEST_LENGTH;
+    td = rpmtdNew();
+    assert(td != NULL);
+
+    if (headerGet(file->rpm_header, RPMTAG_FILEDIGESTS, td, HEADERGET_MINMEM) == 1 &&
+        rpmtdSetIndex(td, file->idx) != -1) {
+        ret = rpmtdGetString(td);
     }
 
-    /* this is our human readable digest, caller must free */
-    if ((ret = calloc(len + 1, sizeof(char *))) == NULL) {
-        fprintf(stderr, "%s (%d): %s\n", __func__, __LINE__, strerror(errno));
+    rpmtdFree(td);
+
+    /* only regular files have a digest */
+    if (ret != NULL && *ret == '\0') {
+        ret = NULL;
+    }
+
+    return ret;
+}
+
+/*
+ * Report a file whose computed checksum does not match the digest in
+ * its package header.  Used when verify_digests is on.
+ */
+void check_header_digest(const rpmfile_entry_t *file, const char *sum)
+{
+    const char *digest = NULL;
+
+    assert(file != NULL);
+
+    if (sum == NULL || (digest = get_header_digest(file)) == NULL) {
+        return;
+    }
+
+    if (strcmp(digest, sum)) {
+        fprintf(stderr, _("*** %s does not match its header digest: %s != %s\n"), file->localpath, sum, digest);
         fflush(stderr);
-        return NULL;
     }
+}
 
-    for (i = 0; i < len; ++i) {
-        sprintf(&ret[i*2], "%02x", (unsigned int) digest[i]);
+/* Cache sum in the file entry unless another thread beat us to it */
+static char *cache_checksum(rpmfile_entry_t *file, char *sum)
+{
+    lock_file_entry(file);
+
+    if (file->checksum == NULL) {
+        file->checksum = sum;
+    } else {
+        free(sum);
     }
 
-    return ret;
+    sum = file->checksum;
+    unlock_file_entry(file);
+
+    return sum;
+}
+
+/*
+ * Return the SHA-256 checksum of a file if it is known without reading
+ * the file: either it was cached or the package header has it.  The
+ * header is not trusted when ri->verify_digests is set.  Returns NULL
+ * otherwise.  Same rules for the returned string as checksum().
+ */
+char *known_checksum(const struct rpminspect *ri, rpmfile_entry_t *file)
+{
+    char *sum = NULL;
+    const char *digest = NULL;
+
+    assert(ri != NULL);
+    assert(file != NULL);
+
+    lock_file_entry(file);
+    sum = file->checksum;
+    unlock_file_entry(file);
+
+    if (sum || ri->verify_digests || (digest = get_header_digest(file)) == NULL) {
+        return sum;
+    }
+
+    sum = strdup(digest);
+    assert(sum != NULL);
+    return cache_checksum(file, sum);
 }
 
 /*
  * Given an rpmfile_entry_t, returned either the cached checksum or
- * compute it, cache it, and return that.
+ * compute it, cache it, and return that.  The header digest is used
+ * when there is one, see known_checksum().
  *
  * The caller should not directly free this as it is freed with the
  * call to free_files()
  */
-char *checksum(rpmfile_entry_t *file)
+char *checksum(const struct rpminspect *ri, rpmfile_entry_t *file)
 {
+    char *sum = NULL;
+
+    assert(ri != NULL);
     assert(file != NULL);
 
-    if (file->checksum) {
-        return file->checksum;
+    if ((sum = known_checksum(ri, file)) != NULL) {
+        return sum;
+    }
+
+    sum = compute_checksum(file->fullpath, &file->st.st_mode, SHA256SUM);
+
+    if (ri->verify_digests) {
+        check_header_digest(file, sum);
     }
 
-    file->checksum = compute_checksum(file->fullpath, &file->st.st_mode, SHA256SUM);
-    return file->checksum;
+    return cache_checksum(file, sum);
 }
@@ -55,6 +55,55 @@
  */
 #define LICENSE_DB_FILE "generic.json"
 
+/* Size of each block of memory an arena_t hands out allocations from */
+#define ARENA_BLOCK_SIZE 65536
+
+/* Smallest number of slots in a hashmap_t, must be a power of 2 */
+#define HASHMAP_MIN_SIZE 16
+
+/*
+ * Default number of packages downloaded from Koji at the same time
+ * and the number of times a failed download is tried again.  Both can
+ * be changed in the configuration file.
+ */
+#define DOWNLOAD_JOBS 4
+#define DOWNLOAD_RETRIES 3
+
+/*
+ * Milliseconds to wait before the first retry of a failed download.
+ * The wait doubles for every further retry of the same file, up to
+ * DOWNLOAD_RETRY_MAX_DELAY.
+ */
+#define DOWNLOAD_RETRY_DELAY 500
+#define DOWNLOAD_RETRY_MAX_DELAY 30000
+
+/*
+ * Default size limit of the download cache in megabytes.  The least
+ * recently used packages are removed once the cache grows past it.
+ */
+#define DOWNLOAD_CACHE_SIZE 10240
+
+/*
+ * Format version of the analysis cache.  Bump this whenever the
+ * contents of files.json change meaning so old entries are ignored.
+ */
+#define ANALYSIS_CACHE_VERSION 1
+
+/*
+ * Default size limit of the analysis cache in megabytes.  The least
+ * recently used entries are removed once the cache grows past it.
+ */
+#define ANALYSIS_CACHE_SIZE 10240
+
+/*
+ * Seconds after which a partly written analysis cache entry is taken
+ * to be left over from a run that died and is removed.
+ */
+#define ANALYSIS_CACHE_TMP_AGE 86400
+
+/* Initial number of packages the RPM header cache index is sized for */
+#define HEADER_INDEX_SIZE 1024
+
 /*
  * Name of the [inspections] section in the config file.
  */
@@ -67,6 +116,7 @@
  */
 #define ABI_CHECKING_WHITELIST_DIR "abi-checking-whitelist"
 #define CAPABILITIES_DIR "capabilities"
+#define FORTIFY_DIR "fortify"
 #define LICENSES_DIR "licenses"
 #define STAT_WHITELIST_DIR "stat-whitelist"
 #define VERSION_WHITELIST_DIR "version-whitelist"
@@ -89,12 +139,18 @@
 #define ZCMP_CMD "zcmp"
 #define BZCMP_CMD "bzcmp"
 #define XZCMP_CMD "xzcmp"
-#define ELFCMP_CMD "eu-elfcmp --ignore-build-id --hash-inexact"
 #define MSGUNFMT_CMD "msgunfmt"
 #define DIFF_CMD "diff"
 #define DESKTOP_FILE_VALIDATE_CMD "desktop-file-validate"
 #define ANNOCHECK_CMD "annocheck"
 
+/*
+ * Default number of seconds an external command may run before it is
+ * killed.  Set with command_timeout in the [common] section of the
+ * configuration file, 0 disables the limit.
+ */
+#define CMD_TIMEOUT 3600
+
 /*
  * Architecture name of special RPMs (from Koji)
  */
@@ -122,6 +178,16 @@
  */
 #define SHELLS "sh ksh zsh csh tcsh rc bash"
 
+/*
+ * Streaming payload mode (-S).  Each file's first STREAM_SNIFF_BYTES
+ * are handed to libmagic.  Files with a MIME type starting with one of
+ * STREAM_OPAQUE_TYPES are not read by any inspection, so only their
+ * first STREAM_HEAD_BYTES are written out.
+ */
+#define STREAM_SNIFF_BYTES 1048576
+#define STREAM_HEAD_BYTES 8192
+#define STREAM_OPAQUE_TYPES "image/ audio/ video/ font/ application/octet-stream application/pdf application/vnd."
+
 /*
  * File extensions
  */
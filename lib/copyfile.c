@@ -29,6 +29,8 @@
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
 #include "rpminspect.h"
 
 int copyfile(const char *src, const char *dest, bool force, bool verbose) {
@@ -171,3 +173,42 @@ int copyfile(const char *src, const char *dest, bool force, bool verbose) {
 
     return success;
 }
+
+/*
+ * Make dst the same file as src.  A hard link costs nothing, a clone
+ * shares blocks on filesystems that support it, and a copy works
+ * everywhere else.
+ */
+int linkfile(const char *src, const char *dst)
+{
+    int in = -1;
+    int out = -1;
+    int ret = -1;
+
+    if (link(src, dst) == 0) {
+        return 0;
+    }
+
+    if (errno != EXDEV && errno != EPERM && errno != EMLINK) {
+        return -1;
+    }
+
+    if ((in = open(src, O_RDONLY | O_CLOEXEC)) != -1) {
+        if ((out = open(dst, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) != -1) {
+            ret = ioctl(out, FICLONE, in);
+            close(out);
+
+            if (ret != 0) {
+                unlink(dst);
+            }
+        }
+
+        close(in);
+    }
+
+    if (ret != 0) {
+        ret = copyfile(src, dst, true, false);
+    }
+
+    return ret;
+}
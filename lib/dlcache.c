@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Persistent cache of downloaded packages.
+ *
+ * Packages are stored under ri->download_cache by the SHA-256 of a
+ * key the caller builds from what identifies the package, such as the
+ * Koji build ID, the package file name, its size and payload hash.
+ * The cache is two levels deep, e.g. ab/abcdef....rpm, to keep the
+ * directories small.  A package found in the cache is hard linked in
+ * to the working directory, or cloned or copied if the cache is on a
+ * different filesystem.  Each hit updates the modification time of
+ * the cached package so prune_download_cache() can remove the least
+ * recently used packages first.
+ *
+ * Several rpminspect processes may share the cache.  New packages are
+ * added under a temporary name and renamed in to place.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <openssl/sha.h>
+
+#include "rpminspect.h"
+
+/* A package in the cache, used while pruning */
+struct cached_pkg {
+    char *path;
+    struct timespec mtime;
+    off_t size;
+};
+
+/*
+ * Returns the path in the cache for the given key or NULL if the
+ * cache is disabled.  The caller must free the returned string.
+ */
+static char *cache_path(const struct rpminspect *ri, const char *key)
+{
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    char hex[(SHA256_DIGEST_LENGTH * 2) + 1];
+    char *ret = NULL;
+    int i;
+
+    assert(ri != NULL);
+
+    if (ri->download_cache == NULL || key == NULL) {
+        return NULL;
+    }
+
+    SHA256((const unsigned char *) key, strlen(key), digest);
+
+    for (i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+        sprintf(&hex[i * 2], "%02x", (unsigned int) digest[i]);
+    }
+
+    xasprintf(&ret, "%s/%.2s/%s.rpm", ri->download_cache, hex, hex);
+    return ret;
+}
+
+/*
+ * If the package for key is in the download cache, put it at dst and
+ * return true.  Returns false if the cache is disabled, the package is
+ * not cached, or it could not be linked.
+ */
+bool fetch_cached(const struct rpminspect *ri, const char *key, const char *dst)
+{
+    char *path = NULL;
+    bool ret = false;
+
+    assert(dst != NULL);
+
+    if ((path = cache_path(ri, key)) == NULL) {
+        return false;
+    }
+
+    if (access(path, R_OK) == 0) {
+        if (unlink(dst) != 0 && errno != ENOENT) {
+            fprintf(stderr, _("*** unable to unlink %s: %s\n"), dst, strerror(errno));
+            fflush(stderr);
+        } else if (linkfile(path, dst) == 0) {
+            /* most recently used */
+            utimensat(AT_FDCWD, path, NULL, 0);
+            DEBUG_PRINT("using cached %s for %s\n", path, dst);
+            ret = true;
+        }
+    }
+
+    free(path);
+    return ret;
+}
+
+/*
+ * Add the downloaded package at src to the download cache under key.
+ * Failing to cache a package is not an error, the package is simply
+ * downloaded again next time.
+ */
+void store_cached(const struct rpminspect *ri, const char *key, const char *src)
+{
+    char *path = NULL;
+    char *tmp = NULL;
+    char *slash = NULL;
+
+    assert(src != NULL);
+
+    if ((path = cache_path(ri, key)) == NULL) {
+        return;
+    }
+
+    if (access(path, F_OK) == 0) {
+        free(path);
+        return;
+    }
+
+    /* create the subdirectory */
+    slash = rindex(path, '/');
+    *slash = '\0';
+
+    if (mkdirp(path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) {
+        fprintf(stderr, _("*** unable to create download cache directory %s: %s\n"), path, strerror(errno));
+        fflush(stderr);
+        free(path);
+        return;
+    }
+
+    *slash = '/';
+
+    /* other processes only ever see complete packages */
+    xasprintf(&tmp, "%s.%ld.tmp", path, (long) getpid());
+    unlink(tmp);
+
+    if (linkfile(src, tmp) != 0 || rename(tmp, path) != 0) {
+        DEBUG_PRINT("unable to cache %s: %s\n", src, strerror(errno));
+        unlink(tmp);
+    }
+
+    free(tmp);
+    free(path);
+    return;
+}
+
+static int cmp_mtime(const void *a, const void *b)
+{
+    const struct cached_pkg *x = a;
+    const struct cached_pkg *y = b;
+
+    if (x->mtime.tv_sec != y->mtime.tv_sec) {
+        return (x->mtime.tv_sec < y->mtime.tv_sec) ? -1 : 1;
+    } else if (x->mtime.tv_nsec != y->mtime.tv_nsec) {
+        return (x->mtime.tv_nsec < y->mtime.tv_nsec) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Remove the least recently used packages from the download cache
+ * until it is no larger than ri->download_cache_size.
+ */
+void prune_download_cache(const struct rpminspect *ri)
+{
+    DIR *top = NULL;
+    DIR *sub = NULL;
+    struct dirent *de = NULL;
+    struct dirent *se = NULL;
+    struct stat sb;
+    struct cached_pkg *pkgs = NULL;
+    size_t npkgs = 0;
+    size_t alloc = 0;
+    size_t i;
+    unsigned long long total = 0;
+    char *dir = NULL;
+    char *path = NULL;
+
+    assert(ri != NULL);
+
+    if (ri->download_cache == NULL || (top = opendir(ri->download_cache)) == NULL) {
+        return;
+    }
+
+    /* gather every cached package */
+    while ((de = readdir(top)) != NULL) {
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+
+        xasprintf(&dir, "%s/%s", ri->download_cache, de->d_name);
+
+        if ((sub = opendir(dir)) == NULL) {
+            free(dir);
+            continue;
+        }
+
+        while ((se = readdir(sub)) != NULL) {
+            if (!strsuffix(se->d_name, ".rpm")) {
+                continue;
+            }
+
+            xasprintf(&path, "%s/%s", dir, se->d_name);
+
+            if (stat(path, &sb) != 0 || !S_ISREG(sb.st_mode)) {
+                free(path);
+                continue;
+            }
+
+            if (npkgs == alloc) {
+                alloc = (alloc == 0) ? 64 : alloc * 2;
+                pkgs = realloc(pkgs, alloc * sizeof(*pkgs));
+                assert(pkgs != NULL);
+            }
+
+            pkgs[npkgs].path = path;
+            pkgs[npkgs].mtime = sb.st_mtim;
+            pkgs[npkgs].size = sb.st_size;
+            total += sb.st_size;
+            npkgs++;
+        }
+
+        closedir(sub);
+        free(dir);
+    }
+
+    closedir(top);
+
+    /* oldest first */
+    if (total > ri->download_cache_size) {
+        qsort(pkgs, npkgs, sizeof(*pkgs), cmp_mtime);
+    }
+
+    for (i = 0; i < npkgs; i++) {
+        if (total > ri->download_cache_size) {
+            if (unlink(pkgs[i].path) == 0 || errno == ENOENT) {
+                DEBUG_PRINT("pruned %s from the download cache\n", pkgs[i].path);
+                total -= pkgs[i].size;
+            }
+        }
+
+        free(pkgs[i].path);
+    }
+
+    free(pkgs);
+    return;
+}
@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <curl/curl.h>
+
+#include "rpminspect.h"
+
+/*
+ * Add a file to download to the list, creating the list if needed.
+ * If key is not NULL, the file is looked up in and added to the
+ * download cache under that key.
+ */
+void add_download(download_list_t **list, const char *src, const char *dst,
+                  const char *key)
+{
+    download_entry_t *entry = NULL;
+
+    assert(list != NULL);
+    assert(src != NULL);
+    assert(dst != NULL);
+
+    if (*list == NULL) {
+        *list = calloc(1, sizeof(**list));
+        assert(*list != NULL);
+        TAILQ_INIT(*list);
+    }
+
+    entry = calloc(1, sizeof(*entry));
+    assert(entry != NULL);
+    entry->src = strdup(src);
+    entry->dst = strdup(dst);
+    assert(entry->src != NULL && entry->dst != NULL);
+
+    if (key != NULL) {
+        entry->key = strdup(key);
+        assert(entry->key != NULL);
+    }
+
+    TAILQ_INSERT_TAIL(*list, entry, items);
+
+    return;
+}
+
+void free_downloads(download_list_t *list)
+{
+    download_entry_t *entry = NULL;
+
+    if (list == NULL) {
+        return;
+    }
+
+    while (!TAILQ_EMPTY(list)) {
+        entry = TAILQ_FIRST(list);
+        TAILQ_REMOVE(list, entry, items);
+        free(entry->src);
+        free(entry->dst);
+        free(entry->key);
+        free(entry);
+    }
+
+    free(list);
+    return;
+}
+
+/*
+ * Start one transfer on the multi handle.  All transfers on the same
+ * multi handle share its connection and DNS caches.
+ */
+static bool start_download(CURLM *multi, download_entry_t *entry, bool verbose)
+{
+    CURL *c = NULL;
+
+    if (!(c = curl_easy_init())) {
+        fprintf(stderr, _("*** curl_easy_init() failed\n"));
+        fflush(stderr);
+        return false;
+    }
+
+    if ((entry->fp = fopen(entry->dst, "wb")) == NULL) {
+        fprintf(stderr, _("*** error opening %s: %s\n"), entry->dst, strerror(errno));
+        fflush(stderr);
+        curl_easy_cleanup(c);
+        return false;
+    }
+
+    if (verbose) {
+        printf(_("Downloading %s...\n"), entry->src);
+    }
+
+    entry->tries++;
+    curl_easy_setopt(c, CURLOPT_URL, entry->src);
+    curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, NULL);
+    curl_easy_setopt(c, CURLOPT_WRITEDATA, entry->fp);
+    curl_easy_setopt(c, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(c, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(c, CURLOPT_TCP_FASTOPEN, 1L);
+    curl_easy_setopt(c, CURLOPT_PRIVATE, entry);
+
+    if (curl_multi_add_handle(multi, c) != CURLM_OK) {
+        fprintf(stderr, _("*** unable to start download of %s\n"), entry->src);
+        fflush(stderr);
+        fclose(entry->fp);
+        entry->fp = NULL;
+        curl_easy_cleanup(c);
+        return false;
+    }
+
+    entry->handle = c;
+    return true;
+}
+
+/*
+ * Returns true if a failed transfer is worth trying again.  Anything
+ * the server answered with a 4xx status is not going to change.
+ */
+static bool retryable(CURL *c, CURLcode cc)
+{
+    long code = 0;
+
+    if (cc == CURLE_HTTP_RETURNED_ERROR) {
+        curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &code);
+        return code >= 500;
+    }
+
+    return cc != CURLE_URL_MALFORMAT && cc != CURLE_UNSUPPORTED_PROTOCOL &&
+           cc != CURLE_WRITE_ERROR;
+}
+
+/* Current time in milliseconds on the monotonic clock */
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Set when a failed transfer may be tried again.  The wait doubles
+ * with every try so a struggling server is not hammered.
+ */
+static void schedule_retry(download_entry_t *entry)
+{
+    uint64_t delay = DOWNLOAD_RETRY_DELAY;
+    unsigned int i;
+
+    for (i = 1; i < entry->tries && delay < DOWNLOAD_RETRY_MAX_DELAY; i++) {
+        delay *= 2;
+    }
+
+    if (delay > DOWNLOAD_RETRY_MAX_DELAY) {
+        delay = DOWNLOAD_RETRY_MAX_DELAY;
+    }
+
+    entry->retry_at = now_ms() + delay;
+    return;
+}
+
+/*
+ * Download every file in the list, ri->download_jobs at a time.  Failed
+ * transfers are retried up to ri->download_retries more times, after a
+ * wait that doubles with each try.  The done function is called with
+ * the destination path as soon as each file has arrived, while the
+ * other transfers carry on, so the caller can start on a file before
+ * the whole list is finished.  Files that cannot be downloaded are
+ * reported and removed.  Files with a cache key are taken from the
+ * download cache when they are in it and are added to it when they are
+ * downloaded.
+ *
+ * Returns false if a transfer could not be set up or the done function
+ * returned nonzero, in which case the remaining transfers are stopped.
+ */
+bool run_downloads(const struct rpminspect *ri, download_list_t *list,
+                   download_done_func done, void *user_data)
+{
+    bool ret = true;
+    CURLM *multi = NULL;
+    CURLMsg *msg = NULL;
+    CURL *c = NULL;
+    CURLcode cc;
+    bool retry;
+    download_entry_t *next = NULL;
+    download_entry_t *entry = NULL;
+    unsigned int jobs;
+    unsigned int active = 0;
+    unsigned int waiting = 0;
+    uint64_t now;
+    uint64_t wake;
+    int running = 0;
+    int left = 0;
+
+    assert(ri != NULL);
+
+    if (list == NULL || TAILQ_EMPTY(list)) {
+        return true;
+    }
+
+    jobs = (ri->download_jobs > 0) ? ri->download_jobs : 1;
+
+    if ((multi = curl_multi_init()) == NULL) {
+        fprintf(stderr, _("*** curl_multi_init() failed\n"));
+        fflush(stderr);
+        return false;
+    }
+
+    next = TAILQ_FIRST(list);
+
+    while (ret && (next != NULL || active > 0 || waiting > 0)) {
+        now = now_ms();
+        wake = now + 1000;
+
+        /* Failed transfers whose wait is over go first */
+        if (waiting > 0) {
+            TAILQ_FOREACH(entry, list, items) {
+                if (entry->retry_at == 0 || active >= jobs) {
+                    continue;
+                } else if (entry->retry_at > now) {
+                    wake = (entry->retry_at < wake) ? entry->retry_at : wake;
+                    continue;
+                }
+
+                entry->retry_at = 0;
+                waiting--;
+
+                if (!start_download(multi, entry, ri->verbose)) {
+                    ret = false;
+                    break;
+                }
+
+                active++;
+            }
+
+            if (!ret) {
+                break;
+            }
+        }
+
+        /* Keep the pipe full */
+        while (next != NULL && active < jobs) {
+            entry = next;
+
+            if (fetch_cached(ri, entry->key, entry->dst)) {
+                next = TAILQ_NEXT(next, items);
+
+                if (done != NULL && done(entry->dst, user_data)) {
+                    ret = false;
+                    break;
+                }
+
+                continue;
+            }
+
+            if (!start_download(multi, next, ri->verbose)) {
+                ret = false;
+                break;
+            }
+
+            next = TAILQ_NEXT(next, items);
+            active++;
+        }
+
+        if (!ret) {
+            break;
+        }
+
+        curl_multi_perform(multi, &running);
+
+        /* Handle finished transfers */
+        while ((msg = curl_multi_info_read(multi, &left)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            c = msg->easy_handle;
+            cc = msg->data.result;
+            curl_easy_getinfo(c, CURLINFO_PRIVATE, (char **) &entry);
+
+            if (fclose(entry->fp) != 0 && cc == CURLE_OK) {
+                fprintf(stderr, _("*** error closing %s: %s\n"), entry->dst, strerror(errno));
+                fflush(stderr);
+                cc = CURLE_WRITE_ERROR;
+            }
+
+            entry->fp = NULL;
+            retry = cc != CURLE_OK && entry->tries <= ri->download_retries && retryable(c, cc);
+
+            curl_multi_remove_handle(multi, c);
+            curl_easy_cleanup(c);
+            entry->handle = NULL;
+            active--;
+
+            if (retry) {
+                /* Try again later, the other transfers keep going */
+                schedule_retry(entry);
+                wake = (entry->retry_at < wake) ? entry->retry_at : wake;
+                waiting++;
+                DEBUG_PRINT("retrying %s: %s\n", entry->src, curl_easy_strerror(cc));
+                continue;
+            }
+
+            if (cc != CURLE_OK) {
+                fprintf(stderr, _("*** unable to download %s: %s\n"), entry->src, curl_easy_strerror(cc));
+                fflush(stderr);
+
+                if (unlink(entry->dst)) {
+                    fprintf(stderr, _("*** unable to unlink %s: %s\n"), entry->dst, strerror(errno));
+                    fflush(stderr);
+                }
+
+                continue;
+            }
+
+            store_cached(ri, entry->key, entry->dst);
+
+            if (done != NULL && ret && done(entry->dst, user_data)) {
+                ret = false;
+            }
+        }
+
+        if (!ret) {
+            break;
+        }
+
+        /* Sleep until there is data or a retry is due */
+        now = now_ms();
+        wake = (wake > now) ? wake - now : 0;
+
+        if (active > 0) {
+            curl_multi_wait(multi, NULL, 0, wake, NULL);
+        } else if (waiting > 0 && next == NULL) {
+            usleep(wake * 1000);
+        }
+    }
+
+    /* Stop anything still in flight after an error */
+    TAILQ_FOREACH(entry, list, items) {
+        if (entry->retry_at != 0) {
+            entry->retry_at = 0;
+            unlink(entry->dst);
+            continue;
+        } else if (entry->handle == NULL) {
+            continue;
+        }
+
+        curl_multi_remove_handle(multi, entry->handle);
+        curl_easy_cleanup(entry->handle);
+        entry->handle = NULL;
+        fclose(entry->fp);
+        entry->fp = NULL;
+        unlink(entry->dst);
+    }
+
+    curl_multi_cleanup(multi);
+    prune_download_cache(ri);
+    return ret;
+}
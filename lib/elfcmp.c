@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compare two ELF objects in process, in place of running
+ * 'eu-elfcmp --ignore-build-id --hash-inexact' on them.
+ *
+ * Sections are paired by name (the nth section with a name in one
+ * file goes with the nth one with that name in the other) by sorting
+ * each file's sections by name, so objects with thousands of sections
+ * (-ffunction-sections, COMDAT groups) are cheap to pair.  Paired
+ * sections have their headers and contents compared.  Sections that differ between
+ * otherwise identical builds are skipped: the build-id, the debug
+ * links and the debug sections.  Hash sections only have their
+ * presence compared since their layout may change for the same set
+ * of symbols.  The ELF header and the program headers are compared
+ * field by field, leaving out addresses and sizes that follow from
+ * the sections.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <gelf.h>
+#include <libelf.h>
+
+#include "rpminspect.h"
+
+/* Sections that are expected to differ between builds of the same code */
+static bool is_noise_section(const char *name)
+{
+    if (name == NULL) {
+        return false;
+    }
+
+    return !strcmp(name, ".note.gnu.build-id") ||
+           !strcmp(name, ".gnu_debuglink") ||
+           !strcmp(name, ".gnu_debugaltlink") ||
+           !strcmp(name, ".gnu_debugdata") ||
+           strprefix(name, ".debug_") ||
+           strprefix(name, ".zdebug_");
+}
+
+static void add_difference(string_list_t **diffs, char *line)
+{
+    string_entry_t *entry = NULL;
+
+    if (*diffs == NULL) {
+        *diffs = calloc(1, sizeof(**diffs));
+        assert(*diffs != NULL);
+        TAILQ_INIT(*diffs);
+    }
+
+    entry = calloc(1, sizeof(*entry));
+    assert(entry != NULL);
+    entry->data = line;
+    TAILQ_INSERT_TAIL(*diffs, entry, items);
+    return;
+}
+
+/* A section to pair, see sort_sections() */
+struct named_section {
+    const char *name;
+    size_t index;
+};
+
+static int cmp_named_sections(const void *a, const void *b)
+{
+    const struct named_section *x = a;
+    const struct named_section *y = b;
+    int r = strcmp(x->name, y->name);
+
+    if (r != 0) {
+        return r;
+    }
+
+    return (x->index < y->index) ? -1 : (x->index > y->index);
+}
+
+/*
+ * Return the sections of the object that are compared, sorted by name
+ * and then index, and set count to how many there are.
+ */
+static struct named_section *sort_sections(const elf_info_t *info, size_t *count)
+{
+    struct named_section *sections = NULL;
+    size_t i;
+
+    *count = 0;
+    sections = calloc(info->shnum + 1, sizeof(*sections));
+    assert(sections != NULL);
+
+    for (i = 1; i < info->shnum; i++) {
+        if (info->shnames[i] != NULL && !is_noise_section(info->shnames[i])) {
+            sections[*count].name = info->shnames[i];
+            sections[*count].index = i;
+            (*count)++;
+        }
+    }
+
+    qsort(sections, *count, sizeof(*sections), cmp_named_sections);
+    return sections;
+}
+
+/*
+ * Pair the sections of the two objects.  match[i] is set to the index
+ * of the before section paired with after section i, or 0, and
+ * matched[j] is set for each before section j that has a pair.
+ */
+static void pair_sections(const elf_info_t *before, const elf_info_t *after, size_t *match, bool *matched)
+{
+    struct named_section *bs = NULL;
+    struct named_section *as = NULL;
+    size_t nb = 0;
+    size_t na = 0;
+    size_t i = 0;
+    size_t j = 0;
+    int r;
+
+    bs = sort_sections(before, &nb);
+    as = sort_sections(after, &na);
+
+    /* the nth of a name in one goes with the nth of it in the other */
+    while (i < na && j < nb) {
+        r = strcmp(as[i].name, bs[j].name);
+
+        if (r < 0) {
+            i++;
+        } else if (r > 0) {
+            j++;
+        } else {
+            match[as[i].index] = bs[j].index;
+            matched[bs[j].index] = true;
+            i++;
+            j++;
+        }
+    }
+
+    free(bs);
+    free(as);
+    return;
+}
+
+/* Return true if the contents of two sections are the same */
+static bool same_contents(const elf_info_t *before, size_t bi, const elf_info_t *after, size_t ai)
+{
+    Elf_Data *bdata = NULL;
+    Elf_Data *adata = NULL;
+
+    /* the data was loaded by get_elf_info() */
+    bdata = elf_getdata(elf_getscn(before->elf, bi), NULL);
+    adata = elf_getdata(elf_getscn(after->elf, ai), NULL);
+
+    if (bdata == NULL || adata == NULL) {
+        return bdata == adata;
+    }
+
+    if (bdata->d_size != adata->d_size) {
+        return false;
+    }
+
+    return bdata->d_size == 0 || bdata->d_buf == NULL || adata->d_buf == NULL ||
+           !memcmp(bdata->d_buf, adata->d_buf, bdata->d_size);
+}
+
+static void compare_section(const elf_info_t *before, size_t bi, const elf_info_t *after, size_t ai, string_list_t **diffs)
+{
+    const GElf_Shdr *bs = &before->shdrs[bi];
+    const GElf_Shdr *as = &after->shdrs[ai];
+    const char *name = after->shnames[ai];
+    char *line = NULL;
+
+    if (bs->sh_type != as->sh_type || bs->sh_flags != as->sh_flags || bs->sh_entsize != as->sh_entsize) {
+        xasprintf(&line, _("section %s: header differs"), name);
+        add_difference(diffs, line);
+        return;
+    }
+
+    if (as->sh_type == SHT_HASH || as->sh_type == SHT_GNU_HASH) {
+        return;
+    }
+
+    if (bs->sh_size != as->sh_size) {
+        xasprintf(&line, _("section %s: size %lu -> %lu"), name, (unsigned long) bs->sh_size, (unsigned long) as->sh_size);
+        add_difference(diffs, line);
+        return;
+    }
+
+    if (as->sh_type != SHT_NOBITS && !same_contents(before, bi, after, ai)) {
+        xasprintf(&line, _("section %s: content differs"), name);
+        add_difference(diffs, line);
+    }
+
+    return;
+}
+
+/*
+ * Compare two ELF objects.  Returns NULL if they are the same for the
+ * purposes of the changedfiles inspection, otherwise a list of lines
+ * describing each difference.  Free the list with list_free(list, free).
+ */
+string_list_t *compare_elf(const elf_info_t *before, const elf_info_t *after)
+{
+    string_list_t *diffs = NULL;
+    char *line = NULL;
+    const char *name = NULL;
+    size_t *match = NULL;
+    bool *matched = NULL;
+    size_t i;
+    size_t before_shstrndx = 0;
+    size_t after_shstrndx = 0;
+
+    assert(before != NULL && before->elf != NULL);
+    assert(after != NULL && after->elf != NULL);
+
+    /* ELF header */
+    if (before->ehdr.e_ident[EI_CLASS] != after->ehdr.e_ident[EI_CLASS] ||
+        before->ehdr.e_ident[EI_DATA] != after->ehdr.e_ident[EI_DATA] ||
+        before->ehdr.e_ident[EI_OSABI] != after->ehdr.e_ident[EI_OSABI] ||
+        before->ehdr.e_type != after->ehdr.e_type ||
+        before->ehdr.e_machine != after->ehdr.e_machine ||
+        before->ehdr.e_flags != after->ehdr.e_flags) {
+        add_difference(&diffs, strdup(_("ELF header differs")));
+    }
+
+    /* Program headers */
+    if (before->phnum != after->phnum) {
+        xasprintf(&line, _("program headers: %zu -> %zu"), before->phnum, after->phnum);
+        add_difference(&diffs, line);
+    } else {
+        for (i = 0; i < after->phnum; i++) {
+            if (before->phdrs[i].p_type != after->phdrs[i].p_type ||
+                before->phdrs[i].p_flags != after->phdrs[i].p_flags ||
+                before->phdrs[i].p_align != after->phdrs[i].p_align) {
+                xasprintf(&line, _("program header %zu differs"), i);
+                add_difference(&diffs, line);
+            }
+        }
+    }
+
+    /*
+     * The section names are compared by the pairing below, the string
+     * table holding them is not compared on its own.
+     */
+    elf_getshdrstrndx(before->elf, &before_shstrndx);
+    elf_getshdrstrndx(after->elf, &after_shstrndx);
+
+    match = calloc(after->shnum + 1, sizeof(*match));
+    assert(match != NULL);
+    matched = calloc(before->shnum + 1, sizeof(*matched));
+    assert(matched != NULL);
+    pair_sections(before, after, match, matched);
+
+    /* Sections in the after object, and whether they were there before */
+    for (i = 1; i < after->shnum; i++) {
+        name = after->shnames[i];
+
+        if (name == NULL || is_noise_section(name)) {
+            continue;
+        }
+
+        if (match[i] == 0) {
+            xasprintf(&line, _("section %s: added"), name);
+            add_difference(&diffs, line);
+            continue;
+        }
+
+        if (i == after_shstrndx && match[i] == before_shstrndx) {
+            continue;
+        }
+
+        compare_section(before, match[i], after, i, &diffs);
+    }
+
+    /* Sections that are gone */
+    for (i = 1; i < before->shnum; i++) {
+        name = before->shnames[i];
+
+        if (name != NULL && !is_noise_section(name) && !matched[i]) {
+            xasprintf(&line, _("section %s: removed"), name);
+            add_difference(&diffs, line);
+        }
+    }
+
+    free(match);
+    free(matched);
+    return diffs;
+}
@@ -19,9 +19,12 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <regex.h>
-#include <search.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -35,8 +38,42 @@
 #include <archive.h>
 #include <archive_entry.h>
 
+
 #include "rpminspect.h"
 
+/*
+ * Return a new, empty file list with its own arena.  Get entries for
+ * it from new_file_entry().
+ */
+rpmfile_t *new_files(void)
+{
+    rpmfile_t *files = NULL;
+
+    files = calloc(1, sizeof(*files));
+    assert(files != NULL);
+    TAILQ_INIT(files);
+    files->arena = arena_new();
+    return files;
+}
+
+/*
+ * Return a zeroed file entry from the list's arena.  The entry is not
+ * added to the list.  Its localpath and fullpath must come from the
+ * arena too; type and checksum are set later, from any thread, and
+ * stay on the heap.
+ */
+rpmfile_entry_t *new_file_entry(rpmfile_t *files)
+{
+    rpmfile_entry_t *entry = NULL;
+
+    assert(files != NULL);
+    assert(files->arena != NULL);
+
+    entry = arena_alloc(files->arena, sizeof(*entry));
+    memset(entry, 0, sizeof(*entry));
+    return entry;
+}
+
 void free_files(rpmfile_t *files)
 {
     rpmfile_entry_t *entry;
@@ -48,30 +85,228 @@ void free_files(rpmfile_t *files)
     while (!TAILQ_EMPTY(files)) {
         entry = TAILQ_FIRST(files);
         TAILQ_REMOVE(files, entry, items);
-        free(entry->fullpath);
-        free(entry->localpath);
-        free(entry->type);
         free(entry->checksum);
-        free(entry);
+        free_elf_info(entry->elf_info);
+
+        if (files->arena == NULL) {
+            free(entry->fullpath);
+            free(entry->localpath);
+            free(entry);
+        }
     }
 
+    free_file_table(files->table);
+    arena_free(files->arena);
     free(files);
 }
 
+/*
+ * Returns true if no inspection reads the contents of files with this
+ * MIME type, see STREAM_OPAQUE_TYPES.
+ */
+static bool is_opaque_type(unsigned int type_id)
+{
+    const char *type = intern_string(type_id);
+    bool ret = false;
+    char *types = NULL;
+    char *token = NULL;
+    char *saveptr = NULL;
+
+    if (type == NULL) {
+        return false;
+    }
+
+    types = strdup(STREAM_OPAQUE_TYPES);
+    assert(types != NULL);
+
+    for (token = strtok_r(types, " ", &saveptr); token != NULL; token = strtok_r(NULL, " ", &saveptr)) {
+        if (strprefix(type, token)) {
+            ret = true;
+            break;
+        }
+    }
+
+    free(types);
+    return ret;
+}
+
+/*
+ * Write the payload data for a regular file in streaming mode.  The
+ * data is read from the archive once.  While it goes by, the MIME
+ * type (from the first STREAM_SNIFF_BYTES) is computed and cached in
+ * the file entry, and so is the SHA-256 checksum unless the header
+ * digest will be used.  checksum() and get_mime_type() never have to
+ * read the file back.
+ *
+ * Files of an opaque type only get their first STREAM_HEAD_BYTES
+ * written and are then extended to their full size as a hole.  The
+ * unpacked tree still has every file at the right size and with the
+ * right leading bytes for anything that stats a file or sniffs its
+ * header.
+ */
+static bool stream_file(struct rpminspect *ri, struct archive *archive, rpmfile_entry_t *file, mode_t perm)
+{
+    bool ret = false;
+    bool decided = false;
+    bool opaque = false;
+    const void *block = NULL;
+    size_t size = 0;
+    size_t n = 0;
+#if ARCHIVE_VERSION_NUMBER < 3000000
+    off_t offset = 0;
+#else
+    la_int64_t offset = 0;
+#endif
+    int r;
+    int fd = -1;
+    char *head = NULL;
+    size_t headlen = 0;
+    char *dir = NULL;
+    checksum_ctx_t *ctx = NULL;
+    char *sums[NUM_CHECKSUMS];
+
+    assert(ri != NULL);
+    assert(archive != NULL);
+    assert(file != NULL);
+    assert(file->fullpath != NULL);
+
+    /* The payload does not always carry the parent directories */
+    dir = strdup(file->fullpath);
+    assert(dir != NULL);
+
+    if (mkdirp(dirname(dir), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) {
+        fprintf(stderr, _("*** Unable to create directory for %s: %s\n"), file->fullpath, strerror(errno));
+        fflush(stderr);
+        free(dir);
+        return false;
+    }
+
+    free(dir);
+
+    if ((fd = open(file->fullpath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, perm)) == -1) {
+        fprintf(stderr, _("*** Unable to create %s: %s\n"), file->fullpath, strerror(errno));
+        fflush(stderr);
+        return false;
+    }
+
+    head = malloc(STREAM_SNIFF_BYTES);
+    assert(head != NULL);
+
+    if (ri->verify_digests || get_header_digest(file) == NULL) {
+        ctx = checksum_begin(CHECKSUM_MASK(SHA256SUM));
+    }
+
+    while ((r = archive_read_data_block(archive, &block, &size, &offset)) == ARCHIVE_OK) {
+        if (ctx != NULL) {
+            checksum_update(ctx, block, size);
+        }
+
+        /* Collect the leading bytes until the type is known */
+        if (!decided) {
+            if (offset != (off_t) headlen) {
+                fprintf(stderr, _("*** Unexpected hole in payload data for %s\n"), file->localpath);
+                fflush(stderr);
+                goto cleanup;
+            }
+
+            n = STREAM_SNIFF_BYTES - headlen;
+
+            if (size < n) {
+                n = size;
+            }
+
+            memcpy(head + headlen, block, n);
+            headlen += n;
+
+            if (headlen < STREAM_SNIFF_BYTES) {
+                continue;
+            }
+
+            file->type_id = get_buffer_mime_type_id(ri, head, headlen);
+            opaque = is_opaque_type(file->type_id);
+            decided = true;
+
+            if (pwrite(fd, head, opaque ? STREAM_HEAD_BYTES : headlen, 0) == -1) {
+                goto write_error;
+            }
+
+            block = (const char *) block + n;
+            offset += n;
+            size -= n;
+        }
+
+        if (!opaque && size > 0 && pwrite(fd, block, size, offset) == -1) {
+            goto write_error;
+        }
+    }
+
+    if (r != ARCHIVE_EOF) {
+        fprintf(stderr, _("*** Error reading %s from the payload: %s\n"), file->localpath, archive_error_string(archive));
+        fflush(stderr);
+        goto cleanup;
+    }
+
+    /* Small files end before the sniff buffer fills up */
+    if (!decided) {
+        file->type_id = get_buffer_mime_type_id(ri, head, headlen);
+        opaque = is_opaque_type(file->type_id);
+
+        if (pwrite(fd, head, (opaque && headlen > STREAM_HEAD_BYTES) ? STREAM_HEAD_BYTES : headlen, 0) == -1) {
+            goto write_error;
+        }
+    }
+
+    /* Opaque files keep their size, the unwritten part is a hole */
+    if (ftruncate(fd, file->st.st_size) == -1) {
+        goto write_error;
+    }
+
+    if (ctx != NULL) {
+        checksum_end(ctx, sums);
+        ctx = NULL;
+        file->checksum = sums[SHA256SUM];
+
+        if (ri->verify_digests) {
+            check_header_digest(file, file->checksum);
+        }
+    }
+
+    ret = true;
+    goto cleanup;
+
+write_error:
+    fprintf(stderr, _("*** Error writing %s: %s\n"), file->fullpath, strerror(errno));
+    fflush(stderr);
+
+cleanup:
+    if (close(fd) == -1 && ret) {
+        fprintf(stderr, _("*** Error closing %s: %s\n"), file->fullpath, strerror(errno));
+        fflush(stderr);
+        ret = false;
+    }
+
+    /* the payload could not be written out, throw the digest away */
+    if (ctx != NULL) {
+        checksum_end(ctx, sums);
+        free(sums[SHA256SUM]);
+    }
+
+    free(head);
+    return ret;
+}
+
 /* Extract the RPM, with path "pkg" and extracted header "hdr", to output_dir.
  * Either output_dir or the directory immediately above it must exist.
+ * If ri->stream_payloads is set, regular files are written by stream_file().
  */
-rpmfile_t *extract_rpm(const char *pkg, Header hdr)
+rpmfile_t *extract_rpm(struct rpminspect *ri, const char *pkg, Header hdr)
 {
     rpmtd td = NULL;
     rpm_count_t td_size;
 
     const char *rpm_path;
-    struct hsearch_data path_table = { 0 };
-    bool path_table_initialized = false;
-    ENTRY e;
-    ENTRY *eptr;
-    int *rpm_indices = NULL;
+    hashmap_t *path_table = NULL;
+    void *rpm_index;
 
     char *hardlinkpath = NULL;
     char *output_dir = NULL;
@@ -87,6 +322,7 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr)
 
     const int archive_flags = ARCHIVE_EXTRACT_SECURE_NODOTDOT | ARCHIVE_EXTRACT_SECURE_SYMLINKS;
 
+    assert(ri != NULL);
     assert(pkg != NULL);
     assert(hdr != NULL);
 
@@ -101,6 +337,12 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr)
         xasprintf(&output_dir, "%s.d", pkg);
     }
 
+    /* An earlier run may have done the work for us */
+    if ((file_list = load_analysis(ri, hdr, output_dir)) != NULL) {
+        free(output_dir);
+        return file_list;
+    }
+
     if (mkdir(output_dir, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) == -1) {
         fprintf(stderr, _("*** Unable to create directory %s: %s\n"), output_dir, strerror(errno));
         return NULL;
@@ -123,21 +365,9 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr)
         goto cleanup;
     }
 
-    /*
-     * Allocate the hash table, and allocate an array of ints to store the index data
-     * that the hash table entries will point to.
-     */
+    /* The hash table values are the indexes themselves, not pointers */
     td_size = rpmtdCount(td);
-
-    if (hcreate_r(td_size * 1.25, &path_table) == 0) {
-        fprintf(stderr, _("*** Unable to allocate hash table: %s\n"), strerror(errno));
-        goto cleanup;
-    }
-
-    path_table_initialized = true;
-
-    rpm_indices = calloc(td_size, sizeof(int));
-    assert(rpm_indices != NULL);
+    path_table = hashmap_new(td_size);
 
     for (i = 0; i < (int) td_size; i++) {
         rpm_path = rpmtdNextString(td);
@@ -147,14 +377,7 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr)
             goto cleanup;
         }
 
-        rpm_indices[i] = i;
-        e.key = (char *) rpm_path;
-        e.data = rpm_indices + i;
-
-        if (hsearch_r(e, ENTER, &eptr, &path_table) == 0) {
-            fprintf(stderr, _("*** Error populating hash table: %s\n"), strerror(errno));
-            goto cleanup;
-        }
+        hashmap_put(path_table, rpm_path, (void *) (intptr_t) i);
     }
 
     /* Open the file with libarchive */
@@ -174,9 +397,7 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr)
     }
 
     /* Allocate space for the return value */
-    file_list = calloc(1, sizeof(rpmfile_t));
-    assert(file_list != NULL);
-    TAILQ_INIT(file_list);
+    file_list = new_files();
 
     while ((archive_result = archive_read_next_header(archive, &entry)) != ARCHIVE_EOF) {
         if (archive_result == ARCHIVE_RETRY) {
@@ -197,8 +418,7 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr)
             archive_path += 1;
         }
 
-        e.key = (char *) archive_path;
-        if (hsearch_r(e, FIND, &eptr, &path_table) == 0) {
+        if (!hashmap_find(path_table, archive_path, &rpm_index)) {
             fprintf(stderr, _("*** Payload path %s not in RPM metadata\n"), archive_path);
             free_files(file_list);
             file_list = NULL;
@@ -206,19 +426,11 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr)
         }
 
         /* Create a new rpmfile_entry_t for this file */
-        file_entry = calloc(1, sizeof(rpmfile_entry_t));
-        assert(file_entry != NULL);
-
+        file_entry = new_file_entry(file_list);
         file_entry->rpm_header = hdr;
         memcpy(&file_entry->st, archive_entry_stat(entry), sizeof(struct stat));
-        file_entry->idx = *((int *)eptr->data);
-
-        file_entry->localpath = strdup(archive_path);
-        assert(file_entry->localpath);
-
-        file_entry->type = NULL;
-        file_entry->checksum = NULL;
-        file_entry->cap = NULL;
+        file_entry->idx = (int) (intptr_t) rpm_index;
+        file_entry->localpath = arena_strdup(file_list->arena, archive_path);
 
         TAILQ_INSERT_TAIL(file_list, file_entry, items);
 
@@ -228,7 +440,7 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr)
         }
 
         /* Prepend output_dir to the path name */
-        xasprintf(&file_entry->fullpath, "%s/%s", output_dir, archive_path);
+        file_entry->fullpath = arena_printf(file_list->arena, "%s/%s", output_dir, archive_path);
         archive_entry_set_pathname(entry, file_entry->fullpath);
 
         /* Ensure the resulting file is user-rw and global-unwritable */
@@ -249,6 +461,21 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr)
             free(hardlinkpath);
         }
 
+        /*
+         * In streaming mode, write regular files ourselves.  Hard links
+         * are left to libarchive, which knows which entry carries the
+         * data.
+         */
+        if (ri->stream_payloads && S_ISREG(file_entry->st.st_mode) && archive_entry_nlink(entry) == 1) {
+            if (!stream_file(ri, archive, file_entry, archive_perm)) {
+                free_files(file_list);
+                file_list = NULL;
+                goto cleanup;
+            }
+
+            continue;
+        }
+
         /* Write the file to disk */
         if (archive_read_extract(archive, entry, archive_flags) != ARCHIVE_OK) {
             fprintf(stderr, _("*** Error extracting %s: %s\n"), pkg, archive_error_string(archive));
@@ -258,16 +485,15 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr)
         }
     }
 
+    store_analysis(ri, hdr, file_list);
+
 cleanup:
-    if (path_table_initialized) {
-        hdestroy_r(&path_table);
-    }
+    hashmap_free(path_table, NULL);
 
     if (archive != NULL) {
         archive_read_free(archive);
     }
 
-    free(rpm_indices);
     free(output_dir);
     rpmtdFree(td);
 
@@ -315,191 +541,34 @@ bool process_file_path(const rpmfile_entry_t *file, regex_t *include_regex, rege
     return true;
 }
 
-/* Helper for find_file_peers. Returns a hash table keyed by the localpath fields of
- * the file list, with the rpmfile_entry_t items as values.
- *
- * The list cannot be empty.
- *
- * The keys and values use the same pointers as the rpmfile_entry_t and should not
- * be separately freed. The hash table itself must be hdestroy_r'd and freed by the caller.
+/*
+ * Locks protecting the lazily cached members of rpmfile_entry_t
+ * (checksum, type_id, cap, and elf_info) when per-file inspection drivers run on
+ * more than one thread.  Entries are hashed on their address so
+ * unrelated files rarely contend for the same lock.
  */
-static struct hsearch_data * files_to_table(rpmfile_t *list)
-{
-    struct hsearch_data *table;
-    ENTRY e;
-    ENTRY *eptr;
-
-    rpmfile_entry_t *iter;
-
-    rpmtd td;
-    rpm_count_t td_size;
+#define FILE_LOCK_STRIPES 64
 
-    /* Use the length of RPMTAG_FILENAMES for the hash table size */
-    td = rpmtdNew();
-    assert(td != NULL);
-
-    iter = TAILQ_FIRST(list);
-    assert(iter);
-
-    if (headerGet(iter->rpm_header, RPMTAG_FILENAMES, td, HEADERGET_MINMEM | HEADERGET_EXT) != 1) {
-        fprintf(stderr, _("***Unable to read RPMTAG_FILENAMES\n"));
-        return NULL;
-    }
-
-    td_size = rpmtdCount(td);
-    rpmtdFree(td);
-
-    table = calloc(1, sizeof(*table));
-    assert(table);
-
-    if (hcreate_r(td_size * 1.25, table) == 0) {
-        fprintf(stderr, _("*** Unable to allocate hash table: %s\n"), strerror(errno));
-        free(table);
-        return NULL;
-    }
-
-    TAILQ_FOREACH(iter, list, items) {
-        e.key = iter->localpath;
-        e.data = iter;
-
-        if (hsearch_r(e, ENTER, &eptr, table) == 0) {
-            fprintf(stderr, _("*** Unable to add %s to hash table: %s\n"), iter->localpath, strerror(errno));
-            hdestroy_r(table);
-            free(table);
-            return NULL;
-        }
-    }
+static pthread_mutex_t file_locks[FILE_LOCK_STRIPES] = {
+    [0 ... FILE_LOCK_STRIPES - 1] = PTHREAD_MUTEX_INITIALIZER
+};
 
-    return table;
-}
-
-/* Helper for find_one_peer */
-static void set_peer(rpmfile_entry_t *file, ENTRY *eptr)
+static pthread_mutex_t *get_file_lock(const rpmfile_entry_t *file)
 {
-    rpmfile_entry_t *peer;
-
-    peer = eptr->data;
-    eptr->data = NULL;
-
-    file->peer_file = peer;
-    peer->peer_file = file;
+    assert(file != NULL);
+    return &file_locks[((uintptr_t) file >> 4) % FILE_LOCK_STRIPES];
 }
 
-/* For the given file from "before", attempt to find a matching file in "after".
- *
- * Any time a match is found, the hash table ENTRY's value field will be set
- * to NULL so that the match cannot be used again. For the purposes of adding
- * tests to match peers, this means that attempts must be made in order from
- * best match to worst match.
- */
-static void find_one_peer(rpmfile_entry_t *file, Header after_header, struct hsearch_data *after_table)
+void lock_file_entry(const rpmfile_entry_t *file)
 {
-    ENTRY e;
-    ENTRY *eptr;
-    int hsearch_result;
-
-    const char *before_version;
-    const char *after_version;
-    bool has_version;
-
-    const char *before_release;
-    const char *after_release;
-    char *before_vr;
-    char *after_vr;
-
-    char *search_path;
-
-    /* Start with the obvious case: the paths match */
-    e.key = file->localpath;
-    eptr = NULL;
-    hsearch_result = hsearch_r(e, FIND, &eptr, after_table);
-
-    if (hsearch_result != 0) {
-        set_peer(file, eptr);
-        return;
-    }
-
-    /* Try substituting the version strings */
-    before_version = headerGetString(file->rpm_header, RPMTAG_VERSION);
-    after_version = headerGetString(after_header, RPMTAG_VERSION);
-
-    /* If the path doesn't have a version in it we can skip these substitutions */
-    has_version = (strstr(file->localpath, before_version) != NULL);
-
-    if (has_version && (strcmp(before_version, after_version) != 0)) {
-        search_path = strreplace(file->localpath, before_version, after_version);
-
-        e.key = search_path;
-        eptr = NULL;
-        hsearch_result = hsearch_r(e, FIND, &eptr, after_table);
-        free(search_path);
-
-        if (hsearch_result != 0) {
-            set_peer(file, eptr);
-            return;
-        }
-    }
-
-    /* Try substituting version-release */
-    if (has_version) {
-        before_release = headerGetString(file->rpm_header, RPMTAG_RELEASE);
-        after_release = headerGetString(after_header, RPMTAG_RELEASE);
-
-        xasprintf(&before_vr, "%s-%s", before_version, before_release);
-        xasprintf(&after_vr, "%s-%s", after_version, after_release);
-
-        if (strcmp(before_vr, after_vr) != 0) {
-            search_path = strreplace(file->localpath, before_vr, after_vr);
-
-            free(before_vr);
-            free(after_vr);
-
-            e.key = search_path;
-            eptr = NULL;
-            hsearch_result = hsearch_r(e, FIND, &eptr, after_table);
-            free(search_path);
-
-            if (hsearch_result != 0) {
-                set_peer(file, eptr);
-                return;
-            }
-        } else {
-            free(before_vr);
-            free(after_vr);
-        }
-    }
+    pthread_mutex_lock(get_file_lock(file));
+    return;
 }
 
-/* Find matching files between the before and after lists, and populate the "peer_file" members of the entries.
- * Returns 0 on success, -1 on failure.
- */
-void find_file_peers(rpmfile_t *before, rpmfile_t *after)
+void unlock_file_entry(const rpmfile_entry_t *file)
 {
-    struct hsearch_data *after_table = NULL;
-    rpmfile_entry_t *iter;
-    rpmfile_entry_t *after_entry;
-
-    assert(before != NULL);
-    assert(after != NULL);
-
-    /* Make sure there is something to match */
-    if (TAILQ_EMPTY(before) || TAILQ_EMPTY(after)) {
-        return;
-    }
-
-    after_entry = TAILQ_FIRST(after);
-
-    /* Create a hash table of the after list, mapping path(char *) to rpmfile_entry_t */
-    after_table = files_to_table(after);
-    assert(after_table);
-
-    TAILQ_FOREACH(iter, before, items) {
-        find_one_peer(iter, after_entry->rpm_header, after_table);
-    }
-
-
-    hdestroy_r(after_table);
-    free(after_table);
+    pthread_mutex_unlock(get_file_lock(file));
+    return;
 }
 
 /*
@@ -509,14 +578,19 @@ void find_file_peers(rpmfile_t *before, rpmfile_t *after)
 cap_t get_cap(rpmfile_entry_t *file)
 {
     int fd;
+    cap_t cap = NULL;
     const char *arch = NULL;
 
     assert(file != NULL);
     arch = get_rpm_header_arch(file->rpm_header);
     assert(arch != NULL);
 
-    if (file->cap) {
-        return file->cap;
+    lock_file_entry(file);
+    cap = file->cap;
+    unlock_file_entry(file);
+
+    if (cap) {
+        return cap;
     }
 
     assert(file->fullpath != NULL);
@@ -532,13 +606,25 @@ cap_t get_cap(rpmfile_entry_t *file)
         return NULL;
     }
 
-    file->cap = cap_get_fd(fd);
+    cap = cap_get_fd(fd);
 
     if (close(fd) == -1) {
         fprintf(stderr, _("*** unable to close() %s on %s: %s\n"), file->localpath, arch, strerror(errno));
     }
 
-    return file->cap;
+    /* Another thread may have beaten us to it, keep the first one */
+    lock_file_entry(file);
+
+    if (file->cap == NULL) {
+        file->cap = cap;
+    } else if (cap != NULL) {
+        cap_free(cap);
+    }
+
+    cap = file->cap;
+    unlock_file_entry(file);
+
+    return cap;
 }
 
 /*
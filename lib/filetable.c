@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * File tables.  A file list is a TAILQ of large entries, so every
+ * filter on file type or peer presence walks pointers across the
+ * whole heap.  The table keeps the fields those filters look at in
+ * arrays indexed by row, in list order.  Tables are built once all
+ * files are paired and are read only after that, so any number of
+ * threads may read them.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <sys/stat.h>
+
+#include "rpminspect.h"
+
+/* Build the table for one list */
+static file_table_t *build_table(rpmfile_t *files)
+{
+    file_table_t *table = NULL;
+    rpmfile_entry_t *file = NULL;
+    unsigned int i = 0;
+
+    table = calloc(1, sizeof(*table));
+    assert(table != NULL);
+    table->arena = arena_new();
+
+    TAILQ_FOREACH(file, files, items) {
+        table->count++;
+    }
+
+    table->entries = arena_alloc(table->arena, table->count * sizeof(*table->entries));
+    table->mode = arena_alloc(table->arena, table->count * sizeof(*table->mode));
+    table->peered = arena_alloc(table->arena, table->count * sizeof(*table->peered));
+
+    TAILQ_FOREACH(file, files, items) {
+        table->entries[i] = file;
+        table->mode[i] = file->st.st_mode;
+        table->peered[i] = (file->peer_file != NULL);
+        i++;
+    }
+
+    return table;
+}
+
+/*
+ * Build the file table of every file list in ri->peers.  Call once
+ * the files are paired; finish_peers() does.
+ */
+void build_file_tables(struct rpminspect *ri)
+{
+    rpmpeer_entry_t *peer = NULL;
+
+    assert(ri != NULL);
+
+    if (ri->peers == NULL) {
+        return;
+    }
+
+    TAILQ_FOREACH(peer, ri->peers, items) {
+        if (peer->before_files != NULL && peer->before_files->table == NULL) {
+            peer->before_files->table = build_table(peer->before_files);
+        }
+
+        if (peer->after_files != NULL && peer->after_files->table == NULL) {
+            peer->after_files->table = build_table(peer->after_files);
+        }
+    }
+
+    return;
+}
+
+void free_file_table(file_table_t *table)
+{
+    if (table == NULL) {
+        return;
+    }
+
+    arena_free(table->arena);
+    free(table);
+    return;
+}
+
+/*
+ * Store in rows the rows of the files of type fmt (S_IFREG and so on,
+ * or 0 for any type) that have a peer if peered is set.  rows must
+ * have room for table->count entries.  Returns the number of rows
+ * stored.  The loop has no branches so the compiler can vectorize it.
+ */
+unsigned int select_files(const file_table_t *table, mode_t fmt, bool peered, uint32_t *rows)
+{
+    const uint32_t want = fmt & S_IFMT;
+    const unsigned int any = (want == 0);
+    const unsigned int nopeer = !peered;
+    unsigned int i;
+    unsigned int n = 0;
+
+    assert(table != NULL);
+    assert(rows != NULL);
+
+    for (i = 0; i < table->count; i++) {
+        rows[n] = i;
+        n += (any | ((table->mode[i] & S_IFMT) == want)) & (nopeer | table->peered[i]);
+    }
+
+    return n;
+}
@@ -19,7 +19,7 @@
 #include <regex.h>
 #include <stdlib.h>
 #include <sys/queue.h>
-#include <search.h>
+#include <rpm/rpmts.h>
 #include "rpminspect.h"
 
 void free_regex(regex_t *regex)
@@ -32,26 +32,11 @@ void free_regex(regex_t *regex)
     free(regex);
 }
 
-void free_mapping(struct hsearch_data *table, string_list_t *keys)
+void free_mapping(hashmap_t *table, string_list_t *keys)
 {
-    ENTRY e;
-    ENTRY *eptr;
-    string_entry_t *entry = NULL;
-
     if (table != NULL && keys != NULL) {
-        /* look up each key and free the memory for the value */
-        TAILQ_FOREACH(entry, keys, items) {
-            e.key = entry->data;
-            hsearch_r(e, FIND, &eptr, table);
-
-            if (eptr != NULL) {
-                free(eptr->data);
-            }
-        }
-
-        /* destroy the hash table */
-        hdestroy_r(table);
-        free(table);
+        /* destroy the hash table and the values in it */
+        hashmap_free(table, free);
 
         /* destroy the list of keys */
         list_free(keys, free);
@@ -79,7 +64,9 @@ void free_rpminspect(struct rpminspect *ri) {
     free(ri->kojihub);
     free(ri->kojiursine);
     free(ri->kojimbs);
+    free(ri->download_cache);
     free(ri->worksubdir);
+    free(ri->analysis_cache);
 
     free(ri->vendor_data_dir);
     free(ri->licensedb);
@@ -167,7 +154,17 @@ void free_rpminspect(struct rpminspect *ri) {
         free(ri->header_cache);
     }
 
+    hashmap_free(ri->header_index, NULL);
+
+    if (ri->ts != NULL) {
+        rpmtsFree(ri->ts);
+    }
+
+    close_results_sink(ri);
     free_results(ri->results);
+    free_magic_cookies(ri);
+    free_elf_data();
+    intern_free();
 
     return;
 }
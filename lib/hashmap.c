@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * String to pointer hash map.
+ *
+ * This replaces glibc's hsearch_r(), which has a fixed size chosen up
+ * front, cannot delete or iterate, and uses a single table per
+ * hsearch_data.  The map uses open addressing with linear probing in
+ * a single array of slots, so a lookup usually touches one or two
+ * cache lines.  Each slot keeps the full hash of its key, which means
+ * most mismatches never reach strcmp() and growing never rehashes a
+ * string.  The map doubles when it is 3/4 full, counting slots left
+ * behind by deletions.
+ *
+ * Keys are copied in to an arena owned by the map, so callers can pass
+ * temporary strings.  Values are not owned by the map; pass a free
+ * function to hashmap_free() to free them along with it.
+ *
+ * Lookups do not change the map, so any number of threads may read a
+ * map at once as long as nothing is adding or removing entries.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "rpminspect.h"
+
+/* Marks a slot whose entry was removed */
+static const char tombstone[] = "";
+
+struct hashmap_slot {
+    uint64_t hash;
+    const char *key;            /* NULL if never used */
+    void *value;
+};
+
+struct _hashmap_t {
+    struct hashmap_slot *slots;
+    size_t capacity;            /* always a power of 2 */
+    size_t count;               /* live entries */
+    size_t used;                /* live entries and tombstones */
+    arena_t *keys;
+};
+
+/* 64-bit FNV-1a */
+static uint64_t hash_key(const char *key)
+{
+    uint64_t h = UINT64_C(14695981039346656037);
+
+    while (*key != '\0') {
+        h ^= (unsigned char) *key++;
+        h *= UINT64_C(1099511628211);
+    }
+
+    return h;
+}
+
+/*
+ * Return the slot holding key, or if key is not in the map, the slot
+ * it should go in.
+ */
+static struct hashmap_slot *find_slot(const hashmap_t *map, const char *key, uint64_t hash)
+{
+    size_t mask = map->capacity - 1;
+    size_t i = hash & mask;
+    struct hashmap_slot *slot = NULL;
+    struct hashmap_slot *reuse = NULL;
+
+    while (true) {
+        slot = &map->slots[i];
+
+        if (slot->key == NULL) {
+            /* not here, prefer the first tombstone we passed */
+            return (reuse != NULL) ? reuse : slot;
+        } else if (slot->key == tombstone) {
+            if (reuse == NULL) {
+                reuse = slot;
+            }
+        } else if (slot->hash == hash && !strcmp(slot->key, key)) {
+            return slot;
+        }
+
+        i = (i + 1) & mask;
+    }
+}
+
+/* Move every entry to a table with the given number of slots */
+static void resize(hashmap_t *map, size_t capacity)
+{
+    struct hashmap_slot *old = map->slots;
+    size_t oldcap = map->capacity;
+    size_t i;
+    size_t j;
+
+    map->slots = calloc(capacity, sizeof(*map->slots));
+    assert(map->slots != NULL);
+    map->capacity = capacity;
+    map->used = map->count;
+
+    for (i = 0; i < oldcap; i++) {
+        if (old[i].key == NULL || old[i].key == tombstone) {
+            continue;
+        }
+
+        j = old[i].hash & (capacity - 1);
+
+        while (map->slots[j].key != NULL) {
+            j = (j + 1) & (capacity - 1);
+        }
+
+        map->slots[j] = old[i];
+    }
+
+    free(old);
+    return;
+}
+
+/* Create a map with room for about hint entries before it has to grow */
+hashmap_t *hashmap_new(size_t hint)
+{
+    hashmap_t *map = NULL;
+    size_t capacity = HASHMAP_MIN_SIZE;
+
+    while ((capacity * 3) / 4 < hint) {
+        capacity *= 2;
+    }
+
+    map = calloc(1, sizeof(*map));
+    assert(map != NULL);
+    map->slots = calloc(capacity, sizeof(*map->slots));
+    assert(map->slots != NULL);
+    map->capacity = capacity;
+    map->keys = arena_new();
+    return map;
+}
+
+/* Free the map, calling free_value on each value if it is not NULL */
+void hashmap_free(hashmap_t *map, void (*free_value)(void *))
+{
+    size_t i;
+
+    if (map == NULL) {
+        return;
+    }
+
+    if (free_value != NULL) {
+        for (i = 0; i < map->capacity; i++) {
+            if (map->slots[i].key != NULL && map->slots[i].key != tombstone) {
+                free_value(map->slots[i].value);
+            }
+        }
+    }
+
+    arena_free(map->keys);
+    free(map->slots);
+    free(map);
+    return;
+}
+
+/*
+ * Set the value for key.  Returns true if key was added and false if
+ * it was already in the map, in which case its value is replaced.
+ */
+bool hashmap_put(hashmap_t *map, const char *key, void *value)
+{
+    uint64_t hash;
+    struct hashmap_slot *slot = NULL;
+
+    assert(map != NULL);
+    assert(key != NULL);
+
+    hash = hash_key(key);
+    slot = find_slot(map, key, hash);
+
+    if (slot->key != NULL && slot->key != tombstone) {
+        slot->value = value;
+        return false;
+    }
+
+    if (slot->key == NULL) {
+        /* a fresh slot, make sure there will still be empty ones */
+        if (((map->used + 1) * 4) > (map->capacity * 3)) {
+            /* only grow if the live entries need it, otherwise just drop tombstones */
+            resize(map, ((map->count + 1) * 2 > map->capacity) ? map->capacity * 2 : map->capacity);
+            slot = find_slot(map, key, hash);
+        }
+
+        map->used++;
+    }
+
+    slot->hash = hash;
+    slot->key = arena_strdup(map->keys, key);
+    slot->value = value;
+    map->count++;
+    return true;
+}
+
+/*
+ * Look up key.  Returns true if it is in the map and stores its value
+ * in value if that is not NULL.
+ */
+bool hashmap_find(const hashmap_t *map, const char *key, void **value)
+{
+    struct hashmap_slot *slot = NULL;
+
+    if (map == NULL || key == NULL) {
+        return false;
+    }
+
+    slot = find_slot(map, key, hash_key(key));
+
+    if (slot->key == NULL || slot->key == tombstone) {
+        return false;
+    }
+
+    if (value != NULL) {
+        *value = slot->value;
+    }
+
+    return true;
+}
+
+/* Return the value for key, or NULL if it is not in the map */
+void *hashmap_get(const hashmap_t *map, const char *key)
+{
+    void *value = NULL;
+
+    if (!hashmap_find(map, key, &value)) {
+        return NULL;
+    }
+
+    return value;
+}
+
+/*
+ * Remove key from the map.  Returns true if it was there.  The memory
+ * for the key stays with the map until hashmap_free().
+ */
+bool hashmap_remove(hashmap_t *map, const char *key)
+{
+    struct hashmap_slot *slot = NULL;
+
+    if (map == NULL || key == NULL) {
+        return false;
+    }
+
+    slot = find_slot(map, key, hash_key(key));
+
+    if (slot->key == NULL || slot->key == tombstone) {
+        return false;
+    }
+
+    slot->key = tombstone;
+    slot->value = NULL;
+    map->count--;
+    return true;
+}
+
+size_t hashmap_count(const hashmap_t *map)
+{
+    return (map == NULL) ? 0 : map->count;
+}
+
+/*
+ * Iterate over the map in no particular order.  Start with *iter set
+ * to 0 and call until this returns false.  key and value may be NULL.
+ * Entries may be removed while iterating but not added.
+ */
+bool hashmap_next(const hashmap_t *map, size_t *iter, const char **key, void **value)
+{
+    struct hashmap_slot *slot = NULL;
+
+    assert(iter != NULL);
+
+    if (map == NULL) {
+        return false;
+    }
+
+    while (*iter < map->capacity) {
+        slot = &map->slots[(*iter)++];
+
+        if (slot->key == NULL || slot->key == tombstone) {
+            continue;
+        }
+
+        if (key != NULL) {
+            *key = slot->key;
+        }
+
+        if (value != NULL) {
+            *value = slot->value;
+        }
+
+        return true;
+    }
+
+    return false;
+}
@@ -21,7 +21,6 @@
 #include <string.h>
 #include <limits.h>
 #include <assert.h>
-#include <search.h>
 #include <iniparser.h>
 #include "rpminspect.h"
 
@@ -106,14 +105,12 @@ static void parse_list(const char *tmp, string_list_t **list)
  * We use these for the jvm_table and products, maybe other things.
  */
 static void read_mapping(const dictionary *cfg, const char *section,
-                         struct hsearch_data **table, string_list_t **keys)
+                         hashmap_t **table, string_list_t **keys)
 {
     size_t len = 0;
     int nk = 0;
     const char **k = NULL;
     const char *v = NULL;
-    ENTRY e;
-    ENTRY *eptr;
     string_entry_t *entry = NULL;
 
     assert(cfg != NULL);
@@ -142,22 +139,10 @@ static void read_mapping(const dictionary *cfg, const char *section,
     if (nk > 0) {
         free_mapping(*table, *keys);
 
-        *table = calloc(1, sizeof(**table));
-        assert(*table != NULL);
-
-        if (hcreate_r(nk, *table) == 0) {
-            free(*table);
-            *table = NULL;
-#if _INIPARSER == 4
-            free(k);
-            k = NULL;
-#endif
-            nk = 0;
-        } else {
-            *keys = calloc(1, sizeof(**keys));
-            assert(*keys != NULL);
-            TAILQ_INIT(*keys);
-        }
+        *table = hashmap_new(nk);
+        *keys = calloc(1, sizeof(**keys));
+        assert(*keys != NULL);
+        TAILQ_INIT(*keys);
     }
 
     while (nk > 0) {
@@ -179,9 +164,7 @@ static void read_mapping(const dictionary *cfg, const char *section,
         entry->data = strdup((char *) k[nk - 1] + len + 1);
         TAILQ_INSERT_TAIL(*keys, entry, items);
 
-        e.key = entry->data;
-        e.data = strdup((char *) v);
-        hsearch_r(e, ENTER, &eptr, *table);
+        hashmap_put(*table, entry->data, strdup(v));
         nk--;
     }
 
@@ -349,11 +332,44 @@ static int read_cfgfile(dictionary *cfg, struct rpminspect *ri, const char *file
             ri->workdir = strdup(tmp);
         }
 
+        tmp = iniparser_getstring(cfg, "common:analysis_cache", NULL);
+        if (tmp) {
+            free(ri->analysis_cache);
+            ri->analysis_cache = strdup(tmp);
+        }
+
+        tmp = iniparser_getstring(cfg, "common:analysis_cache_size", NULL);
+        if (tmp) {
+            ri->analysis_cache_size = strtoull(tmp, NULL, 10) * 1024 * 1024;
+        }
+
         tmp = iniparser_getstring(cfg, "common:profiledir", NULL);
         if (tmp) {
             free(ri->profiledir);
             ri->profiledir = strdup(tmp);
         }
+
+        tmp = iniparser_getstring(cfg, "common:command_timeout", NULL);
+        if (tmp) {
+            ri->command_timeout = strtoul(tmp, NULL, 10);
+        }
+
+        tmp = iniparser_getstring(cfg, "common:extract_jobs", NULL);
+        if (tmp) {
+            ri->extract_jobs = strtoul(tmp, NULL, 10);
+        }
+
+        tmp = iniparser_getstring(cfg, "common:verify_digests", NULL);
+        if (tmp) {
+            if (!strcasecmp(tmp, "on")) {
+                ri->verify_digests = true;
+            } else if (!strcasecmp(tmp, "off")) {
+                ri->verify_digests = false;
+            } else {
+                fprintf(stderr, _("*** Invalid [common] line: verify_digests = %s (ignoring)\n"), tmp);
+                fflush(stderr);
+            }
+        }
     }
 
     tmp = iniparser_getstring(cfg, "koji:hub", NULL);
@@ -374,6 +390,27 @@ static int read_cfgfile(dictionary *cfg, struct rpminspect *ri, const char *file
         ri->kojimbs = strdup(tmp);
     }
 
+    tmp = iniparser_getstring(cfg, "koji:download_jobs", NULL);
+    if (tmp) {
+        ri->download_jobs = strtoul(tmp, NULL, 10);
+    }
+
+    tmp = iniparser_getstring(cfg, "koji:download_retries", NULL);
+    if (tmp) {
+        ri->download_retries = strtoul(tmp, NULL, 10);
+    }
+
+    tmp = iniparser_getstring(cfg, "koji:download_cache", NULL);
+    if (tmp) {
+        free(ri->download_cache);
+        ri->download_cache = strdup(tmp);
+    }
+
+    tmp = iniparser_getstring(cfg, "koji:download_cache_size", NULL);
+    if (tmp) {
+        ri->download_cache_size = strtoull(tmp, NULL, 10) * 1024 * 1024;
+    }
+
     tmp = iniparser_getstring(cfg, "vendor:vendor_data_dir", NULL);
     if (tmp) {
         free(ri->vendor_data_dir);
@@ -839,6 +876,16 @@ int init_rpminspect(struct rpminspect *ri, const char *cfgfile, const char *prof
     ri->favor_release = FAVOR_NONE;
     ri->stat_whitelist = NULL;
     ri->tests = ~0;
+    ri->jobs = 1;
+    ri->busy_jobs = 0;
+    ri->extract_jobs = 0;
+    ri->verify_digests = false;
+    ri->download_jobs = DOWNLOAD_JOBS;
+    ri->download_retries = DOWNLOAD_RETRIES;
+    ri->download_cache = NULL;
+    ri->download_cache_size = DOWNLOAD_CACHE_SIZE * 1024ULL * 1024ULL;
+    ri->analysis_cache_size = ANALYSIS_CACHE_SIZE * 1024ULL * 1024ULL;
+    ri->command_timeout = CMD_TIMEOUT;
     ri->badwords = NULL;
     ri->vendor = NULL;
     ri->buildhost_subdomain = NULL;
@@ -864,6 +911,10 @@ int init_rpminspect(struct rpminspect *ri, const char *cfgfile, const char *prof
     ri->specmatch = MATCH_FULL;
     ri->specprimary = PRIMARY_NAME;
 
+    if (!init_magic_cookies(ri)) {
+        return -1;
+    }
+
     /* Store full path to the config file */
     ri->cfgfile = realpath(cfgfile, NULL);
 
@@ -906,8 +957,11 @@ int init_rpminspect(struct rpminspect *ri, const char *cfgfile, const char *prof
     ri->buildtype = KOJI_BUILD_RPM;
     ri->peers = init_rpmpeer();
     ri->header_cache = NULL;
+    ri->header_index = NULL;
+    ri->ts = NULL;
     ri->worksubdir = NULL;
     ri->results = NULL;
+    ri->results_sink = NULL;
     ri->threshold = RESULT_VERIFY;
     ri->worst_result = RESULT_OK;
     ri->product_release = NULL;
@@ -19,7 +19,13 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include <sys/queue.h>
+#include <sys/stat.h>
 
 #include "rpminspect.h"
 #include "inspect.h"
@@ -34,44 +40,85 @@ bool debug_mode = false;
  */
 
 struct inspect inspections[] = {
-    { INSPECT_LICENSE, "license", true, &inspect_license },
-    { INSPECT_EMPTYRPM, "emptyrpm", true, &inspect_emptyrpm },
-    { INSPECT_METADATA, "metadata", true, &inspect_metadata },
-    { INSPECT_MANPAGE, "manpage", true, &inspect_manpage },
-    { INSPECT_XML, "xml", true, &inspect_xml },
-    { INSPECT_ELF, "elf", true, &inspect_elf },
-    { INSPECT_DESKTOP, "desktop", true, &inspect_desktop },
-    { INSPECT_DISTTAG, "disttag", true, &inspect_disttag },
-    { INSPECT_SPECNAME, "specname", true, &inspect_specname },
-    { INSPECT_MODULARITY, "modularity", true, &inspect_modularity },
-    { INSPECT_JAVABYTECODE, "javabytecode", true, &inspect_javabytecode },
-    { INSPECT_CHANGEDFILES, "changedfiles", false, &inspect_changedfiles },
-    { INSPECT_REMOVEDFILES, "removedfiles", false, &inspect_removedfiles },
-    { INSPECT_ADDEDFILES, "addedfiles", false, &inspect_addedfiles },
-    { INSPECT_UPSTREAM, "upstream", false, &inspect_upstream },
-    { INSPECT_OWNERSHIP, "ownership", true, &inspect_ownership },
-    { INSPECT_SHELLSYNTAX, "shellsyntax", true, &inspect_shellsyntax },
-    { INSPECT_ANNOCHECK, "annocheck", true, &inspect_annocheck },
-    { INSPECT_DT_NEEDED, "DT_NEEDED", false, &inspect_dt_needed },
-    { INSPECT_FILESIZE, "filesize", false, &inspect_filesize },
-    { INSPECT_PERMISSIONS, "permissions", false, &inspect_permissions },
-    { INSPECT_CAPABILITIES, "capabilities", true, &inspect_capabilities },
-    { INSPECT_KMOD, "kmod", false, &inspect_kmod },
-    { INSPECT_ARCH, "arch", false, &inspect_arch },
-    { INSPECT_SUBPACKAGES, "subpackages", false, &inspect_subpackages },
-    { INSPECT_CHANGELOG, "changelog", false, &inspect_changelog },
+    { INSPECT_LICENSE, "license", true, 0, true, &inspect_license },
+    { INSPECT_EMPTYRPM, "emptyrpm", true, NEEDS_PAYLOAD, true, &inspect_emptyrpm },
+    { INSPECT_METADATA, "metadata", true, 0, true, &inspect_metadata },
+    { INSPECT_MANPAGE, "manpage", true, NEEDS_PAYLOAD, true, &inspect_manpage },
+    { INSPECT_XML, "xml", true, NEEDS_PAYLOAD, true, &inspect_xml },
+    { INSPECT_ELF, "elf", true, NEEDS_PAYLOAD, true, &inspect_elf },
+    { INSPECT_DESKTOP, "desktop", true, NEEDS_PAYLOAD, true, &inspect_desktop },
+    { INSPECT_DISTTAG, "disttag", true, NEEDS_PAYLOAD, true, &inspect_disttag },
+    { INSPECT_SPECNAME, "specname", true, NEEDS_PAYLOAD, true, &inspect_specname },
+    { INSPECT_MODULARITY, "modularity", true, NEEDS_PAYLOAD, true, &inspect_modularity },
+    { INSPECT_JAVABYTECODE, "javabytecode", true, NEEDS_PAYLOAD, false, &inspect_javabytecode },
+    { INSPECT_CHANGEDFILES, "changedfiles", false, NEEDS_PAYLOAD, true, &inspect_changedfiles },
+    { INSPECT_REMOVEDFILES, "removedfiles", false, NEEDS_PAYLOAD, true, &inspect_removedfiles },
+    { INSPECT_ADDEDFILES, "addedfiles", false, NEEDS_PAYLOAD, false, &inspect_addedfiles },
+    { INSPECT_UPSTREAM, "upstream", false, NEEDS_PAYLOAD, true, &inspect_upstream },
+    { INSPECT_OWNERSHIP, "ownership", true, NEEDS_PAYLOAD, true, &inspect_ownership },
+    { INSPECT_SHELLSYNTAX, "shellsyntax", true, NEEDS_PAYLOAD, true, &inspect_shellsyntax },
+    { INSPECT_ANNOCHECK, "annocheck", true, NEEDS_PAYLOAD, true, &inspect_annocheck },
+    { INSPECT_DT_NEEDED, "DT_NEEDED", false, NEEDS_PAYLOAD, true, &inspect_dt_needed },
+    { INSPECT_FILESIZE, "filesize", false, NEEDS_PAYLOAD, true, &inspect_filesize },
+    { INSPECT_PERMISSIONS, "permissions", false, NEEDS_PAYLOAD, false, &inspect_permissions },
+    { INSPECT_CAPABILITIES, "capabilities", true, NEEDS_PAYLOAD, false, &inspect_capabilities },
+    { INSPECT_KMOD, "kmod", false, NEEDS_PAYLOAD, true, &inspect_kmod },
+    { INSPECT_ARCH, "arch", false, 0, true, &inspect_arch },
+    { INSPECT_SUBPACKAGES, "subpackages", false, 0, true, &inspect_subpackages },
+    { INSPECT_CHANGELOG, "changelog", false, 0, true, &inspect_changelog },
+    { INSPECT_MOVEDFILES, "movedfiles", false, NEEDS_PAYLOAD, true, &inspect_movedfiles },
 
     /*
      * { INSPECT_TYPE (add to inspect.h),
      *   "short name",
      *   bool--true if for single build, false is before&after required,
+     *   NEEDS_PAYLOAD if the inspection reads the payload, else 0,
+     *   bool--true if it can run alongside other inspections,
      *   &function_pointer,
      *   "Long description string" },
      */
 
-    { 0, NULL, false, NULL }
+    { 0, NULL, false, 0, false, NULL }
 };
 
+/*
+ * Threads started by run_inspections() and foreach_peer_file_select()
+ * come out of one budget of ri->jobs - 1 threads on top of the calling
+ * thread, counted in ri->busy_jobs.  Nested parallel loops share it,
+ * so there are never more than ri->jobs threads inspecting at once.
+ */
+static pthread_mutex_t jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Take up to want threads from the budget, returns how many were taken */
+static unsigned int take_jobs(struct rpminspect *ri, unsigned int want)
+{
+    unsigned int n = 0;
+
+    pthread_mutex_lock(&jobs_lock);
+
+    if (ri->jobs > ri->busy_jobs + 1) {
+        n = ri->jobs - ri->busy_jobs - 1;
+    }
+
+    if (n > want) {
+        n = want;
+    }
+
+    ri->busy_jobs += n;
+    pthread_mutex_unlock(&jobs_lock);
+    return n;
+}
+
+/* Give threads back to the budget */
+static void return_jobs(struct rpminspect *ri, unsigned int n)
+{
+    pthread_mutex_lock(&jobs_lock);
+    assert(ri->busy_jobs >= n);
+    ri->busy_jobs -= n;
+    pthread_mutex_unlock(&jobs_lock);
+    return;
+}
+
 /*
  * Inspect each "after" file in each peer of an inspection.
  * If the foreach_peer_file_func returns false for any file, the
@@ -104,6 +151,536 @@ bool foreach_peer_file(struct rpminspect *ri, foreach_peer_file_func check_fn)
     return result;
 }
 
+/*
+ * Work shared by the threads running foreach_peer_file_parallel().
+ * Files are numbered in the order foreach_peer_file() visits them
+ * and each file gets its own results_t.  As soon as a file and every
+ * file before it are done, their results are merged in to target,
+ * the list the caller was adding results to, so results are not held
+ * back until the last file is checked.
+ */
+struct peer_file_work {
+    struct rpminspect *ri;
+    foreach_peer_file_func check_fn;
+    pthread_t *threads;        /* started by the calling thread */
+    unsigned int nthreads;
+    unsigned int maxthreads;
+    rpmfile_entry_t **files;
+    results_t **results;
+    results_t *target;
+    bool *passed;
+    bool *done;
+    size_t nfiles;
+    size_t next;
+    size_t merged;             /* files before this one are merged */
+    bool result;
+    pthread_mutex_t lock;
+};
+
+/*
+ * Merge the results of the finished files that no unfinished file
+ * comes before.  Call with work->lock held.
+ */
+static void flush_peer_files(struct peer_file_work *work)
+{
+    results_t *prev = NULL;
+
+    prev = set_thread_results(work->target);
+
+    while (work->merged < work->nfiles && work->done[work->merged]) {
+        merge_results(work->ri, work->results[work->merged]);
+        work->results[work->merged] = NULL;
+
+        if (!work->passed[work->merged]) {
+            work->result = false;
+        }
+
+        work->merged++;
+    }
+
+    set_thread_results(prev);
+    return;
+}
+
+static void *peer_file_worker(void *);
+
+/*
+ * Start more threads for the files if the budget has room, as it does
+ * once other inspections finish.  Only the calling thread does this.
+ */
+static void add_peer_file_threads(struct peer_file_work *work)
+{
+    unsigned int n;
+
+    n = take_jobs(work->ri, work->maxthreads - work->nthreads);
+
+    while (n > 0) {
+        if (pthread_create(&work->threads[work->nthreads], NULL, peer_file_worker, work) != 0) {
+            fprintf(stderr, _("*** Unable to start inspection thread, continuing with %u\n"), work->nthreads + 1);
+            fflush(stderr);
+            return_jobs(work->ri, n);
+            work->maxthreads = work->nthreads;
+            break;
+        }
+
+        work->nthreads++;
+        n--;
+    }
+
+    return;
+}
+
+/*
+ * Check files until there are none left.  Each thread takes the next
+ * unchecked file, so threads that land on cheap files just pick up
+ * more of them.  owner is set for the calling thread, which also
+ * starts more threads as the budget allows.
+ */
+static void check_peer_files(struct peer_file_work *work, bool owner)
+{
+    results_t *prev = NULL;
+    size_t i;
+
+    while (1) {
+        if (owner && work->nthreads < work->maxthreads) {
+            add_peer_file_threads(work);
+        }
+
+        pthread_mutex_lock(&work->lock);
+        i = work->next++;
+        pthread_mutex_unlock(&work->lock);
+
+        if (i >= work->nfiles) {
+            break;
+        }
+
+        work->results[i] = init_results();
+        prev = set_thread_results(work->results[i]);
+        work->passed[i] = work->check_fn(work->ri, work->files[i]);
+        set_thread_results(prev);
+
+        pthread_mutex_lock(&work->lock);
+        work->done[i] = true;
+        flush_peer_files(work);
+        pthread_mutex_unlock(&work->lock);
+    }
+
+    return;
+}
+
+/* Thread body for foreach_peer_file_parallel() */
+static void *peer_file_worker(void *arg)
+{
+    struct peer_file_work *work = arg;
+
+    assert(work != NULL);
+    check_peer_files(work, false);
+    return_jobs(work->ri, 1);
+    return NULL;
+}
+
+/*
+ * Collect the after files foreach_peer_file_select() visits, in list
+ * order, into files (if not NULL).  Returns how many there are.
+ * Lists without a file table are walked instead.
+ */
+static size_t select_peer_files(const struct rpminspect *ri, mode_t fmt, bool peered, rpmfile_entry_t **files)
+{
+    rpmpeer_entry_t *peer;
+    rpmfile_entry_t *file;
+    const file_table_t *table;
+    uint32_t *rows = NULL;
+    unsigned int nrows;
+    unsigned int j;
+    size_t n = 0;
+
+    TAILQ_FOREACH(peer, ri->peers, items) {
+        if (peer->after_files == NULL) {
+            continue;
+        }
+
+        if ((table = peer->after_files->table) != NULL) {
+            rows = realloc(rows, (table->count + 1) * sizeof(*rows));
+            assert(rows != NULL);
+            nrows = select_files(table, fmt, peered, rows);
+
+            for (j = 0; files != NULL && j < nrows; j++) {
+                files[n + j] = table->entries[rows[j]];
+            }
+
+            n += nrows;
+            continue;
+        }
+
+        TAILQ_FOREACH(file, peer->after_files, items) {
+            if ((fmt == 0 || (file->st.st_mode & S_IFMT) == (fmt & S_IFMT)) &&
+                (!peered || file->peer_file != NULL)) {
+                if (files != NULL) {
+                    files[n] = file;
+                }
+
+                n++;
+            }
+        }
+    }
+
+    free(rows);
+    return n;
+}
+
+/*
+ * Same as foreach_peer_file(), but spread the files across up to
+ * ri->jobs threads, as many as the inspections running alongside
+ * leave free.  Results are reported in the same order foreach_peer_file()
+ * would have reported them, each file's as soon as the files before
+ * it are done.
+ *
+ * Only use this with check functions that are safe to run
+ * concurrently: no static state and no changes to anything in ri.
+ * Lazily computed rpmfile_entry_t members should be read through
+ * checksum(), get_mime_type(), and get_cap().
+ */
+bool foreach_peer_file_parallel(struct rpminspect *ri, foreach_peer_file_func check_fn)
+{
+    return foreach_peer_file_select(ri, 0, false, check_fn);
+}
+
+/*
+ * Same as foreach_peer_file_parallel(), but only for the after files
+ * of type fmt (S_IFREG and so on, or 0 for any type) that also have a
+ * peer if peered is set.  The files are picked out with the file
+ * tables, without reading the entries that are skipped.  Use it for
+ * check functions that ignore every other file anyway.
+ */
+bool foreach_peer_file_select(struct rpminspect *ri, mode_t fmt, bool peered, foreach_peer_file_func check_fn)
+{
+    struct peer_file_work work;
+    unsigned int t;
+    size_t i;
+    bool result = true;
+
+    assert(ri != NULL);
+    assert(check_fn != NULL);
+
+    if (ri->jobs <= 1 && fmt == 0 && !peered) {
+        return foreach_peer_file(ri, check_fn);
+    }
+
+    /* Flatten the peer file lists in the order we would walk them */
+    memset(&work, 0, sizeof(work));
+    work.ri = ri;
+    work.check_fn = check_fn;
+    work.nfiles = select_peer_files(ri, fmt, peered, NULL);
+
+    if (work.nfiles == 0) {
+        return true;
+    }
+
+    work.files = calloc(work.nfiles, sizeof(*work.files));
+    assert(work.files != NULL);
+    select_peer_files(ri, fmt, peered, work.files);
+
+    if (ri->jobs <= 1 || work.nfiles < 2) {
+        for (i = 0; i < work.nfiles; i++) {
+            if (!check_fn(ri, work.files[i])) {
+                result = false;
+            }
+        }
+
+        free(work.files);
+        return result;
+    }
+
+    work.results = calloc(work.nfiles, sizeof(*work.results));
+    assert(work.results != NULL);
+    work.passed = calloc(work.nfiles, sizeof(*work.passed));
+    assert(work.passed != NULL);
+    work.done = calloc(work.nfiles, sizeof(*work.done));
+    assert(work.done != NULL);
+    work.result = true;
+
+    /* results go where add_result() on this thread would put them */
+    work.target = set_thread_results(NULL);
+    set_thread_results(work.target);
+
+    pthread_mutex_init(&work.lock, NULL);
+
+    /* The calling thread does its share of the work too */
+    work.maxthreads = ri->jobs - 1;
+
+    if (work.maxthreads > work.nfiles - 1) {
+        work.maxthreads = work.nfiles - 1;
+    }
+
+    work.threads = calloc(work.maxthreads, sizeof(*work.threads));
+    assert(work.threads != NULL);
+
+    check_peer_files(&work, true);
+
+    for (t = 0; t < work.nthreads; t++) {
+        pthread_join(work.threads[t], NULL);
+    }
+
+    pthread_mutex_destroy(&work.lock);
+    assert(work.merged == work.nfiles);
+
+    free(work.threads);
+    free(work.files);
+    free(work.results);
+    free(work.passed);
+    free(work.done);
+
+    return work.result;
+}
+
+/*
+ * Return true if inspection i from the inspections[] array should run.
+ */
+static bool is_inspection_selected(const struct rpminspect *ri, const size_t i)
+{
+    /* test not selected by user */
+    if (!(ri->tests & inspections[i].flag)) {
+        return false;
+    }
+
+    /* inspection requires before/after builds and we have one */
+    if (ri->before == NULL && !inspections[i].single_build) {
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Work shared by the threads started in run_inspections().  The queue
+ * holds indexes into inspections[] in the order they should start.
+ * results, passed, and done are indexed like inspections[], and the
+ * results of an inspection are merged in to target once it and every
+ * inspection listed before it are done.
+ */
+struct inspection_work {
+    struct rpminspect *ri;
+    size_t *queue;
+    size_t nqueue;
+    size_t next;
+    size_t ninspections;
+    results_t **results;
+    results_t *target;
+    bool *passed;
+    bool *done;
+    size_t merged;             /* inspections before this one are merged */
+    bool result;
+    pthread_mutex_t lock;
+};
+
+/*
+ * Merge the results of the finished inspections that no unfinished
+ * inspection is listed before.  Call with work->lock held.
+ */
+static void flush_inspections(struct inspection_work *work)
+{
+    results_t *prev = NULL;
+
+    prev = set_thread_results(work->target);
+
+    while (work->merged < work->ninspections && work->done[work->merged]) {
+        merge_results(work->ri, work->results[work->merged]);
+        work->results[work->merged] = NULL;
+
+        if (!work->passed[work->merged]) {
+            work->result = false;
+        }
+
+        work->merged++;
+    }
+
+    set_thread_results(prev);
+    return;
+}
+
+/* Run inspection i with its own results list and merge what can be */
+static void run_inspection(struct inspection_work *work, size_t i)
+{
+    results_t *prev = NULL;
+
+    DEBUG_PRINT("starting %s\n", inspections[i].name);
+    prev = set_thread_results(work->results[i]);
+    work->passed[i] = inspections[i].driver(work->ri);
+    set_thread_results(prev);
+    DEBUG_PRINT("finished %s\n", inspections[i].name);
+
+    pthread_mutex_lock(&work->lock);
+    work->done[i] = true;
+    flush_inspections(work);
+    pthread_mutex_unlock(&work->lock);
+    return;
+}
+
+/*
+ * Thread body for run_inspections().  Take the next inspection off
+ * the queue until it is empty.
+ */
+static void *inspection_worker(void *arg)
+{
+    struct inspection_work *work = arg;
+    size_t i;
+
+    assert(work != NULL);
+
+    while (1) {
+        pthread_mutex_lock(&work->lock);
+        i = work->next++;
+        pthread_mutex_unlock(&work->lock);
+
+        if (i >= work->nqueue) {
+            break;
+        }
+
+        run_inspection(work, work->queue[i]);
+    }
+
+    return NULL;
+}
+
+/* Thread body for run_inspections() */
+static void *inspection_thread(void *arg)
+{
+    struct inspection_work *work = arg;
+
+    inspection_worker(work);
+    return_jobs(work->ri, 1);
+    return NULL;
+}
+
+/*
+ * Run all of the selected inspections.
+ *
+ * With one job the inspections run in the order they are listed in
+ * inspections[].  With more than one job, the inspections that are
+ * not thread_safe first run one at a time on the calling thread.
+ * Then the thread_safe ones run on up to ri->jobs threads at once.
+ * The queue has two parts: those reading the payload (NEEDS_PAYLOAD)
+ * are started first since they take the longest, and the header-only
+ * ones fill in around them.  Threads that run out of inspections go
+ * back to the budget for the per-file loops of those still running.
+ *
+ * Each inspection collects its results separately and they are added
+ * to ri->results in inspections[] order, so the output is the same
+ * no matter how the work was scheduled.  An inspection's results are
+ * passed on as soon as every inspection listed before it is done.
+ *
+ * Returns true if every inspection passed.
+ */
+bool run_inspections(struct rpminspect *ri)
+{
+    struct inspection_work work;
+    pthread_t *threads = NULL;
+    unsigned int nthreads = 0;
+    unsigned int n;
+    unsigned int t;
+    size_t i;
+    bool result = true;
+
+    assert(ri != NULL);
+
+    if (ri->jobs <= 1) {
+        for (i = 0; inspections[i].flag != 0; i++) {
+            if (is_inspection_selected(ri, i) && !inspections[i].driver(ri)) {
+                result = false;
+            }
+        }
+
+        return result;
+    }
+
+    memset(&work, 0, sizeof(work));
+    work.ri = ri;
+    work.result = true;
+
+    for (i = 0; inspections[i].flag != 0; i++) {
+        work.ninspections++;
+    }
+
+    work.queue = calloc(work.ninspections, sizeof(*work.queue));
+    assert(work.queue != NULL);
+    work.results = calloc(work.ninspections, sizeof(*work.results));
+    assert(work.results != NULL);
+    work.passed = calloc(work.ninspections, sizeof(*work.passed));
+    assert(work.passed != NULL);
+    work.done = calloc(work.ninspections, sizeof(*work.done));
+    assert(work.done != NULL);
+
+    /* results go where add_result() on this thread would put them */
+    work.target = set_thread_results(NULL);
+    set_thread_results(work.target);
+
+    /* Payload inspections go first, then header-only ones */
+    for (i = 0; i < work.ninspections; i++) {
+        work.passed[i] = true;
+
+        if (!is_inspection_selected(ri, i)) {
+            work.done[i] = true;
+            continue;
+        }
+
+        work.results[i] = init_results();
+
+        if (inspections[i].thread_safe && (inspections[i].needs & NEEDS_PAYLOAD)) {
+            work.queue[work.nqueue++] = i;
+        }
+    }
+
+    for (i = 0; i < work.ninspections; i++) {
+        if (work.results[i] != NULL && inspections[i].thread_safe && !(inspections[i].needs & NEEDS_PAYLOAD)) {
+            work.queue[work.nqueue++] = i;
+        }
+    }
+
+    pthread_mutex_init(&work.lock, NULL);
+
+    /* These run by themselves, before any threads are started */
+    for (i = 0; i < work.ninspections; i++) {
+        if (work.results[i] != NULL && !inspections[i].thread_safe) {
+            run_inspection(&work, i);
+        }
+    }
+
+    /* The calling thread takes from the queue too */
+    if (work.nqueue > 1) {
+        n = take_jobs(ri, work.nqueue - 1);
+        threads = calloc(n + 1, sizeof(*threads));
+        assert(threads != NULL);
+
+        for (t = 0; t < n; t++) {
+            if (pthread_create(&threads[t], NULL, inspection_thread, &work) != 0) {
+                fprintf(stderr, _("*** Unable to start inspection thread, continuing with %u\n"), nthreads + 1);
+                fflush(stderr);
+                return_jobs(ri, n - t);
+                break;
+            }
+
+            nthreads++;
+        }
+    }
+
+    inspection_worker(&work);
+
+    for (t = 0; t < nthreads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    pthread_mutex_destroy(&work.lock);
+    assert(work.merged == work.ninspections);
+
+    free(threads);
+    free(work.queue);
+    free(work.results);
+    free(work.passed);
+    free(work.done);
+
+    return work.result;
+}
+
 /*
  * Return the long description for the specified inspection.
  */
@@ -162,6 +739,8 @@ const char *inspection_desc(const uint64_t inspection)
             return _("Report RPM subpackages that appear and disappear between the before and after builds.");
         case INSPECT_CHANGELOG:
             return _("Ensure packages contain an entry in the %changelog for the version built.  Reports any other differences in the existing changelog between builds and that the new entry contains new text entries.");
+        case INSPECT_MOVEDFILES:
+            return _("Report files that moved to a different subpackage between the before and after builds.  Files are matched by path and then by content, within the same architecture or from an architecture specific subpackage to a noarch one.  Moved files are compared by the other inspections and are not reported as removed and added.");
         default:
             return NULL;
     }
@@ -47,6 +47,9 @@
 /* inspect.c */
 typedef bool (*foreach_peer_file_func)(struct rpminspect *, rpmfile_entry_t *);
 bool foreach_peer_file(struct rpminspect *, foreach_peer_file_func);
+bool foreach_peer_file_parallel(struct rpminspect *, foreach_peer_file_func);
+bool foreach_peer_file_select(struct rpminspect *, mode_t, bool, foreach_peer_file_func);
+bool run_inspections(struct rpminspect *);
 const char *inspection_desc(const uint64_t);
 
 /* inspect_elf.c */
@@ -144,6 +147,9 @@ bool inspect_subpackages(struct rpminspect *);
 /* inspect_changelog.c */
 bool inspect_changelog(struct rpminspect *);
 
+/* inspect_movedfiles.c */
+bool inspect_movedfiles(struct rpminspect *);
+
 /*
  * Inspections are referenced by flag.  These flags are set in bitfields
  * to indicate which ones we want to run.  When adding new ones, please
@@ -178,5 +184,13 @@ bool inspect_changelog(struct rpminspect *);
 #define INSPECT_ARCH                        (((uint64_t) 1) << 24)
 #define INSPECT_SUBPACKAGES                 (((uint64_t) 1) << 25)
 #define INSPECT_CHANGELOG                   (((uint64_t) 1) << 26)
+#define INSPECT_MOVEDFILES                  (((uint64_t) 1) << 27)
+
+/*
+ * What an inspection reads, set in the needs member of struct
+ * inspect.  Inspections without it only read the RPM headers.
+ */
+
+#define NEEDS_PAYLOAD                       (1 << 1)    /* extracted files */
 
 #endif
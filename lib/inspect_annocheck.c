@@ -17,6 +17,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
@@ -28,14 +29,20 @@ static bool annocheck_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     bool result = true;
     const char *arch = NULL;
     string_entry_t *entry = NULL;
-    ENTRY e;
-    ENTRY *eptr;
+    char *opts = NULL;
     char *after_out = NULL;
     int after_exit;
     char *before_out = NULL;
     int before_exit;
     char *msg = NULL;
     severity_t severity = RESULT_INFO;
+    char *cmd = NULL;
+    runcmd_t *cmds = NULL;
+    const char **tests = NULL;
+    size_t nkeys = 0;
+    size_t ntests = 0;
+    size_t stride;
+    size_t i;
 
     assert(ri != NULL);
     assert(file != NULL);
@@ -49,43 +56,73 @@ static bool annocheck_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     arch = get_rpm_header_arch(file->rpm_header);
 
     /* Only run this check on ELF files */
-    if (!is_elf(file->fullpath) || (!is_elf(file->fullpath) && file->peer_file && !is_elf(file->peer_file->fullpath))) {
+    if (get_elf_info(file) == NULL) {
         return result;
     }
 
-    /* Run each annocheck test and report the results */
+    /* Count the tests so every command can be started at once */
+    TAILQ_FOREACH(entry, ri->annocheck_keys, items) {
+        nkeys++;
+    }
+
+    if (nkeys == 0) {
+        return result;
+    }
+
+    /* Each test runs on the file and, if there is one, its peer */
+    stride = file->peer_file ? 2 : 1;
+    cmds = calloc(nkeys * stride, sizeof(*cmds));
+    assert(cmds != NULL);
+    tests = calloc(nkeys, sizeof(*tests));
+    assert(tests != NULL);
+
     TAILQ_FOREACH(entry, ri->annocheck_keys, items) {
         /* Get the command options for this test */
-        e.key = entry->data;
-        hsearch_r(e, FIND, &eptr, ri->annocheck_table);
+        opts = hashmap_get(ri->annocheck_table, entry->data);
 
-        if (eptr == NULL) {
+        if (opts == NULL) {
             continue;
         }
 
-        /* Run the test on the file */
-        after_out = run_cmd(&after_exit, ANNOCHECK_CMD, (char *) eptr->data, file->fullpath, NULL);
+        xasprintf(&cmd, "%s %s", ANNOCHECK_CMD, opts);
+        cmds[ntests * stride].argv = build_argv(cmd, file->fullpath, NULL);
 
-        /* If we have a before build, run the command on that */
         if (file->peer_file) {
-            before_out = run_cmd(&before_exit, ANNOCHECK_CMD, (char *) eptr->data, file->peer_file->fullpath, NULL);
+            cmds[(ntests * stride) + 1].argv = build_argv(cmd, file->peer_file->fullpath, NULL);
+        }
+
+        free(cmd);
+        tests[ntests++] = entry->data;
+    }
+
+    /* Run all of the tests concurrently */
+    run_cmds(cmds, ntests * stride);
+
+    /* Report the results of each test */
+    for (i = 0; i < ntests; i++) {
+        after_out = cmds[i * stride].output;
+        after_exit = cmds[i * stride].exitcode;
+
+        if (file->peer_file) {
+            before_out = cmds[(i * stride) + 1].output;
+            before_exit = cmds[(i * stride) + 1].exitcode;
         }
 
         /* Build a reporting message if we need to */
         if (before_out && after_out) {
             if (before_exit == 0 && after_exit == 0) {
-                xasprintf(&msg, _("annocheck '%s' test passes for %s on %s"), entry->data, file->localpath, arch);
+                xasprintf(&msg, _("annocheck '%s' test passes for %s on %s"), tests[i], file->localpath, arch);
             } else if (before_exit == 1 && after_exit == 0) {
-                xasprintf(&msg, _("annocheck '%s' test now passes for %s on %s"), entry->data, file->localpath, arch);
+                xasprintf(&msg, _("annocheck '%s' test now passes for %s on %s"), tests[i], file->localpath, arch);
             } else if (before_exit == 0 && after_exit == 1) {
-                xasprintf(&msg, _("annocheck '%s' test now fails for %s on %s"), entry->data, file->localpath, arch);
+                xasprintf(&msg, _("annocheck '%s' test now fails for %s on %s"), tests[i], file->localpath, arch);
                 severity = RESULT_VERIFY;
             }
         } else if (after_out) {
             if (after_exit == 0) {
-                xasprintf(&msg, _("annocheck '%s' test passes for %s on %s"), entry->data, file->localpath, arch);
+                xasprintf(&msg, _("annocheck '%s' test passes for %s on %s"), tests[i], file->localpath, arch);
             } else if (after_exit == 1) {
-                xasprintf(&msg, _("annocheck '%s' test fails for %s on %s"), entry->data, file->localpath, arch);
+                xasprintf(&msg, _("annocheck '%s' test fails for %s on %s"), tests[i], file->localpath, arch);
                 severity = RESULT_VERIFY;
             }
         }
@@ -94,16 +131,22 @@ static bool annocheck_driver(struct rpminspect *ri, rpmfile_entry_t *file)
         if (msg) {
             add_result(ri, severity, WAIVABLE_BY_ANYONE, HEADER_ANNOCHECK, msg, after_out, REMEDY_ANNOCHECK);
             free(msg);
+            msg = NULL;
             result = false;
         }
 
-        /* Cleanup */
-        free(after_out);
-        free(before_out);
-        after_out = NULL;
         before_out = NULL;
     }
 
+    /* Cleanup */
+    for (i = 0; i < ntests * stride; i++) {
+        free_argv(cmds[i].argv);
+        free(cmds[i].output);
+    }
+
+    free(cmds);
+    free(tests);
+
     return result;
 }
 
@@ -121,7 +164,7 @@ bool inspect_annocheck(struct rpminspect *ri) {
     }
 
     /* run the annocheck tests across all ELF files */
-    result = foreach_peer_file(ri, annocheck_driver);
+    result = foreach_peer_file_parallel(ri, annocheck_driver);
 
     /* if everything was fine, just say so */
     if (result) {
@@ -49,13 +49,13 @@ bool inspect_arch(struct rpminspect *ri) {
     TAILQ_FOREACH(peer, ri->peers, items) {
         if (peer->before_hdr) {
             entry = calloc(1, sizeof(*entry));
-            entry->data = strdup(headerGetString(peer->before_hdr, RPMTAG_ARCH));
+            entry->data = (char *) intern(headerGetString(peer->before_hdr, RPMTAG_ARCH));
             TAILQ_INSERT_TAIL(before_arches, entry, items);
         }
 
         if (peer->after_hdr) {
             entry = calloc(1, sizeof(*entry));
-            entry->data = strdup(headerGetString(peer->after_hdr, RPMTAG_ARCH));
+            entry->data = (char *) intern(headerGetString(peer->after_hdr, RPMTAG_ARCH));
             TAILQ_INSERT_TAIL(after_arches, entry, items);
         }
     }
@@ -72,7 +72,7 @@ bool inspect_arch(struct rpminspect *ri) {
             free(msg);
         }
 
-        list_free(lost, free);
+        list_free(lost, NULL);
         result = false;
     }
 
@@ -84,12 +84,12 @@ bool inspect_arch(struct rpminspect *ri) {
             free(msg);
         }
 
-        list_free(gain, free);
+        list_free(gain, NULL);
         result = false;
     }
 
-    list_free(before_arches, free);
-    list_free(after_arches, free);
+    list_free(before_arches, NULL);
+    list_free(after_arches, NULL);
 
     return result;
 }
@@ -20,13 +20,134 @@
 #include <stdbool.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <assert.h>
 
 #include "rpminspect.h"
 
+/*
+ * How the quick content check in changedfiles_driver() settled each
+ * file.  Files found identical here skip MIME detection and the
+ * external comparison tools.  Everything else goes on to the full
+ * comparison.
+ */
+enum {
+    TIER_SAME_DIGEST,     /* identical, both checksums already known */
+    TIER_SAME_BYTES,      /* identical, compared byte for byte */
+    TIER_DIFF_SIZE,       /* sizes differ */
+    TIER_DIFF_CONTENT,    /* same size, different bytes */
+    NUM_TIERS
+};
+
+static size_t tier_counts[NUM_TIERS];
+static pthread_mutex_t tier_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void count_tier(int tier)
+{
+    pthread_mutex_lock(&tier_lock);
+    tier_counts[tier]++;
+    pthread_mutex_unlock(&tier_lock);
+}
+
+/*
+ * Compare two files of the given size byte for byte.  Both are mapped
+ * so nothing is copied.  Returns true only if the files could be read
+ * and are identical.
+ */
+static bool same_bytes(const char *a, const char *b, off_t size)
+{
+    int fda = -1;
+    int fdb = -1;
+    void *mapa = MAP_FAILED;
+    void *mapb = MAP_FAILED;
+    bool ret = false;
+
+    if (size == 0) {
+        return true;
+    }
+
+    if ((fda = open(a, O_RDONLY | O_CLOEXEC)) == -1 || (fdb = open(b, O_RDONLY | O_CLOEXEC)) == -1) {
+        goto done;
+    }
+
+    mapa = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fda, 0);
+    mapb = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fdb, 0);
+
+    if (mapa == MAP_FAILED || mapb == MAP_FAILED) {
+        goto done;
+    }
+
+    (void) madvise(mapa, size, MADV_SEQUENTIAL);
+    (void) madvise(mapb, size, MADV_SEQUENTIAL);
+    ret = (memcmp(mapa, mapb, size) == 0);
+
+done:
+    if (mapa != MAP_FAILED) {
+        munmap(mapa, size);
+    }
+
+    if (mapb != MAP_FAILED) {
+        munmap(mapb, size);
+    }
+
+    if (fda != -1) {
+        close(fda);
+    }
+
+    if (fdb != -1) {
+        close(fdb);
+    }
+
+    return ret;
+}
+
+/*
+ * Cheap check for files whose bytes did not change at all.  Sizes
+ * are compared first, then checksums if both are known without
+ * reading the files, then the contents.  Returns true if the files
+ * are identical.
+ */
+static bool unchanged_content(const struct rpminspect *ri, rpmfile_entry_t *file)
+{
+    const char *before_sum = NULL;
+    const char *after_sum = NULL;
+
+    if (!S_ISREG(file->peer_file->st.st_mode) || file->st.st_size != file->peer_file->st.st_size) {
+        count_tier(TIER_DIFF_SIZE);
+        return false;
+    }
+
+    /*
+     * Prefer known checksums.  Streamed payloads may not have every
+     * byte on disk, but their checksums cover the whole file.
+     */
+    after_sum = known_checksum(ri, file);
+    before_sum = known_checksum(ri, file->peer_file);
+
+    if (before_sum && after_sum) {
+        if (strcmp(before_sum, after_sum)) {
+            count_tier(TIER_DIFF_CONTENT);
+            return false;
+        }
+
+        count_tier(TIER_SAME_DIGEST);
+        return true;
+    }
+
+    if (same_bytes(file->peer_file->fullpath, file->fullpath, file->st.st_size)) {
+        count_tier(TIER_SAME_BYTES);
+        return true;
+    }
+
+    count_tier(TIER_DIFF_CONTENT);
+    return false;
+}
+
 /*
  * Called by changedfiles_driver() to add additional information for
  * files marked as security concerns.
@@ -51,25 +172,21 @@ static void add_changedfiles_result(struct rpminspect *ri, const char *msg, char
 }
 
 /*
- * Runs a command and redirects standard out to a temporary file created
- * in this function.  Caller is responsible for removing the temporary
- * file.
+ * Creates an empty temporary file in the given directory for a command
+ * to write its output to.  Caller is responsible for removing the
+ * temporary file.
  */
-static char *run_and_capture(const char *where, char **output, char *cmd,
-                             const char *fullpath, int *exitcode)
+static bool make_capture_file(const char *where, char **output)
 {
     int fd;
 
     assert(where != NULL);
     assert(output != NULL);
-    assert(cmd != NULL);
-    assert(fullpath != NULL);
-    assert(exitcode != NULL);
 
     /* Build a temporary file */
     xasprintf(output, "%s/output.XXXXXX", where);
 
-    /* Generate them and then close them */
+    /* Generate it and then close it */
     fd = mkstemp(*output);
 
     if (fd == -1) {
@@ -84,8 +201,7 @@ static char *run_and_capture(const char *where, char **output, char *cmd,
         return false;
     }
 
-    /* Run command and return output */
-    return run_cmd(exitcode, cmd, fullpath, ">", *output, NULL);
+    return true;
 }
 
 /*
@@ -95,24 +211,30 @@ static bool changedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
 {
     bool result = true;
     const char *arch = NULL;
-    char *type = NULL;
+    unsigned int type = MIME_NONE;
     char *before_sum = NULL;
     char *after_sum = NULL;
     char *msg = NULL;
     char *errors = NULL;
     char *short_errors = NULL;
     char *skip_line = NULL;
-    char *needle = NULL;
-    char *part_errors = NULL;
-    char *refined_errors = NULL;
+    const elf_info_t *before_elf = NULL;
+    const elf_info_t *after_elf = NULL;
+    string_list_t *elf_diffs = NULL;
+    char *tmp = NULL;
+    FILE *errors_stream = NULL;
+    size_t errors_size = 0;
     int exitcode;
     bool possible_header = false;
     string_entry_t *entry = NULL;
+    const char *prefix = NULL;
     severity_t severity = RESULT_VERIFY;
     waiverauth_t waiver = WAIVABLE_BY_ANYONE;
     char *before_tmp = NULL;
     char *after_tmp = NULL;
     int fd;
+    runcmd_t cmds[2];
+    size_t i;
     char magic[4];
     const char *bv = NULL;
     const char *av = NULL;
@@ -144,11 +266,14 @@ static bool changedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     /* Set the waiver type if this is a file of security concern */
     if (ri->security_path_prefix) {
         TAILQ_FOREACH(entry, ri->security_path_prefix, items) {
-            while (*entry->data != '/') {
-                entry->data++;
+            /* Do not move entry->data, other threads read it too */
+            prefix = entry->data;
+
+            while (*prefix != '/') {
+                prefix++;
             }
 
-            if (strprefix(file->localpath, entry->data)) {
+            if (strprefix(file->localpath, prefix)) {
                 severity = RESULT_BAD;
                 waiver = WAIVABLE_BY_SECURITY;
                 break;
@@ -167,22 +292,27 @@ static bool changedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
         return true;
     }
 
+    /* Nothing to report for identical files, skip the expensive checks */
+    if (unchanged_content(ri, file)) {
+        return true;
+    }
+
     /* The architecture is used in reporting messages */
     arch = get_rpm_header_arch(file->rpm_header);
 
     /* Get the MIME type of the file, will need that */
-    type = get_mime_type(file);
+    type = get_mime_type_id(ri, file);
 
     /* Skip Java class files and JAR files (handled elsewhere) */
-    if ((!strcmp(type, "application/zip") &&
+    if ((type == MIME_ZIP &&
          strsuffix(file->fullpath, JAR_FILENAME_EXTENSION)) ||
-        (!strcmp(type, "application/x-java-applet") &&
+        (type == MIME_JAVA_APPLET &&
          strsuffix(file->fullpath, CLASS_FILENAME_EXTENSION))) {
         return true;
     }
 
     /* Skip Python bytecode files (these always change) */
-    if (!strcmp(type, "application/octet-stream") &&
+    if (type == MIME_OCTET_STREAM &&
         (strsuffix(file->fullpath, PYTHON_PYC_FILE_EXTENSION) ||
          strsuffix(file->fullpath, PYTHON_PYO_FILE_EXTENSION))) {
         /* Double check that this is a Python bytecode file */
@@ -219,30 +349,39 @@ static bool changedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
      * compare the contents.  This will result in a pass even if the
      * compression levels changed between builds.
      */
-    if (!strcmp(type, "application/x-gzip")) {
-        errors = run_cmd(&exitcode, ZCMP_CMD, file->peer_file->fullpath, file->fullpath, NULL);
+    switch (type) {
+        case MIME_GZIP:
+            errors = run_cmd(&exitcode, ZCMP_CMD, file->peer_file->fullpath, file->fullpath, NULL);
+
+            if (exitcode) {
+                xasprintf(&msg, _("Compressed gzip file %s changed content on %s"), file->localpath, arch);
+                add_changedfiles_result(ri, msg, errors, severity, waiver);
+                result = false;
+            }
 
-        if (exitcode) {
-            xasprintf(&msg, _("Compressed gzip file %s changed content on %s"), file->localpath, arch);
-            add_changedfiles_result(ri, msg, errors, severity, waiver);
-            result = false;
-        }
-    } else if (!strcmp(type, "application/x-bzip2")) {
-        errors = run_cmd(&exitcode, BZCMP_CMD, file->peer_file->fullpath, file->fullpath, NULL);
+            break;
+        case MIME_BZIP2:
+            errors = run_cmd(&exitcode, BZCMP_CMD, file->peer_file->fullpath, file->fullpath, NULL);
 
-        if (exitcode) {
-            xasprintf(&msg, _("Compressed bzip2 file %s changed content on %s"), file->localpath, arch);
-            add_changedfiles_result(ri, msg, errors, severity, waiver);
-            result = false;
-        }
-    } else if (!strcmp(type, "application/x-xz")) {
-        errors = run_cmd(&exitcode, XZCMP_CMD, file->peer_file->fullpath, file->fullpath, NULL);
+            if (exitcode) {
+                xasprintf(&msg, _("Compressed bzip2 file %s changed content on %s"), file->localpath, arch);
+                add_changedfiles_result(ri, msg, errors, severity, waiver);
+                result = false;
+            }
 
-        if (exitcode) {
-            xasprintf(&msg, _("Compressed xz file %s changed content on %s"), file->localpath, arch);
-            add_changedfiles_result(ri, msg, errors, severity, waiver);
-            result = false;
-        }
+            break;
+        case MIME_XZ:
+            errors = run_cmd(&exitcode, XZCMP_CMD, file->peer_file->fullpath, file->fullpath, NULL);
+
+            if (exitcode) {
+                xasprintf(&msg, _("Compressed xz file %s changed content on %s"), file->localpath, arch);
+                add_changedfiles_result(ri, msg, errors, severity, waiver);
+                result = false;
+            }
+
+            break;
+        default:
+            break;
     }
 
     if (!result) {
@@ -252,30 +391,35 @@ static bool changedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     /*
      * Compare ELF objects and report any changes.
      */
-    if (!strcmp(type, "application/x-pie-executable") ||
-        !strcmp(type, "application/x-executable") ||
-        !strcmp(type, "application/x-object")) {
-        errors = run_cmd(&exitcode, ELFCMP_CMD, file->peer_file->fullpath, file->fullpath, NULL);
+    if (type == MIME_PIE_EXECUTABLE ||
+        type == MIME_EXECUTABLE ||
+        type == MIME_OBJECT) {
+        before_elf = get_elf_info(file->peer_file);
+        after_elf = get_elf_info(file);
+
+        if (before_elf != NULL && after_elf != NULL) {
+            elf_diffs = compare_elf(before_elf, after_elf);
+        }
 
-        if (exitcode) {
-            /*
-             * Clean up eu-elfcmp results.  Strike the fullpaths and only show
-             * the localpath once.  Keep the eu-elfcmp: prefix.
-             */
-            xasprintf(&needle, _("%s differ:"), file->localpath);
-            part_errors = strstr(errors, needle);
-
-            if (part_errors) {
-                xasprintf(&refined_errors, "eu-elfcmp: %s", part_errors);
-            } else {
-                /* unknown output format from eu-elfcmp */
-                refined_errors = strdup(errors);
+        if (elf_diffs != NULL) {
+            tmp = errors;
+            errors_stream = open_memstream(&errors, &errors_size);
+            assert(errors_stream != NULL);
+
+            if (tmp != NULL) {
+                fputs(tmp, errors_stream);
+                free(tmp);
+            }
+
+            TAILQ_FOREACH(entry, elf_diffs, items) {
+                fprintf(errors_stream, "%s\n", entry->data);
             }
 
+            fclose(errors_stream);
+
             xasprintf(&msg, _("ELF file %s changed content on %s"), file->localpath, arch);
-            add_changedfiles_result(ri, msg, refined_errors, severity, waiver);
-            free(needle);
-            free(refined_errors);
+            add_changedfiles_result(ri, msg, errors, severity, waiver);
+            list_free(elf_diffs, free);
             result = false;
         }
     }
@@ -287,7 +431,7 @@ static bool changedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     /*
      * Compare gettext .mo files and report any changes.
      */
-    if (!strcmp(type, "application/x-gettext-translation") &&
+    if (type == MIME_GETTEXT_TRANSLATION &&
         strsuffix(file->localpath, MO_FILENAME_EXTENSION)) {
         /*
          * This one is somewhat complicated.  We run msgunfmt on the mo files,
@@ -298,25 +442,38 @@ static bool changedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
          * this with a library call or two.
          */
 
-        /* First, unformat the mo files */
-        errors = run_and_capture(ri->workdir, &after_tmp, MSGUNFMT_CMD, file->fullpath, &exitcode);
-
-        if (exitcode) {
-            xasprintf(&msg, _("Error running msgunfmt on %s on %s"), file->localpath, arch);
-            add_result(ri, RESULT_BAD, NOT_WAIVABLE, HEADER_CHANGEDFILES, msg, errors, REMEDY_CHANGEDFILES);
+        /* First, unformat the mo files, both at the same time */
+        if (!make_capture_file(ri->workdir, &after_tmp) || !make_capture_file(ri->workdir, &before_tmp)) {
             result = false;
             goto done;
         }
 
-        errors = run_and_capture(ri->workdir, &before_tmp, MSGUNFMT_CMD, file->peer_file->fullpath, &exitcode);
+        memset(cmds, 0, sizeof(cmds));
+        cmds[0].argv = build_argv(MSGUNFMT_CMD, file->fullpath, NULL);
+        cmds[0].outfile = after_tmp;
+        cmds[1].argv = build_argv(MSGUNFMT_CMD, file->peer_file->fullpath, NULL);
+        cmds[1].outfile = before_tmp;
+        run_cmds(cmds, 2);
 
-        if (exitcode) {
-            xasprintf(&msg, _("Error running msgunfmt on %s on %s"), file->peer_file->localpath, arch);
-            add_result(ri, RESULT_BAD, NOT_WAIVABLE, HEADER_CHANGEDFILES, msg, errors, REMEDY_CHANGEDFILES);
+        for (i = 0; i < 2; i++) {
+            free_argv(cmds[i].argv);
+        }
+
+        if (cmds[0].exitcode || cmds[1].exitcode) {
+            i = cmds[0].exitcode ? 0 : 1;
+            xasprintf(&msg, _("Error running msgunfmt on %s on %s"), i ? file->peer_file->localpath : file->localpath, arch);
+            add_result(ri, RESULT_BAD, NOT_WAIVABLE, HEADER_CHANGEDFILES, msg, cmds[i].output, REMEDY_CHANGEDFILES);
+            free(cmds[0].output);
+            free(cmds[1].output);
+            unlink(before_tmp);
+            unlink(after_tmp);
             result = false;
             goto done;
         }
 
+        free(cmds[0].output);
+        free(cmds[1].output);
+
         /* Now diff the mo content */
         errors = run_cmd(&exitcode, DIFF_CMD, "-u", before_tmp, after_tmp, NULL);
 
@@ -360,7 +517,7 @@ static bool changedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
         }
     }
 
-    if (!strcmp(type, "text/x-c") && possible_header) {
+    if (type == MIME_C_SOURCE && possible_header) {
         /* Now diff the header content */
         errors = run_cmd(&exitcode, DIFF_CMD, "-u", "-w", "--label", file->localpath, file->peer_file->fullpath, file->fullpath, NULL);
 
@@ -400,8 +557,8 @@ static bool changedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     }
 
     /* Finally, anything that gets down to here just compare checksums. */
-    before_sum = checksum(file->peer_file);
-    after_sum = checksum(file);
+    before_sum = checksum(ri, file->peer_file);
+    after_sum = checksum(ri, file);
 
     if (strcmp(before_sum, after_sum)) {
         xasprintf(&msg, _("File %s changed content on %s"), file->localpath, arch);
@@ -422,11 +579,20 @@ bool inspect_changedfiles(struct rpminspect *ri)
 {
     bool result;
 
-    result = foreach_peer_file(ri, changedfiles_driver);
+    memset(tier_counts, 0, sizeof(tier_counts));
+    result = foreach_peer_file_select(ri, S_IFREG, true, changedfiles_driver);
 
     if (result) {
         add_result(ri, RESULT_OK, NOT_WAIVABLE, HEADER_CHANGEDFILES, NULL, NULL, NULL);
     }
 
+    if (ri->verbose) {
+        /* stderr, the results may be streaming to stdout */
+        fprintf(stderr, _("changedfiles: %zu identical by checksum, %zu identical by content, %zu changed size, %zu changed content\n"),
+                tier_counts[TIER_SAME_DIGEST], tier_counts[TIER_SAME_BYTES],
+                tier_counts[TIER_DIFF_SIZE], tier_counts[TIER_DIFF_CONTENT]);
+        fflush(stderr);
+    }
+
     return result;
 }
@@ -302,7 +302,9 @@ static bool desktop_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     char *before_out = NULL;
     char *msg = NULL;
     const char *arch = NULL;
-    char *tmpbuf = NULL;
+    runcmd_t cmds[2];
+    size_t ncmds = 1;
+    size_t i;
 
     /*
      * Is this a file we should look at?
@@ -312,18 +314,27 @@ static bool desktop_driver(struct rpminspect *ri, rpmfile_entry_t *file)
         return true;
     }
 
-    /* Validate the desktop file */
-    after_out = run_cmd(&after_code, DESKTOP_FILE_VALIDATE_CMD, file->fullpath, NULL);
-    tmpbuf = strreplace(after_out, file->fullpath, file->localpath);
-    free(after_out);
-    after_out = tmpbuf;
+    /* Validate the desktop file and its before peer concurrently */
+    memset(cmds, 0, sizeof(cmds));
+    cmds[0].argv = build_argv(DESKTOP_FILE_VALIDATE_CMD, file->fullpath, NULL);
 
     if (file->peer_file && is_desktop_entry_file(ri->desktop_entry_files_dir, file->peer_file)) {
         /* if we have a before peer, validate the corresponding desktop file */
-        before_out = run_cmd(NULL, DESKTOP_FILE_VALIDATE_CMD, file->peer_file->fullpath, NULL);
-        tmpbuf = strreplace(before_out, file->peer_file->fullpath, file->peer_file->localpath);
-        free(before_out);
-        before_out = tmpbuf;
+        cmds[1].argv = build_argv(DESKTOP_FILE_VALIDATE_CMD, file->peer_file->fullpath, NULL);
+        ncmds++;
+    }
+
+    run_cmds(cmds, ncmds);
+    after_code = cmds[0].exitcode;
+    after_out = strreplace(cmds[0].output, file->fullpath, file->localpath);
+
+    if (ncmds > 1) {
+        before_out = strreplace(cmds[1].output, file->peer_file->fullpath, file->peer_file->localpath);
+    }
+
+    for (i = 0; i < ncmds; i++) {
+        free_argv(cmds[i].argv);
+        free(cmds[i].output);
     }
 
     if (after_code == -1) {
@@ -29,16 +29,10 @@ static bool dt_needed_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     const char *bv = NULL;
     const char *av = NULL;
     const char *arch = NULL;
-    int after_fd = -1;
-    int before_fd = -1;
-    Elf *after_elf = NULL;
-    Elf *before_elf = NULL;
-    Elf64_Half after_type;
+    const elf_info_t *after_info = NULL;
+    const elf_info_t *before_info = NULL;
     Elf64_Half before_type;
-    size_t i;
-    GElf_Dyn *dyn = NULL;
-    size_t sz = 0;
-    GElf_Shdr shdr;
+    string_list_t none;
     string_list_t *after_needed = NULL;
     string_list_t *before_needed = NULL;
     string_list_t *removed = NULL;
@@ -85,63 +79,34 @@ static bool dt_needed_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     assert(arch != NULL);
 
     /* If we lack dynamic or shared ELF files, we're done */
-    if ((after_elf = get_elf(file->fullpath, &after_fd)) == NULL) {
+    if ((after_info = get_elf_info(file)) == NULL) {
         return true;
     }
 
-    after_type = get_elf_type(after_elf);
-
-    if (after_type != ET_DYN) {
-        result = false;
-        goto done;
+    if (after_info->ehdr.e_type != ET_DYN) {
+        return false;
     }
 
-    if ((before_elf = get_elf(file->fullpath, &before_fd)) == NULL) {
+    if ((before_info = get_elf_info(file->peer_file)) == NULL) {
         xasprintf(&msg, _("%s was an ELF file and now is not on %s"), file->localpath, arch);
         add_result(ri, RESULT_VERIFY, WAIVABLE_BY_ANYONE, HEADER_DT_NEEDED, msg, NULL, REMEDY_DT_NEEDED);
         free(msg);
-        result = false;
-        goto done;
+        return false;
     }
 
-    before_type = get_elf_type(before_elf);
+    before_type = before_info->ehdr.e_type;
 
     if (before_type != ET_EXEC && before_type != ET_DYN) {
         xasprintf(&msg, _("%s was a dynamic ELF file and now is not on %s"), file->localpath, arch);
         add_result(ri, RESULT_VERIFY, WAIVABLE_BY_ANYONE, HEADER_DT_NEEDED, msg, NULL, REMEDY_DT_NEEDED);
         free(msg);
-        result = false;
-        goto done;
-    }
-
-    /* Gather the DT_NEEDED entries */
-    if (get_dynamic_tags(after_elf, DT_NEEDED, &dyn, &sz, &shdr)) {
-        after_needed = calloc(1, sizeof(*after_needed));
-        assert(after_needed != NULL);
-        TAILQ_INIT(after_needed);
-
-        for (i = 0; i < sz; i++) {
-            entry = calloc(1, sizeof(*entry));
-            entry->data = strdup(elf_strptr(after_elf, shdr.sh_link, (size_t) (dyn[i].d_un.d_ptr)));
-            TAILQ_INSERT_TAIL(after_needed, entry, items);
-        }
-
-        free(dyn);
+        return false;
     }
 
-    if (get_dynamic_tags(before_elf, DT_NEEDED, &dyn, &sz, &shdr)) {
-        before_needed = calloc(1, sizeof(*before_needed));
-        assert(before_needed != NULL);
-        TAILQ_INIT(before_needed);
-
-        for (i = 0; i < sz; i++) {
-            entry = calloc(1, sizeof(*entry));
-            entry->data = strdup(elf_strptr(before_elf, shdr.sh_link, (size_t) (dyn[i].d_un.d_ptr)));
-            TAILQ_INSERT_TAIL(before_needed, entry, items);
-        }
-
-        free(dyn);
-    }
+    /* The DT_NEEDED entries were gathered when the files were read */
+    TAILQ_INIT(&none);
+    after_needed = after_info->needed ? after_info->needed : &none;
+    before_needed = before_info->needed ? before_info->needed : &none;
 
     /* Figure out what symbol changes happened*/
     removed = list_difference(before_needed, after_needed);
@@ -152,7 +117,7 @@ static bool dt_needed_driver(struct rpminspect *ri, rpmfile_entry_t *file)
         xasprintf(&msg, _("DT_NEEDED symbol(s) removed from %s on %s"), file->localpath, arch);
 
         TAILQ_FOREACH(entry, removed, items) {
-            xasprintf(&tmp, "%s\n", entry->data);
+            xasprintf(&tmp, "%s%s\n", (dump == NULL) ? "" : dump, entry->data);
             free(dump);
             dump = tmp;
         }
@@ -160,6 +125,7 @@ static bool dt_needed_driver(struct rpminspect *ri, rpmfile_entry_t *file)
         add_result(ri, RESULT_VERIFY, WAIVABLE_BY_ANYONE, HEADER_DT_NEEDED, msg, dump, REMEDY_DT_NEEDED);
         free(msg);
         free(dump);
+        dump = NULL;
         result = false;
     }
 
@@ -167,7 +133,7 @@ static bool dt_needed_driver(struct rpminspect *ri, rpmfile_entry_t *file)
         xasprintf(&msg, _("DT_NEEDED symbol(s) added to %s on %s"), file->localpath, arch);
 
         TAILQ_FOREACH(entry, added, items) {
-            xasprintf(&tmp, "%s\n", entry->data);
+            xasprintf(&tmp, "%s%s\n", (dump == NULL) ? "" : dump, entry->data);
             free(dump);
             dump = tmp;
         }
@@ -175,24 +141,13 @@ static bool dt_needed_driver(struct rpminspect *ri, rpmfile_entry_t *file)
         add_result(ri, RESULT_VERIFY, WAIVABLE_BY_ANYONE, HEADER_DT_NEEDED, msg, dump, REMEDY_DT_NEEDED);
         free(msg);
         free(dump);
+        dump = NULL;
         result = false;
     }
 
-done:
-    if (after_elf && after_fd != -1) {
-        elf_end(after_elf);
-        close(after_fd);
-    }
-
-    if (before_elf && before_fd != -1) {
-        elf_end(before_elf);
-        close(before_fd);
-    }
-
-    free(removed);
-    free(added);
-    list_free(before_needed, free);
-    list_free(after_needed, free);
+    /* the entries point at the ELF string tables */
+    list_free(removed, NULL);
+    list_free(added, NULL);
 
     return result;
 }
@@ -206,7 +161,7 @@ bool inspect_dt_needed(struct rpminspect *ri) {
     assert(ri != NULL);
 
     /* run the DT_NEEDED test across all ELF files */
-    result = foreach_peer_file(ri, dt_needed_driver);
+    result = foreach_peer_file_parallel(ri, dt_needed_driver);
 
     /* if everything was fine, just say so */
     if (result) {
@@ -19,9 +19,10 @@
 
 #include <assert.h>
 #include <fcntl.h>
-#include <search.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/queue.h>
 #include <sys/types.h>
 
@@ -39,9 +40,18 @@
 /* defined in inspect_elf_bits.c. See pic_bits.sh */
 bool is_pic_reloc(Elf64_Half, Elf64_Xword);
 
-/* Used by the fortified symbol checks */
-static string_list_t *fortifiable = NULL;
-static struct hsearch_data *fortifiable_table = NULL;
+/* enough space for RWX?\0 */
+#define PFLAGS_STR_SIZE 5
+
+/*
+ * Used by the fortified symbol checks.  Read from the vendor data for
+ * the product release, or built from the local libc if there is none,
+ * the first time it is needed and kept until free_elf_data().
+ */
+static symset_t *fortifiable = NULL;
+
+/* Functions an object must not use if it supports IPv6, for one inspect_elf() run */
+static symset_t *ipv6_blacklist = NULL;
 
 static bool is_fortified(const char *symbol);
 static bool is_fortifiable(const char *symbol);
@@ -54,13 +64,15 @@ void init_elf_data(void)
     Elf *libc_elf;
     int libc_fd;
     string_list_t *libc_fortified;
+    string_list_t *names;
 
-    string_entry_t *entry;
     string_entry_t *iter;
+    string_entry_t *entry;
     size_t symbol_len;
-    size_t nentries;
-    ENTRY e;
-    ENTRY *eptr;
+
+    if (fortifiable != NULL) {
+        return;
+    }
 
     /*
      * Use libdl to get the path to libc.so.6 so we can open it.
@@ -97,73 +109,111 @@ void init_elf_data(void)
     /* Get a list of all fortified symbols exported by glibc */
     libc_fortified = get_elf_exported_functions(libc_elf, is_fortified);
 
+    /* a stripped libc only has its dynamic symbols */
+    if (libc_fortified != NULL && TAILQ_EMPTY(libc_fortified)) {
+        list_free(libc_fortified, NULL);
+        libc_fortified = get_elf_imported_functions(libc_elf, is_fortified);
+    }
+
     if (libc_fortified == NULL) {
         elf_end(libc_elf);
         close(libc_fd);
         return;
     }
 
-    fortifiable = malloc(sizeof(*fortifiable));
-    assert(fortifiable != NULL);
-    TAILQ_INIT(fortifiable);
+    names = calloc(1, sizeof(*names));
+    assert(names != NULL);
+    TAILQ_INIT(names);
 
     /* the symbols will be of the form, e.g., "__asprintf_chk". Turn that into "asprintf". */
-    nentries = 0;
     TAILQ_FOREACH(iter, libc_fortified, items) {
         /* Skip this one */
         if (!strcmp(iter->data, "__chk_fail")) {
             continue;
         }
 
+        /* strip off underscores, stop before _chk */
         symbol_len = strlen(iter->data);
-
         entry = calloc(1, sizeof(*entry));
         assert(entry != NULL);
-        /* minus 2 underscores, minus for _chk, plus \0 */
-        entry->data = calloc(symbol_len - 5, 1);
+        entry->data = strndup(iter->data + 2, symbol_len - 6);
         assert(entry->data != NULL);
-
-        /* strip off underscores, stop before _chk, \0 already present */
-        strncpy(entry->data, iter->data + 2, symbol_len - 6);
-        TAILQ_INSERT_TAIL(fortifiable, entry, items);
-        nentries++;
+        TAILQ_INSERT_TAIL(names, entry, items);
     }
 
     list_free(libc_fortified, NULL);
     elf_end(libc_elf);
     close(libc_fd);
 
-    /* The fortifiable tailq is to keep track of what all's been malloced.
-     * Copy into a hash table for fast lookups.
-     */
-    fortifiable_table = calloc(1, sizeof(*fortifiable_table));
-    assert(fortifiable_table != NULL);
+    fortifiable = symset_from_list(names);
+    list_free(names, free);
+}
 
-    if (hcreate_r(nentries, fortifiable_table) == 0) {
-        free(fortifiable_table);
-        fortifiable_table = NULL;
-        return;
+/*
+ * Read the fortifiable functions for the product release from the
+ * vendor data.  This keeps the results the same no matter which libc
+ * the inspecting host has.  Returns false if there is no such file.
+ */
+static bool read_fortify_data(const struct rpminspect *ri)
+{
+    char *filename = NULL;
+    FILE *input = NULL;
+    char *line = NULL;
+    char *name = NULL;
+    size_t len = 0;
+    string_list_t *names = NULL;
+    string_entry_t *entry = NULL;
+
+    if (fortifiable != NULL) {
+        return true;
     }
 
-    TAILQ_FOREACH(iter, fortifiable, items) {
-        e.key = iter->data;
-        e.data = iter->data;
-        hsearch_r(e, ENTER, &eptr, fortifiable_table);
+    if (ri->vendor_data_dir == NULL || ri->product_release == NULL) {
+        return false;
     }
-}
 
-void free_elf_data(void)
-{
-    if (fortifiable_table != NULL) {
-        hdestroy_r(fortifiable_table);
-        free(fortifiable_table);
-        fortifiable_table = NULL;
+    xasprintf(&filename, "%s/%s/%s", ri->vendor_data_dir, FORTIFY_DIR, ri->product_release);
+    assert(filename != NULL);
+    input = fopen(filename, "r");
+    free(filename);
+
+    if (input == NULL) {
+        return false;
     }
 
-    if (fortifiable != NULL) {
-        list_free(fortifiable, free);
-        fortifiable = NULL;
+    names = calloc(1, sizeof(*names));
+    assert(names != NULL);
+    TAILQ_INIT(names);
+
+    /* one function name per line */
+    while (getline(&line, &len, input) != -1) {
+        name = line + strspn(line, " \t");
+        name[strcspn(name, " \t\r\n")] = '\0';
+
+        /* skip blank lines and comments */
+        if (*name == '#' || *name == '\0') {
+            continue;
+        }
+
+        entry = calloc(1, sizeof(*entry));
+        assert(entry != NULL);
+        entry->data = strdup(name);
+        assert(entry->data != NULL);
+        TAILQ_INSERT_TAIL(names, entry, items);
     }
+
+    free(line);
+    fclose(input);
+
+    fortifiable = symset_from_list(names);
+    list_free(names, free);
+    return true;
+}
+
+void free_elf_data(void)
+{
+    symset_free(fortifiable);
+    fortifiable = NULL;
 }
 
 /* Check whether the given object file has information about
@@ -303,11 +353,7 @@ static bool is_fortified(const char *symbol)
 
 static bool is_fortifiable(const char *symbol)
 {
-    ENTRY e;
-    ENTRY *eptr;
-    e.key = (char *) symbol;
-    hsearch_r(e, FIND, &eptr, fortifiable_table);
-    return eptr != NULL;
+    return symset_contains(fortifiable, symbol);
 }
 
 /* Return a list of fortified symbols found linked in the given ELF object */
@@ -322,29 +368,97 @@ string_list_t * get_fortifiable_symbols(Elf *elf)
     return get_elf_imported_functions(elf, is_fortifiable);
 }
 
-/* Check the referenced symbol for global binding. */
-static bool is_global_reloc(GElf_Shdr *symtab_shdr, Elf_Data *symtab_data, Elf_Data *symtab_xdata, uint64_t r_sym)
+/* Number of relocation types is_pic_ok() remembers the class of */
+#define RELOC_TYPE_CACHE 256
+
+enum { RELOC_UNKNOWN = 0, RELOC_PIC, RELOC_NOT_PIC };
+
+/* State for scanning the relocations of one ET_REL object */
+typedef struct {
+    bool is64;
+    Elf64_Half machine;
+    const void *syms;          /* the symbol table, Elf32_Sym or Elf64_Sym */
+    size_t nsyms;
+    unsigned char types[RELOC_TYPE_CACHE];
+} reloc_scan_t;
+
+/* Return true if the relocation type uses the PLT or GOT */
+static bool is_pic_type(reloc_scan_t *scan, Elf64_Xword type)
 {
-    GElf_Sym sym;
-    size_t num_syms;
+    if (type >= RELOC_TYPE_CACHE) {
+        return is_pic_reloc(scan->machine, type);
+    }
 
-    /* Sanity check, make sure the symbol index isn't bigger than the symbol table */
-    assert(symtab_shdr->sh_entsize > 0);
-    num_syms = symtab_shdr->sh_size / symtab_shdr->sh_entsize;
+    if (scan->types[type] == RELOC_UNKNOWN) {
+        scan->types[type] = is_pic_reloc(scan->machine, type) ? RELOC_PIC : RELOC_NOT_PIC;
+    }
+
+    return scan->types[type] == RELOC_PIC;
+}
+
+/* Return true if the symbol has STB_GLOBAL binding */
+static bool is_global_symbol(const reloc_scan_t *scan, Elf64_Xword r_sym)
+{
+    const unsigned char *syms = scan->syms;
+    unsigned char info;
 
-    if (r_sym >= num_syms) {
+    /* Sanity check, make sure the symbol index isn't bigger than the symbol table */
+    if (r_sym >= scan->nsyms) {
         return false;
     }
 
-    if (gelf_getsymshndx(symtab_data, symtab_xdata, r_sym, &sym, NULL) == NULL) {
-        return false;
+    if (scan->is64) {
+        info = syms[r_sym * sizeof(Elf64_Sym) + offsetof(Elf64_Sym, st_info)];
+    } else {
+        info = syms[r_sym * sizeof(Elf32_Sym) + offsetof(Elf32_Sym, st_info)];
     }
 
-    if (GELF_ST_BIND(sym.st_info) == STB_GLOBAL) {
+    return ELF64_ST_BIND(info) == STB_GLOBAL;
+}
+
+/*
+ * Return false if any relocation in the data is a non-PIC one for a
+ * global symbol.  The data is read in place: elf_getdata() has it in
+ * memory as an array of Elf32_Rel(a) or Elf64_Rel(a), and r_info is
+ * at the same place in the Rel and Rela versions.  Archive members
+ * need not be aligned, so r_info is copied out rather than loaded
+ * through a pointer to the struct.
+ */
+static bool scan_relocs(reloc_scan_t *scan, const Elf_Data *data)
+{
+    const unsigned char *p = data->d_buf;
+    size_t step;
+    size_t off;
+    Elf64_Xword info;
+    Elf32_Word info32;
+
+    if (p == NULL) {
         return true;
     }
 
-    return false;
+    if (scan->is64) {
+        step = (data->d_type == ELF_T_RELA) ? sizeof(Elf64_Rela) : sizeof(Elf64_Rel);
+
+        for (off = 0; off + step <= data->d_size; off += step) {
+            memcpy(&info, p + off + offsetof(Elf64_Rel, r_info), sizeof(info));
+
+            if (!is_pic_type(scan, ELF64_R_TYPE(info)) && is_global_symbol(scan, ELF64_R_SYM(info))) {
+                return false;
+            }
+        }
+    } else {
+        step = (data->d_type == ELF_T_RELA) ? sizeof(Elf32_Rela) : sizeof(Elf32_Rel);
+
+        for (off = 0; off + step <= data->d_size; off += step) {
+            memcpy(&info32, p + off + offsetof(Elf32_Rel, r_info), sizeof(info32));
+
+            if (!is_pic_type(scan, ELF32_R_TYPE(info32)) && is_global_symbol(scan, ELF32_R_SYM(info32))) {
+                return false;
+            }
+        }
+    }
+
+    return true;
 }
 
 /* Given the ET_REL object, return whether we think it was compiled with -fPIC */
@@ -358,33 +472,28 @@ static bool is_global_reloc(GElf_Shdr *symtab_shdr, Elf_Data *symtab_data, Elf_D
  *   * iterate over all relocations
  *   * if the relocation is for a symbol of binding other than STB_GLOBAL, it's probably fine
  *   * otherwise, if the relocation type doesn't pass is_pic_reloc, return false.
+ *
+ * Archives can hold thousands of objects, so the relocations and symbols
+ * are read straight from the section data and is_pic_reloc() is called
+ * once per relocation type rather than once per relocation.
  */
 bool is_pic_ok(Elf *elf)
 {
     GElf_Ehdr ehdr;
     Elf_Scn *rel_section;
-    GElf_Shdr rel_shdr;
     Elf_Data *rel_data = NULL;
 
     Elf_Scn *symtab_section;
-    GElf_Shdr symtab_shdr;
     Elf_Data *symtab_data;
 
-    Elf_Scn *xndxscn = NULL;
-    Elf_Data *xndxdata = NULL;
-
-    GElf_Rel rel;
-    GElf_Rela rela;
-
-    size_t entry_size;
-    size_t i;
+    reloc_scan_t scan;
 
     if (gelf_getehdr(elf, &ehdr) == NULL) {
         return true;
     }
 
     /* Fetch the symtab data */
-    if ((symtab_section = get_elf_section(elf, SHT_SYMTAB, NULL, NULL, &symtab_shdr)) == NULL) {
+    if ((symtab_section = get_elf_section(elf, SHT_SYMTAB, NULL, NULL, NULL)) == NULL) {
         return true;
     }
 
@@ -392,53 +501,31 @@ bool is_pic_ok(Elf *elf)
         return true;
     }
 
-    if ((xndxscn = get_elf_extended_section(elf, symtab_section, NULL)) != NULL) {
-        if ((xndxdata = elf_getdata(xndxscn, NULL)) == NULL) {
-            return true;
-        }
-    }
+    memset(&scan, 0, sizeof(scan));
+    scan.is64 = (gelf_getclass(elf) == ELFCLASS64);
+    scan.machine = ehdr.e_machine;
+    scan.syms = symtab_data->d_buf;
+    scan.nsyms = symtab_data->d_size / (scan.is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym));
 
     /* Look for a SHT_RELA section first */
-    rel_section = get_elf_section(elf, SHT_RELA, ".rela.text", NULL, &rel_shdr);
+    rel_section = get_elf_section(elf, SHT_RELA, ".rela.text", NULL, NULL);
 
     if (rel_section != NULL) {
         while ((rel_data = elf_getdata(rel_section, rel_data)) != NULL) {
-            if (!(entry_size = gelf_fsize(elf, rel_data->d_type, 1, EV_CURRENT))) {
-                continue;
-            }
-
-            for (i = 0; i < rel_shdr.sh_size / entry_size; i++) {
-                if (gelf_getrela(rel_data, i, &rela) == NULL) {
-                    continue;
-                }
-
-                if (is_global_reloc(&symtab_shdr, symtab_data, xndxdata, GELF_R_SYM(rela.r_info)) &&
-                        !is_pic_reloc(ehdr.e_machine, GELF_R_TYPE(rela.r_info))) {
-                    return false;
-                }
+            if (rel_data->d_type == ELF_T_RELA && !scan_relocs(&scan, rel_data)) {
+                return false;
             }
         }
     }
 
     /* Try again with SHT_REL */
-    rel_section = get_elf_section(elf, SHT_REL, ".rel.text", NULL, &rel_shdr);
+    rel_section = get_elf_section(elf, SHT_REL, ".rel.text", NULL, NULL);
     rel_data = NULL;
 
     if (rel_section != NULL) {
         while ((rel_data = elf_getdata(rel_section, rel_data)) != NULL) {
-            if (!(entry_size = gelf_fsize(elf, rel_data->d_type, 1, EV_CURRENT))) {
-                continue;
-            }
-
-            for (i = 0; i < rel_shdr.sh_size / entry_size; i++) {
-                if (gelf_getrel(rel_data, i, &rel) == NULL) {
-                    continue;
-                }
-
-                if (is_global_reloc(&symtab_shdr, symtab_data, xndxdata, GELF_R_SYM(rel.r_info)) &&
-                        !is_pic_reloc(ehdr.e_machine, GELF_R_TYPE(rel.r_info))) {
-                    return false;
-                }
+            if (rel_data->d_type == ELF_T_REL && !scan_relocs(&scan, rel_data)) {
+                return false;
             }
         }
     }
@@ -446,13 +533,12 @@ bool is_pic_ok(Elf *elf)
     return true;
 }
 
-static const char * pflags_to_str(uint64_t flags)
+/* Write the program header flags to output as a string like "RW" */
+static const char * pflags_to_str(uint64_t flags, char output[PFLAGS_STR_SIZE])
 {
-    /* enough space for RWX?\0 */
-    static char output[5];
     char *current = output;
 
-    memset(output, 0, sizeof(output));
+    memset(output, 0, PFLAGS_STR_SIZE);
 
     if (flags & PF_R) {
         *current = 'R';
@@ -483,6 +569,7 @@ static bool inspect_elf_execstack(struct rpminspect *ri, Elf *after_elf, Elf *be
     uint64_t execstack_flags;
     bool result = false;
     char *msg = NULL;
+    char pflags[PFLAGS_STR_SIZE];
 
     bool before_execstack = false;
     severity_t severity;
@@ -528,7 +615,7 @@ static bool inspect_elf_execstack(struct rpminspect *ri, Elf *after_elf, Elf *be
 
             add_result(ri, RESULT_BAD, WAIVABLE_BY_SECURITY, HEADER_ELF, msg, NULL, REMEDY_ELF_EXECSTACK_INVALID);
         } else {
-            xasprintf(&msg, _("File %s has unrecognized GNU_STACK '%s' (expected RW or RWE) on %s"), localpath, pflags_to_str(execstack_flags), arch);
+            xasprintf(&msg, _("File %s has unrecognized GNU_STACK '%s' (expected RW or RWE) on %s"), localpath, pflags_to_str(execstack_flags, pflags), arch);
 
             add_result(ri, RESULT_BAD, WAIVABLE_BY_SECURITY, HEADER_ELF, msg, NULL, REMEDY_ELF_EXECSTACK_INVALID);
         }
@@ -596,12 +683,11 @@ static bool check_relro(struct rpminspect *ri, Elf *before_elf, Elf *after_elf,
 /* Check for binaries that had fortified symbols in before, and have no fortified symbols in after.
  * This could indicate a loss of hardening build flags.
  */
-static bool check_fortified(struct rpminspect *ri, Elf *before_elf, Elf *after_elf, const char *localpath, const char *arch)
+static bool check_fortified(struct rpminspect *ri, const elf_info_t *before_info, const elf_info_t *after_info, const char *localpath, const char *arch)
 {
-    string_list_t *before_fortifiable = NULL;
-    string_list_t *before_fortified = NULL;
-    string_list_t *after_fortifiable = NULL;
-    string_list_t *after_fortified = NULL;
+    symset_t *before_fortified = NULL;
+    symset_t *after_fortifiable = NULL;
+    symset_t *after_fortified = NULL;
     string_list_t *sorted_list;
     string_entry_t *iter;
 
@@ -617,10 +703,9 @@ static bool check_fortified(struct rpminspect *ri, Elf *before_elf, Elf *after_e
     (void) output_result;
 
     /* If "before" had no fortified symbols, it can't lose fortified symbols. Return. */
-    before_fortified = get_fortified_symbols(before_elf);
-    assert(before_fortified != NULL);
+    before_fortified = symset_filter(before_info->dynsyms, is_fortified);
 
-    if ((before_fortified == NULL) || TAILQ_EMPTY(before_fortified)) {
+    if (symset_count(before_fortified) == 0) {
         goto cleanup;
     }
 
@@ -628,18 +713,16 @@ static bool check_fortified(struct rpminspect *ri, Elf *before_elf, Elf *after_e
      * If "after" has any fortified symbols, then at least some of it was compiled with
      * -D_FORTIFY_SOURCE. Assume it's fine.
      */
-    after_fortified = get_fortified_symbols(after_elf);
-    assert(after_fortified != NULL);
+    after_fortified = symset_filter(after_info->dynsyms, is_fortified);
 
-    if ((after_fortified != NULL) && !TAILQ_EMPTY(after_fortified)) {
+    if (symset_count(after_fortified) > 0) {
         goto cleanup;
     }
 
     /* If "after" has no fortifiable symbols, it's fine. */
-    after_fortifiable = get_fortifiable_symbols(after_elf);
-    assert(after_fortifiable != NULL);
+    after_fortifiable = symset_intersection(after_info->dynsyms, fortifiable);
 
-    if ((after_fortifiable == NULL) || TAILQ_EMPTY(after_fortifiable)) {
+    if (symset_count(after_fortifiable) == 0) {
         goto cleanup;
     }
 
@@ -658,8 +741,7 @@ static bool check_fortified(struct rpminspect *ri, Elf *before_elf, Elf *after_e
     output_result = fprintf(output_stream, _("Fortified symbols lost:\n"));
     assert(output_result > 0);
 
-    sorted_list = list_sort(before_fortified);
-    assert(sorted_list != NULL);
+    sorted_list = symset_names(before_fortified);
 
     TAILQ_FOREACH(iter, sorted_list, items) {
         output_result = fprintf(output_stream, "\t%s\n", iter->data);
@@ -671,8 +753,7 @@ static bool check_fortified(struct rpminspect *ri, Elf *before_elf, Elf *after_e
     output_result = fprintf(output_stream, _("Fortifiable symbols present:\n"));
     assert(output_result > 0);
 
-    sorted_list = list_sort(after_fortifiable);
-    assert(sorted_list != NULL);
+    sorted_list = symset_names(after_fortifiable);
 
     TAILQ_FOREACH(iter, sorted_list, items) {
         output_result = fprintf(output_stream, "\t%s\n", iter->data);
@@ -689,10 +770,9 @@ static bool check_fortified(struct rpminspect *ri, Elf *before_elf, Elf *after_e
     free(msg);
 
 cleanup:
-    list_free(before_fortifiable, NULL);
-    list_free(before_fortified, NULL);
-    list_free(after_fortifiable, NULL);
-    list_free(after_fortified, NULL);
+    symset_free(before_fortified);
+    symset_free(after_fortifiable);
+    symset_free(after_fortified);
 
     free(output_buffer);
 
@@ -701,10 +781,9 @@ cleanup:
 
 /* Check for binaries that use blacklisted functions which don't support IPv6.
  * This could indicate broken support for IPv6. */
-static bool check_ipv6(struct rpminspect *ri, Elf *after_elf, const char *localpath, const char *arch)
+static bool check_ipv6(struct rpminspect *ri, const elf_info_t *after_info, const char *localpath, const char *arch)
 {
-    string_list_t *after_symbols = NULL;
-    string_list_t *used_symbols = NULL;
+    symset_t *used_symbols = NULL;
     string_list_t *sorted_used = NULL;
     string_entry_t *iter = NULL;
 
@@ -716,21 +795,13 @@ static bool check_ipv6(struct rpminspect *ri, Elf *after_elf, const char *localp
     size_t output_size = 0;
     int output_result = 0;
 
-    if (!ri->ipv6_blacklist) {
-        /* Since we don't have a list of IPv6 files to compare against, pass
-         * the check. */
-        goto cleanup;
-    }
+    /* ignore unused variable warnings if assert is disabled */
+    (void) output_result;
 
-    /* Don't filter the list -- filtering requires knowledge of the
-     * blacklisted functions. Since we can't pass custom arguments to
-     * the filter, return them all and filter them locally. */
-    after_symbols = get_elf_imported_functions(after_elf, NULL);
-    assert(after_symbols != NULL);
+    /* Get a set of symbols that are blacklisted that we used. */
+    used_symbols = symset_intersection(ipv6_blacklist, after_info->dynsyms);
 
-    /* Get a list of symbols that are blacklisted that we used. */
-    used_symbols = list_intersection(ri->ipv6_blacklist, after_symbols);
-    if (!used_symbols || TAILQ_EMPTY(used_symbols)) {
+    if (symset_count(used_symbols) == 0) {
         goto cleanup;
     }
 
@@ -743,8 +814,7 @@ static bool check_ipv6(struct rpminspect *ri, Elf *after_elf, const char *localp
     output_result = fprintf(output_stream, _("IPv4-only symbols used:\n"));
     assert(output_result > 0);
 
-    sorted_used = list_sort(used_symbols);
-    assert(sorted_used != NULL);
+    sorted_used = symset_names(used_symbols);
 
     TAILQ_FOREACH(iter, sorted_used, items) {
         output_result = fprintf(output_stream, "\t%s\n", iter->data);
@@ -759,9 +829,9 @@ static bool check_ipv6(struct rpminspect *ri, Elf *after_elf, const char *localp
     free(msg);
 
 cleanup:
-    list_free(after_symbols, NULL);
-    list_free(used_symbols, NULL);
+    symset_free(used_symbols);
     list_free(sorted_used, NULL);
+    free(output_buffer);
 
     return result;
 }
@@ -795,10 +865,15 @@ static bool find_no_pic(Elf *elf, string_list_t **user_data)
     return true;
 }
 
-/* Helper for elf_archive_tests, add the archive member to the list if compiled *with* -fPIC */
-static bool find_pic(Elf *elf, string_list_t **user_data)
+/*
+ * Helper for elf_archive_tests, get all archive member names in the
+ * first list and the ones compiled *with* -fPIC in the second, so the
+ * before archive is only read once.
+ */
+static bool find_pic_and_all(Elf *elf, string_list_t **user_data)
 {
-    string_list_t *pic_list = *user_data;
+    string_list_t *all_list = user_data[0];
+    string_list_t *pic_list = user_data[1];
     string_entry_t *entry;
     Elf_Arhdr *arhdr;
 
@@ -811,6 +886,14 @@ static bool find_pic(Elf *elf, string_list_t **user_data)
         return true;
     }
 
+    entry = calloc(1, sizeof(*entry));
+    assert(entry != NULL);
+
+    entry->data = strdup(arhdr->ar_name);
+    assert(entry->data != NULL);
+
+    TAILQ_INSERT_TAIL(all_list, entry, items);
+
     if (is_pic_ok(elf)) {
         entry = calloc(1, sizeof(*entry));
         assert(entry != NULL);
@@ -824,38 +907,12 @@ static bool find_pic(Elf *elf, string_list_t **user_data)
     return true;
 }
 
-/* Helper for elf_archive_tests, get all archive member names */
-static bool find_all(Elf *elf, string_list_t **user_data)
-{
-    string_list_t *all_list = *user_data;
-    string_entry_t *entry;
-    Elf_Arhdr *arhdr;
-
-    if ((arhdr = elf_getarhdr(elf)) == NULL) {
-        return true;
-    }
-
-    /* Skip the / entry */
-    if (!strcmp(arhdr->ar_name, "/")) {
-        return true;
-    }
-
-    entry = calloc(1, sizeof(*entry));
-    assert(entry != NULL);
-
-    entry->data = strdup(arhdr->ar_name);
-    assert(entry->data != NULL);
-
-    TAILQ_INSERT_TAIL(all_list, entry, items);
-
-    return true;
-}
-
 static bool elf_archive_tests(struct rpminspect *ri, Elf *after_elf, int after_elf_fd, Elf *before_elf, int before_elf_fd, const char *localpath, const char *arch)
 {
     string_list_t *after_no_pic = NULL;
     string_list_t *before_pic = NULL;
     string_list_t *before_all = NULL;
+    string_list_t *before_lists[2];
 
     string_list_t *after_lost_pic = NULL;
     string_list_t *after_new = NULL;
@@ -900,16 +957,22 @@ static bool elf_archive_tests(struct rpminspect *ri, Elf *after_elf, int after_e
     output_stream = open_memstream(&screendump, &screendump_size);
     assert(output_stream != NULL);
 
+    before_all = calloc(1, sizeof(*before_all));
+    assert(before_all != NULL);
+    TAILQ_INIT(before_all);
+
     before_pic = calloc(1, sizeof(*before_pic));
     assert(before_pic != NULL);
-
     TAILQ_INIT(before_pic);
-    elf_archive_iterate(before_elf_fd, before_elf, find_pic, &before_pic);
+
+    before_lists[0] = before_all;
+    before_lists[1] = before_pic;
+    elf_archive_iterate(before_elf_fd, before_elf, find_pic_and_all, before_lists);
 
     after_lost_pic = list_intersection(after_no_pic, before_pic);
     assert(after_lost_pic != NULL);
 
-    if (TAILQ_FIRST(after_lost_pic) == NULL) {
+    if (!TAILQ_EMPTY(after_lost_pic)) {
         result = false;
 
         output_result = fprintf(output_stream, _("The following objects lost -fPIC:\n"));
@@ -921,18 +984,10 @@ static bool elf_archive_tests(struct rpminspect *ri, Elf *after_elf, int after_e
         }
     }
 
-    before_all = calloc(1, sizeof(*before_all));
-    assert(before_all != NULL);
-
-    TAILQ_INIT(before_all);
-    elf_archive_iterate(before_elf_fd, before_elf, find_all, &before_all);
-
     after_new = list_difference(after_no_pic, before_all);
-    if (after_new == NULL) {
-        goto cleanup;
-    }
+    assert(after_new != NULL);
 
-    if (TAILQ_FIRST(after_new) == NULL) {
+    if (!TAILQ_EMPTY(after_new)) {
         result = false;
 
         output_result = fprintf(output_stream, _("The following new objects were built without -fPIC:\n"));
@@ -966,8 +1021,10 @@ cleanup:
     return result;
 }
 
-static bool elf_regular_tests(struct rpminspect *ri, Elf *after_elf, Elf *before_elf, const char *localpath, const char *arch)
+static bool elf_regular_tests(struct rpminspect *ri, const elf_info_t *after_info, const elf_info_t *before_info, const char *localpath, const char *arch)
 {
+    Elf *after_elf = after_info->elf;
+    Elf *before_elf = before_info ? before_info->elf : NULL;
     char *msg = NULL;
     bool result = true;
 
@@ -998,13 +1055,13 @@ static bool elf_regular_tests(struct rpminspect *ri, Elf *after_elf, Elf *before
         }
 
         /* Check if the object lost fortified symbols or gained unfortified, fortifiable symbols */
-        if (!check_fortified(ri, before_elf, after_elf, localpath, arch)) {
+        if (!check_fortified(ri, before_info, after_info, localpath, arch)) {
             result = false;
         }
     }
 
     /* Check if we potentially violate IPv6 support. */
-    check_ipv6(ri, after_elf, localpath, arch);
+    check_ipv6(ri, after_info, localpath, arch);
 
     return result;
 }
@@ -1012,6 +1069,8 @@ static bool elf_regular_tests(struct rpminspect *ri, Elf *after_elf, Elf *before
 static bool elf_driver(struct rpminspect *ri, rpmfile_entry_t *after)
 {
     const char *arch;
+    const elf_info_t *after_info = NULL;
+    const elf_info_t *before_info = NULL;
     Elf *after_elf = NULL;
     Elf *before_elf = NULL;
     int after_elf_fd = -1;
@@ -1033,22 +1092,22 @@ static bool elf_driver(struct rpminspect *ri, rpmfile_entry_t *after)
 
     arch = get_rpm_header_arch(after->rpm_header);
 
-    /* Is this an archive or a regular ELF file? */
-    if ((after_elf = get_elf_archive(after->fullpath, &after_elf_fd)) != NULL) {
+    /* Is this a regular ELF file or an archive? */
+    if ((after_info = get_elf_info(after)) != NULL) {
+        /* shared with the other inspections, not ours to close */
         if (after->peer_file != NULL) {
-            before_elf = get_elf_archive(after->peer_file->fullpath, &before_elf_fd);
+            before_info = get_elf_info(after->peer_file);
         }
 
-        result = elf_archive_tests(ri, after_elf, after_elf_fd, before_elf, before_elf_fd, after->localpath, arch);
-    } else if ((after_elf = get_elf(after->fullpath, &after_elf_fd)) != NULL) {
+        result = elf_regular_tests(ri, after_info, before_info, after->localpath, arch);
+    } else if ((after_elf = get_elf_archive(after->fullpath, &after_elf_fd)) != NULL) {
         if (after->peer_file != NULL) {
-            before_elf = get_elf(after->peer_file->fullpath, &before_elf_fd);
+            before_elf = get_elf_archive(after->peer_file->fullpath, &before_elf_fd);
         }
 
-        result = elf_regular_tests(ri, after_elf, before_elf, after->localpath, arch);
+        result = elf_archive_tests(ri, after_elf, after_elf_fd, before_elf, before_elf_fd, after->localpath, arch);
     }
 
-
     if (after_elf) {
         elf_end(after_elf);
         close(after_elf_fd);
@@ -1066,9 +1125,14 @@ bool inspect_elf(struct rpminspect *ri)
 {
     bool result;
 
-    init_elf_data();
-    result = foreach_peer_file(ri, elf_driver);
-    free_elf_data();
+    if (!read_fortify_data(ri)) {
+        init_elf_data();
+    }
+
+    ipv6_blacklist = symset_from_list(ri->ipv6_blacklist);
+    result = foreach_peer_file_parallel(ri, elf_driver);
+    symset_free(ipv6_blacklist);
+    ipv6_blacklist = NULL;
 
     if (result) {
         add_result(ri, RESULT_OK, NOT_WAIVABLE, HEADER_ELF, NULL, NULL, NULL);
@@ -101,7 +101,7 @@ bool inspect_filesize(struct rpminspect *ri) {
     assert(ri != NULL);
 
     /* run the size inspection across all RPM files */
-    result = foreach_peer_file(ri, filesize_driver);
+    result = foreach_peer_file_select(ri, 0, true, filesize_driver);
 
     /* if everything was fine, just say so */
     if (result) {
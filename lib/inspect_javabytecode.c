@@ -220,9 +220,7 @@ bool inspect_javabytecode(struct rpminspect *ri)
     rpmpeer_entry_t *peer = NULL;
     rpmfile_entry_t *file = NULL;
     char *container = NULL;
-    ENTRY e;
-    ENTRY *eptr;
-    char *prod = NULL;
+    char *major = NULL;
 
     assert(ri != NULL);
     assert(ri->peers != NULL);
@@ -236,25 +234,21 @@ bool inspect_javabytecode(struct rpminspect *ri)
         return false;
     }
 
-    e.key = ri->product_release;
-    hsearch_r(e, FIND, &eptr, ri->jvm_table);
+    major = hashmap_get(ri->jvm_table, ri->product_release);
 
-    if (eptr == NULL) {
-        prod = strdup("default");
-        e.key = prod;
-        hsearch_r(e, FIND, &eptr, ri->jvm_table);
-        free(prod);
+    if (major == NULL) {
+        major = hashmap_get(ri->jvm_table, "default");
     }
 
-    if (eptr == NULL) {
+    if (major == NULL) {
         fprintf(stderr, _("*** missing JVM version to product release mapping\n"));
         fflush(stderr);
         return false;
     }
 
-    supported_major = strtol(eptr->data, NULL, 10);
+    supported_major = strtol(major, NULL, 10);
     if (errno == ERANGE) {
-        fprintf(stderr, _("*** invalid JVM major version: %s: %s\n"), (char *) eptr->data, strerror(errno));
+        fprintf(stderr, _("*** invalid JVM major version: %s: %s\n"), major, strerror(errno));
         fflush(stderr);
         return false;
     }
@@ -24,19 +24,30 @@
 
 #include "rpminspect.h"
 
-static severity_t sev = RESULT_INFO;
-static waiverauth_t waiver = NOT_WAIVABLE;
+/* Passed to lost_alias() so it reports like the rest of kmod_driver() */
+struct alias_report {
+    struct rpminspect *ri;
+    severity_t sev;
+    waiverauth_t waiver;
+};
 
 static void lost_alias(const char *alias, const string_list_t *before_modules, const string_list_t *after_modules, void *user_data)
 {
-    struct rpminspect *ri = (struct rpminspect *) user_data;
+    struct alias_report *report = (struct alias_report *) user_data;
+    struct rpminspect *ri = NULL;
+    severity_t sev;
+    waiverauth_t waiver;
     string_entry_t *entry = NULL;
     char *msg = NULL;
 
     assert(alias != NULL);
     assert(before_modules != NULL);
     assert(after_modules != NULL);
-    assert(ri != NULL);
+    assert(report != NULL);
+    assert(report->ri != NULL);
+    ri = report->ri;
+    sev = report->sev;
+    waiver = report->waiver;
 
     TAILQ_FOREACH(entry, before_modules, items) {
         xasprintf(&msg, _("Kernel module '%s' lost alias '%s'"), entry->data, alias);
@@ -78,6 +89,9 @@ static bool kmod_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     const char *beforever = NULL;
     const char *afterver = NULL;
     char *msg = NULL;
+    severity_t sev = RESULT_INFO;
+    waiverauth_t waiver = NOT_WAIVABLE;
+    struct alias_report report;
 
     assert(ri != NULL);
     assert(file != NULL);
@@ -232,7 +246,10 @@ static bool kmod_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     /* Compute lost PCI device IDs in kernel modules */
     beforealiases = gather_module_aliases(before_kmod_name, beforeinfo);
     afteraliases = gather_module_aliases(after_kmod_name, afterinfo);
-    result_aliases = compare_module_aliases(beforealiases, afteraliases, lost_alias, ri);
+    report.ri = ri;
+    report.sev = sev;
+    report.waiver = waiver;
+    result_aliases = compare_module_aliases(beforealiases, afteraliases, lost_alias, &report);
 
     /* Clean up libkmod usage */
     kmod_module_info_free_list(beforeinfo);
@@ -258,7 +275,7 @@ bool inspect_kmod(struct rpminspect *ri) {
     assert(ri != NULL);
 
     /* run the kmod inspection across all RPM files */
-    result = foreach_peer_file(ri, kmod_driver);
+    result = foreach_peer_file_parallel(ri, kmod_driver);
 
     /* if everything was fine, just say so */
     if (result) {
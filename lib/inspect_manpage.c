@@ -28,6 +28,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include <rpm/header.h>
 #include <rpm/rpmtag.h>
@@ -46,6 +47,12 @@
 static FILE *error_stream = NULL;
 static regex_t sections_regex;
 
+/*
+ * libmandoc keeps its message state in globals, so only one man page
+ * is parsed at a time.  This also covers error_stream above.
+ */
+static pthread_mutex_t mandoc_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* Old API used an error message callback */
 #ifndef NEWLIBMANDOC
 static void error_handler(enum mandocerr errtype, enum mandoclevel level,
@@ -276,7 +283,11 @@ static bool manpage_driver(struct rpminspect *ri, rpmfile_entry_t *file)
 
     arch = get_rpm_header_arch(file->rpm_header);
 
-    if ((manpage_errors = inspect_manpage_validity(file->fullpath, file->localpath)) != NULL) {
+    pthread_mutex_lock(&mandoc_lock);
+    manpage_errors = inspect_manpage_validity(file->fullpath, file->localpath);
+    pthread_mutex_unlock(&mandoc_lock);
+
+    if (manpage_errors != NULL) {
         xasprintf(&msg, _("Man page checker reported problems with %s on %s"), file->localpath, arch);
 
         add_result(ri, RESULT_VERIFY, WAIVABLE_BY_ANYONE, HEADER_MAN, msg, manpage_errors, REMEDY_MAN_ERRORS);
@@ -302,7 +313,7 @@ bool inspect_manpage(struct rpminspect *ri)
     bool result;
 
     inspect_manpage_alloc();
-    result = foreach_peer_file(ri, manpage_driver);
+    result = foreach_peer_file_parallel(ri, manpage_driver);
     inspect_manpage_free();
 
     if (result) {
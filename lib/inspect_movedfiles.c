@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include "rpminspect.h"
+
+/*
+ * Report a file whose peer is in a different subpackage.  The files
+ * were paired by find_moved_files().
+ */
+static bool movedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
+{
+    const char *before_name = NULL;
+    const char *after_name = NULL;
+    const char *arch = NULL;
+    char *msg = NULL;
+
+    if (file->peer_file == NULL) {
+        return true;
+    }
+
+    before_name = headerGetString(file->peer_file->rpm_header, RPMTAG_NAME);
+    after_name = headerGetString(file->rpm_header, RPMTAG_NAME);
+
+    if (!strcmp(before_name, after_name)) {
+        return true;
+    }
+
+    arch = get_rpm_header_arch(file->rpm_header);
+
+    if (!strcmp(file->localpath, file->peer_file->localpath)) {
+        xasprintf(&msg, _("%s moved from %s to %s on %s"), file->localpath, before_name, after_name, arch);
+    } else {
+        xasprintf(&msg, _("%s in %s moved to %s in %s on %s"), file->peer_file->localpath, before_name, file->localpath, after_name, arch);
+    }
+
+    add_result(ri, RESULT_INFO, NOT_WAIVABLE, HEADER_MOVEDFILES, msg, NULL, REMEDY_MOVEDFILES);
+    free(msg);
+    return false;
+}
+
+/*
+ * Main driver for the 'movedfiles' inspection.
+ */
+bool inspect_movedfiles(struct rpminspect *ri)
+{
+    bool result;
+
+    assert(ri != NULL);
+
+    /* run the inspection across all RPM files */
+    result = foreach_peer_file_select(ri, 0, true, movedfiles_driver);
+
+    /* if nothing moved, just say so */
+    if (result) {
+        add_result(ri, RESULT_OK, NOT_WAIVABLE, HEADER_MOVEDFILES, NULL, NULL, NULL);
+    }
+
+    return result;
+}
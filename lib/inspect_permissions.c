@@ -82,7 +82,7 @@ static bool permissions_driver(struct rpminspect *ri, rpmfile_entry_t *file)
 
     /* check for world-writability */
     if (!whitelisted && (!S_ISLNK(file->st.st_mode) && !S_ISDIR(file->st.st_mode) && (after_mode & (S_IWOTH|S_ISVTX)))) {
-        xasprintf(&msg, _("%s (%s) is world-writable on %s"), file->localpath, get_mime_type(file), arch);
+        xasprintf(&msg, _("%s (%s) is world-writable on %s"), file->localpath, get_mime_type(ri, file), arch);
         add_result(ri, RESULT_BAD, WAIVABLE_BY_SECURITY, HEADER_PERMISSIONS, msg, NULL, NULL);
         free(msg);
         result = false;
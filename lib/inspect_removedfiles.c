@@ -46,6 +46,37 @@ static void add_removedfiles_result(struct rpminspect *ri, const char *msg, char
     return;
 }
 
+/*
+ * Return the SONAME a renamed library had if its peer does not have
+ * it, or NULL.  Shared libraries are paired across a soname bump (see
+ * pairing.c), but the old SONAME is still gone.
+ */
+static const char *removed_soname(rpmfile_entry_t *file)
+{
+    const elf_info_t *before_info = NULL;
+    const elf_info_t *after_info = NULL;
+
+    /* files paired by path have not been renamed */
+    if (!strcmp(file->localpath, file->peer_file->localpath) ||
+        !S_ISREG(file->st.st_mode) || !S_ISREG(file->peer_file->st.st_mode)) {
+        return NULL;
+    }
+
+    before_info = get_elf_info(file);
+
+    if (before_info == NULL || before_info->soname == NULL) {
+        return NULL;
+    }
+
+    after_info = get_elf_info(file->peer_file);
+
+    if (after_info != NULL && after_info->soname != NULL && !strcmp(before_info->soname, after_info->soname)) {
+        return NULL;
+    }
+
+    return before_info->soname;
+}
+
 /*
  * Performs all of the tests associated with the removedfiles inspection.
  * NOTE:  This function is called while looping over before_files.
@@ -53,16 +84,18 @@ static void add_removedfiles_result(struct rpminspect *ri, const char *msg, char
 static bool removedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
 {
     bool result = false;
-    char *type = NULL;
+    unsigned int type = MIME_NONE;
     const char *arch = NULL;
-    char *soname = NULL;
+    const elf_info_t *info = NULL;
+    const char *soname = NULL;
     char *msg = NULL;
     string_entry_t *entry = NULL;
+    const char *prefix = NULL;
     severity_t severity = RESULT_VERIFY;
     waiverauth_t waiver = WAIVABLE_BY_ANYONE;
 
-    /* Any entry with a peer has not been removed. */
-    if (file->peer_file) {
+    /* Any entry with a peer has not been removed, unless its SONAME was. */
+    if (file->peer_file && (soname = removed_soname(file)) == NULL) {
         return true;
     }
 
@@ -82,17 +115,20 @@ static bool removedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     }
 
     /* Collect the RPM architecture and file MIME type */
-    type = get_mime_type(file);
+    type = get_mime_type_id(ri, file);
     arch = get_rpm_header_arch(file->rpm_header);
 
     /* Set the waiver type if this is a file of security concern */
     if (ri->security_path_prefix) {
         TAILQ_FOREACH(entry, ri->security_path_prefix, items) {
-            while (*entry->data != '/') {
-                entry->data++;
+            /* Do not move entry->data, other inspections read it too */
+            prefix = entry->data;
+
+            while (*prefix != '/') {
+                prefix++;
             }
 
-            if (strprefix(entry->data, file->localpath)) {
+            if (strprefix(prefix, file->localpath)) {
                 severity = RESULT_BAD;
                 waiver = WAIVABLE_BY_SECURITY;
                 break;
@@ -103,13 +139,16 @@ static bool removedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     /*
      * File has been removed, report results.
      */
-    if (is_elf(file->fullpath) && !strcmp(type, "application/x-pie-executable")) {
-        soname = get_elf_soname(file->fullpath);
+    if (soname) {
+        severity = RESULT_BAD;
+        xasprintf(&msg, _("ABI break: Library %s with SONAME '%s' removed from %s"), file->localpath, soname, arch);
+        add_removedfiles_result(ri, msg, NULL, severity, waiver);
+        free(msg);
+    } else if (type == MIME_PIE_EXECUTABLE && (info = get_elf_info(file)) != NULL) {
         severity = RESULT_BAD;
 
-        if (soname) {
-            xasprintf(&msg, _("ABI break: Library %s with SONAME '%s' removed from %s"), file->localpath, soname, arch);
-            free(soname);
+        if (info->soname) {
+            xasprintf(&msg, _("ABI break: Library %s with SONAME '%s' removed from %s"), file->localpath, info->soname, arch);
         } else {
             xasprintf(&msg, _("ABI break: Library %s removed from %s"), file->localpath, arch);
         }
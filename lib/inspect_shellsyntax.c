@@ -99,7 +99,7 @@ static bool shellsyntax_driver(struct rpminspect *ri, rpmfile_entry_t *file)
 {
     bool result = true;
     const char *arch = NULL;
-    char *type = NULL;
+    const char *type = NULL;
     char *shell = NULL;
     char *before_shell = NULL;
     int exitcode = -1;
@@ -109,6 +109,9 @@ static bool shellsyntax_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     char *msg = NULL;
     char *tmp = NULL;
     bool extglob = false;
+    runcmd_t cmds[2];
+    size_t ncmds = 1;
+    size_t i;
 
     /* Ignore files in the SRPM */
     if (headerIsSource(file->rpm_header)) {
@@ -116,7 +119,7 @@ static bool shellsyntax_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     }
 
     /* Get the mime type of the file */
-    type = get_mime_type(file);
+    type = get_mime_type(ri, file);
 
     if (!strprefix(type, "text/")) {
         return true;
@@ -147,11 +150,26 @@ static bool shellsyntax_driver(struct rpminspect *ri, rpmfile_entry_t *file)
         }
     }
 
-    /* Run with -n and capture results */
-    errors = run_cmd(&exitcode, shell, "-n", file->fullpath, NULL);
+    /* Run with -n on both builds concurrently and capture results */
+    memset(cmds, 0, sizeof(cmds));
+    cmds[0].argv = build_argv(shell, "-n", file->fullpath, NULL);
 
     if (before_shell) {
-        before_errors = run_cmd(&before_exitcode, before_shell, "-n", file->peer_file->fullpath, NULL);
+        cmds[1].argv = build_argv(before_shell, "-n", file->peer_file->fullpath, NULL);
+        ncmds++;
+    }
+
+    run_cmds(cmds, ncmds);
+    errors = cmds[0].output;
+    exitcode = cmds[0].exitcode;
+
+    if (before_shell) {
+        before_errors = cmds[1].output;
+        before_exitcode = cmds[1].exitcode;
+    }
+
+    for (i = 0; i < ncmds; i++) {
+        free_argv(cmds[i].argv);
     }
 
     /* Special cash for GNU bash, try with extglob */
@@ -211,7 +229,7 @@ bool inspect_shellsyntax(struct rpminspect *ri) {
 
     assert(ri != NULL);
 
-    result = foreach_peer_file(ri, shellsyntax_driver);
+    result = foreach_peer_file_parallel(ri, shellsyntax_driver);
 
     if (result) {
         add_result(ri, RESULT_OK, NOT_WAIVABLE, HEADER_SHELLSYNTAX, NULL, NULL, NULL);
@@ -125,12 +125,12 @@ static bool upstream_driver(struct rpminspect *ri, rpmfile_entry_t *file)
         result = false;
     } else {
         /* compare checksums to see if the upstream sources changed */
-        before_sum = checksum(file->peer_file);
-        after_sum = checksum(file);
+        before_sum = checksum(ri, file->peer_file);
+        after_sum = checksum(ri, file);
 
         if (strcmp(before_sum, after_sum)) {
             /* capture 'diff -u' output for text files */
-            if (is_text_file(file->peer_file) && is_text_file(file)) {
+            if (is_text_file(ri, file->peer_file) && is_text_file(ri, file)) {
                 diff_head = diff_output = run_cmd(&exitcode, DIFF_CMD, "-u", file->peer_file->fullpath, file->fullpath, NULL);
 
                 /* skip the two leading lines */
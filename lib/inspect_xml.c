@@ -18,6 +18,7 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -31,21 +32,30 @@
 #include "inspect.h"
 #include "rpminspect.h"
 
+/*
+ * libxml2 has to be initialized once before it is used from more than
+ * one thread.
+ */
+static pthread_once_t libxml_once = PTHREAD_ONCE_INIT;
+
+static void init_libxml(void)
+{
+    LIBXML_TEST_VERSION
+    xmlInitParser();
+    return;
+}
+
 /*
  * Return true if the given file is a well-formed XML document, false otherwise.
  * This only checks if the XML is well-formed. No validation is performed.
  */
 bool is_xml_well_formed(const char *path, char **errors)
 {
-    static bool initialized = false;
     xmlParserCtxtPtr ctxt;
     xmlDocPtr doc;
     bool result;
 
-    if (!initialized) {
-        LIBXML_TEST_VERSION
-        initialized = true;
-    }
+    pthread_once(&libxml_once, init_libxml);
 
     ctxt = xmlNewParserCtxt();
     assert(ctxt != NULL);
@@ -172,7 +182,7 @@ bool inspect_xml(struct rpminspect *ri)
     bool result;
 
     assert(ri != NULL);
-    result = foreach_peer_file(ri, xml_driver);
+    result = foreach_peer_file_parallel(ri, xml_driver);
 
     if (result) {
         add_result(ri, RESULT_OK, NOT_WAIVABLE, HEADER_XML, NULL, NULL, NULL);
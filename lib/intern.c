@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * String interning.
+ *
+ * A few strings show up over and over: MIME types, architectures,
+ * package names.  Interning one returns a small integer ID and a
+ * canonical copy of it that lives until intern_free().  Two interned
+ * strings are equal exactly when their IDs (or pointers) are equal,
+ * so code that dispatches on them can use a switch instead of a chain
+ * of strcmp() calls.
+ *
+ * ID 0 stands for NULL.  The MIME types in enum mime_type are interned
+ * first so their IDs are the enum values.
+ *
+ * The pool is shared by every thread.  Adding a string takes a lock.
+ * The canonical copies are kept in chunks that never move, so
+ * intern_string() does not lock.  Each chunk is twice the size of the
+ * one before it, so a fixed table of chunks covers every ID.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "rpminspect.h"
+
+/* The first chunk holds 1 << INTERN_CHUNK_BITS strings */
+#define INTERN_CHUNK_BITS 12
+#define INTERN_MAX_CHUNKS (32 - INTERN_CHUNK_BITS)
+
+/* In the same order as enum mime_type */
+static const char *mime_types[] = {
+    NULL,
+    "application/zip",
+    "application/x-java-applet",
+    "application/octet-stream",
+    "application/x-gzip",
+    "application/x-bzip2",
+    "application/x-xz",
+    "application/x-pie-executable",
+    "application/x-executable",
+    "application/x-object",
+    "application/x-gettext-translation",
+    "text/x-c",
+};
+
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+static hashmap_t *intern_map = NULL;
+static arena_t *intern_arena = NULL;
+static const char **intern_chunks[INTERN_MAX_CHUNKS];
+static unsigned int intern_count = 0;
+
+/* Find the chunk and the position in it of an ID */
+static void locate(unsigned int id, unsigned int *chunk, size_t *pos)
+{
+    uint64_t v = (uint64_t) id + (UINT64_C(1) << INTERN_CHUNK_BITS);
+    unsigned int top = INTERN_CHUNK_BITS;
+
+    while ((v >> (top + 1)) != 0) {
+        top++;
+    }
+
+    *chunk = top - INTERN_CHUNK_BITS;
+    *pos = v - (UINT64_C(1) << top);
+    return;
+}
+
+/* Add a string not in the pool yet, intern_lock must be held */
+static unsigned int add_string(const char *s)
+{
+    unsigned int id = intern_count;
+    unsigned int chunk;
+    size_t pos;
+
+    locate(id, &chunk, &pos);
+    assert(chunk < INTERN_MAX_CHUNKS);
+
+    if (intern_chunks[chunk] == NULL) {
+        intern_chunks[chunk] = calloc((size_t) 1 << (INTERN_CHUNK_BITS + chunk), sizeof(**intern_chunks));
+        assert(intern_chunks[chunk] != NULL);
+    }
+
+    intern_chunks[chunk][pos] = (s == NULL) ? NULL : arena_strdup(intern_arena, s);
+    intern_count++;
+
+    if (s != NULL) {
+        hashmap_put(intern_map, s, (void *) (uintptr_t) id);
+    }
+
+    return id;
+}
+
+/* Set up the pool the first time, intern_lock must be held */
+static void init_pool(void)
+{
+    unsigned int i;
+
+    if (intern_map != NULL) {
+        return;
+    }
+
+    intern_map = hashmap_new(256);
+    intern_arena = arena_new();
+
+    for (i = 0; i < NUM_MIME_TYPES; i++) {
+        add_string(mime_types[i]);
+    }
+
+    return;
+}
+
+/*
+ * Return the ID of a string, adding it to the pool if it is not there
+ * yet.  NULL is always 0.
+ */
+unsigned int intern_id(const char *s)
+{
+    void *value = NULL;
+    unsigned int id = 0;
+
+    if (s == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&intern_lock);
+    init_pool();
+
+    if (hashmap_find(intern_map, s, &value)) {
+        id = (uintptr_t) value;
+    } else {
+        id = add_string(s);
+    }
+
+    pthread_mutex_unlock(&intern_lock);
+    return id;
+}
+
+/*
+ * Return the canonical copy of the string with the given ID.  The
+ * caller must not free it.
+ */
+const char *intern_string(unsigned int id)
+{
+    unsigned int chunk;
+    size_t pos;
+
+    /* well known types work before anything has been interned */
+    if (id < NUM_MIME_TYPES) {
+        return mime_types[id];
+    }
+
+    locate(id, &chunk, &pos);
+    return intern_chunks[chunk][pos];
+}
+
+/*
+ * Return the canonical copy of a string, adding it to the pool if it
+ * is not there yet.  Equal strings give the same pointer.
+ */
+const char *intern(const char *s)
+{
+    return intern_string(intern_id(s));
+}
+
+/*
+ * Release the pool.  Every ID and canonical string handed out so far
+ * becomes invalid.
+ */
+void intern_free(void)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&intern_lock);
+
+    for (i = 0; i < INTERN_MAX_CHUNKS && intern_chunks[i] != NULL; i++) {
+        free(intern_chunks[i]);
+        intern_chunks[i] = NULL;
+    }
+
+    hashmap_free(intern_map, NULL);
+    arena_free(intern_arena);
+    intern_map = NULL;
+    intern_arena = NULL;
+    intern_count = 0;
+
+    pthread_mutex_unlock(&intern_lock);
+    return;
+}
@@ -19,7 +19,6 @@
 
 #include <assert.h>
 #include <fnmatch.h>
-#include <search.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -283,12 +282,16 @@ kernel_alias_data_t *gather_module_aliases(const char *module_name, const struct
     return ret;
 }
 
+/* Free one module name list in an alias table */
+static void free_module_list(void *modules)
+{
+    list_free(modules, free);
+}
+
 /* Free the kernel_alias_data struct created by gather_module_aliases */
 void free_module_aliases(kernel_alias_data_t *data)
 {
     struct alias_entry_t *alias_entry;
-    ENTRY e;
-    ENTRY *eptr;
 
     if (data == NULL) {
         return;
@@ -298,16 +301,6 @@ void free_module_aliases(kernel_alias_data_t *data)
         alias_entry = TAILQ_FIRST(data->alias_list);
         TAILQ_REMOVE(data->alias_list, alias_entry, items);
 
-        if (data->alias_table != NULL) {
-            e.key = alias_entry->alias;
-            hsearch_r(e, FIND, &eptr, data->alias_table);
-
-            if ((eptr != NULL) && (eptr->data != NULL)) {
-                list_free((string_list_t *) eptr->data, free);
-                eptr->data = NULL;
-            }
-        }
-
         free(alias_entry->alias);
         free(alias_entry->module);
         free(alias_entry);
@@ -315,10 +308,7 @@ void free_module_aliases(kernel_alias_data_t *data)
 
     free(data->alias_list);
 
-    if (data->alias_table != NULL) {
-        hdestroy_r(data->alias_table);
-        free(data->alias_table);
-    }
+    hashmap_free(data->alias_table, free_module_list);
 
     free(data);
     return;
@@ -328,25 +318,12 @@ static void finalize_module_aliases(kernel_alias_data_t *data)
 {
     struct alias_entry_t *alias_entry;
     struct alias_entry_t *tmp;
-    ENTRY e;
-    ENTRY *eptr;
+    string_list_t *modules;
     string_entry_t *module_entry;
-    int result;
-
-    /* ignore unused variable warnings if assert is disabled */
-    (void) result;
 
     assert(data);
 
-    data->alias_table = calloc(1, sizeof(*(data->alias_table)));
-    assert(data->alias_table);
-
-    /*
-     * The glibc man page for hcreate recommends a size 25% greater than
-     * the number of elements, so use that
-     */
-    result = hcreate_r(data->num_aliases * 1.25, data->alias_table);
-    assert(result != 0);
+    data->alias_table = hashmap_new(data->num_aliases);
 
     alias_entry = TAILQ_FIRST(data->alias_list);
     while (alias_entry != NULL) {
@@ -358,14 +335,11 @@ static void finalize_module_aliases(kernel_alias_data_t *data)
         assert(module_entry->data);
 
         /* Find or insert the alias */
-        e.key = alias_entry->alias;
-        e.data = NULL;
-        result = hsearch_r(e, ENTER, &eptr, data->alias_table);
-        assert(result != 0);
+        modules = hashmap_get(data->alias_table, alias_entry->alias);
 
-        if (eptr->data != NULL) {
-            /* The alias was already in the table. First, add this module name to the list in "data" */
-            TAILQ_INSERT_TAIL((string_list_t *) eptr->data, module_entry, items);
+        if (modules != NULL) {
+            /* The alias was already in the table. First, add this module name to its list */
+            TAILQ_INSERT_TAIL(modules, module_entry, items);
 
             /* Now delete this duplicate alias entry from alias_list */
             tmp = TAILQ_NEXT(alias_entry, items);
@@ -379,11 +353,12 @@ static void finalize_module_aliases(kernel_alias_data_t *data)
             alias_entry = tmp;
         } else {
             /* The alias was not in the table, start a new module name list */
-            eptr->data = calloc(1, sizeof(string_list_t));
-            assert(eptr->data);
+            modules = calloc(1, sizeof(*modules));
+            assert(modules);
 
-            TAILQ_INIT((string_list_t *) eptr->data);
-            TAILQ_INSERT_TAIL((string_list_t *) eptr->data, module_entry, items);
+            TAILQ_INIT(modules);
+            TAILQ_INSERT_TAIL(modules, module_entry, items);
+            hashmap_put(data->alias_table, alias_entry->alias, modules);
 
             /* Advance to the next entry */
             alias_entry = TAILQ_NEXT(alias_entry, items);
@@ -446,8 +421,6 @@ bool compare_module_aliases(kernel_alias_data_t *before, kernel_alias_data_t *af
     string_list_t *after_modules;
     string_list_t *difference;
     string_list_t empty;
-    ENTRY e;
-    ENTRY *eptr;
     bool wildcard_search;
     bool result = true;
 
@@ -472,10 +445,8 @@ bool compare_module_aliases(kernel_alias_data_t *before, kernel_alias_data_t *af
 
     /* For each alias in before, look for the matching alias in after */
     TAILQ_FOREACH(iter, before->alias_list, items) {
-        e.key = iter->alias;
-        hsearch_r(e, FIND, &eptr, before->alias_table);
-        assert(eptr != NULL);
-        before_modules = (string_list_t *) eptr->data;
+        before_modules = hashmap_get(before->alias_table, iter->alias);
+        assert(before_modules != NULL);
 
         /*
          * If the after list was NULL, no need to do a wildcard search. Just call the
@@ -486,15 +457,14 @@ bool compare_module_aliases(kernel_alias_data_t *before, kernel_alias_data_t *af
             continue;
         }
 
-        hsearch_r(e, FIND, &eptr, after->alias_table);
+        after_modules = hashmap_get(after->alias_table, iter->alias);
         wildcard_search = false;
 
         /* No match found, do a wildcard search */
-        if (eptr == NULL) {
+        if (after_modules == NULL) {
             after_modules = wildcard_alias_search(iter->alias, after->alias_list);
             wildcard_search = true;
         } else {
-            after_modules = (string_list_t *) eptr->data;
             difference = list_difference(before_modules, after_modules);
 
             /* If the lists differ, do a wildcard search */
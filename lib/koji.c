@@ -262,6 +262,8 @@ void free_koji_rpmlist(koji_rpmlist_t *rpms)
         entry->version = NULL;
         free(entry->release);
         entry->release = NULL;
+        free(entry->payloadhash);
+        entry->payloadhash = NULL;
         free(entry);
     }
 
@@ -827,6 +829,9 @@ struct koji_build *get_koji_build(struct rpminspect *ri, const char *buildspec)
                     xmlrpc_abort_on_fault(&env);
                 } else if (!strcmp(key, "epoch")) {
                     xmlrpc_decompose_value(&env, value, "i", &rpm->epoch);
+                } else if (!strcmp(key, "payloadhash")) {
+                    xmlrpc_decompose_value(&env, value, "s", &rpm->payloadhash);
+                    xmlrpc_abort_on_fault(&env);
                 } else if (!strcmp(key, "size")) {
                     if (xmlrpc_value_type(value) == XMLRPC_TYPE_INT) {
                         xmlrpc_decompose_value(&env, value, "i", &rpm->size);
@@ -18,7 +18,6 @@
  */
 
 #include <assert.h>
-#include <errno.h>
 #include <search.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,48 +25,22 @@
 
 #include "rpminspect.h"
 
-string_list_t *sorted_list = NULL;
+/* Used by list_sort() and walk_action(), per thread so sorts can overlap */
+static __thread string_list_t *sorted_list = NULL;
 
-struct hsearch_data * list_to_table(const string_list_t *list)
+hashmap_t * list_to_table(const string_list_t *list)
 {
-    struct hsearch_data *table;
-    size_t table_size = 0;
-    ENTRY e;
-    ENTRY *eptr;
-
+    hashmap_t *table;
     const string_entry_t *iter;
 
     if (list == NULL) {
         return NULL;
     }
 
-    /* Iterate over the list once to get the size */
-    table_size = list_len(list);
-
-    if (table_size == 0) {
-        table_size = 1;
-    }
-
-    /* Allocate the table */
-    table = calloc(1, sizeof(*table));
-    assert(table != NULL);
-
-    if (!hcreate_r(table_size, table)) {
-        fprintf(stderr, _("Unable to create hash table: %s\n"), strerror(errno));
-        free(table);
-        return NULL;
-    }
+    table = hashmap_new(list_len(list));
 
     TAILQ_FOREACH(iter, list, items) {
-        e.key = iter->data;
-        e.data = iter->data;
-
-        if (!hsearch_r(e, ENTER, &eptr, table)) {
-            fprintf(stderr, _("Unable to add entry to hash table: %s\n"), strerror(errno));
-            hdestroy_r(table);
-            free(table);
-            return NULL;
-        }
+        hashmap_put(table, iter->data, iter->data);
     }
 
     return table;
@@ -76,10 +49,7 @@ struct hsearch_data * list_to_table(const string_list_t *list)
 /* Return a new list of entries that are in list a but are not in list b */
 string_list_t * list_difference(const string_list_t *a, const string_list_t *b)
 {
-    struct hsearch_data *b_table;
-
-    ENTRY e;
-    ENTRY *eptr;
+    hashmap_t *b_table;
 
     const string_entry_t *iter;
     string_list_t *ret;
@@ -102,10 +72,7 @@ string_list_t * list_difference(const string_list_t *a, const string_list_t *b)
 
     /* Iterate through list a looking for things not in list b */
     TAILQ_FOREACH(iter, a, items) {
-        e.key = iter->data;
-        hsearch_r(e, FIND, &eptr, b_table);
-
-        if (eptr == NULL) {
+        if (!hashmap_find(b_table, iter->data, NULL)) {
             entry = calloc(1, sizeof(*entry));
             assert(entry != NULL);
             entry->data = iter->data;
@@ -114,8 +81,7 @@ string_list_t * list_difference(const string_list_t *a, const string_list_t *b)
     }
 
     /* Free the hash table */
-    hdestroy_r(b_table);
-    free(b_table);
+    hashmap_free(b_table, NULL);
 
     return ret;
 }
@@ -123,10 +89,7 @@ string_list_t * list_difference(const string_list_t *a, const string_list_t *b)
 /* Return a new list of entries that are both in list a and list b */
 string_list_t * list_intersection(const string_list_t *a, const string_list_t *b)
 {
-    struct hsearch_data *b_table;
-
-    ENTRY e;
-    ENTRY *eptr;
+    hashmap_t *b_table;
 
     const string_entry_t *iter;
     string_list_t *ret;
@@ -145,10 +108,7 @@ string_list_t * list_intersection(const string_list_t *a, const string_list_t *b
 
     /* Iterate through list a looking for things in list b */
     TAILQ_FOREACH(iter, a, items) {
-        e.key = iter->data;
-        hsearch_r(e, FIND, &eptr, b_table);
-
-        if (eptr != NULL) {
+        if (hashmap_find(b_table, iter->data, NULL)) {
             entry = calloc(1, sizeof(*entry));
             assert(entry != NULL);
             entry->data = iter->data;
@@ -157,8 +117,7 @@ string_list_t * list_intersection(const string_list_t *a, const string_list_t *b
     }
 
     /* Free the hash table */
-    hdestroy_r(b_table);
-    free(b_table);
+    hashmap_free(b_table, NULL);
 
     return ret;
 }
@@ -166,45 +125,24 @@ string_list_t * list_intersection(const string_list_t *a, const string_list_t *b
 /* Return a new list of entries that are in either list a or list b */
 string_list_t * list_union(const string_list_t *a, const string_list_t *b)
 {
-    struct hsearch_data u_table;
-    size_t u_table_size = 0;
+    hashmap_t *u_table;
 
     const string_entry_t *iter;
     string_list_t *ret;
     string_entry_t *entry;
 
-    ENTRY e;
-    ENTRY *eptr;
-
     ret = malloc(sizeof(*ret));
     assert(ret != NULL);
     TAILQ_INIT(ret);
 
-    u_table_size += list_len(a);
-    u_table_size += list_len(b);
-
-    if (u_table_size == 0) {
-        u_table_size = 1;
-    }
-
-    memset(&u_table, 0, sizeof(u_table));
-
-    if (!hcreate_r(u_table_size, &u_table)) {
-        fprintf(stderr, _("Unable to create hash table: %s\n"), strerror(errno));
-        return NULL;
-    }
+    u_table = hashmap_new(list_len(a) + list_len(b));
 
     /*
      * Iterate over both lists, adding each entry to u_table. If it's not already in
      * u_table, add it to the list to be returned.
      */
     TAILQ_FOREACH(iter, a, items) {
-        e.key = iter->data;
-        e.data = iter->data;
-        hsearch_r(e, FIND, &eptr, &u_table);
-
-        if (eptr == NULL) {
-            hsearch_r(e, ENTER, &eptr, &u_table);
+        if (hashmap_put(u_table, iter->data, iter->data)) {
             entry = calloc(1, sizeof(*entry));
             assert(entry != NULL);
             entry->data = iter->data;
@@ -213,12 +151,7 @@ string_list_t * list_union(const string_list_t *a, const string_list_t *b)
     }
 
     TAILQ_FOREACH(iter, b, items) {
-        e.key = iter->data;
-        e.data = iter->data;
-        hsearch_r(e, FIND, &eptr, &u_table);
-
-        if (eptr == NULL) {
-            hsearch_r(e, ENTER, &eptr, &u_table);
+        if (hashmap_put(u_table, iter->data, iter->data)) {
             entry = calloc(1, sizeof(*entry));
             assert(entry != NULL);
             entry->data = iter->data;
@@ -226,7 +159,7 @@ string_list_t * list_union(const string_list_t *a, const string_list_t *b)
         }
     }
 
-    hdestroy_r(&u_table);
+    hashmap_free(u_table, NULL);
 
     return ret;
 }
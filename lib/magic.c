@@ -17,73 +17,268 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 #include <magic.h>
 
 #include "rpminspect.h"
 
 /*
- * Return the MIME type of the specified file.  The type is cached in the
- * rpmfile_entry_t.  If that is not NULL, this function returns that value.
- * Otherwise it gets the MIME type, caches it, and returns the value.
- * The caller should not free the pointer returned.
+ * Loaded libmagic cookies.  A thread that asks for a MIME type is lent
+ * a cookie the first time and keeps it until the thread exits, when
+ * it goes back to the pool for the next thread.  The magic database
+ * is only loaded when no idle cookie is left, so it is loaded as many
+ * times as there are threads running at once, not once per thread
+ * ever started.
  */
-char *get_mime_type(rpmfile_entry_t *file) {
-    char *ret = NULL;
-    char *pos = NULL;
-    const char *tmp = NULL;
+struct magic_slot {
     magic_t cookie;
+    struct magic_pool *pool;
+    struct magic_slot *next;
+};
 
+struct magic_pool {
+    pthread_key_t key;         /* the slot lent to each thread */
+    pthread_mutex_t lock;
+    struct magic_slot *idle;   /* loaded cookies no thread has */
+};
+
+/*
+ * Thread exit handler for the slots lent out through the key, puts
+ * the slot back in the pool.
+ */
+static void return_magic_cookie(void *arg)
+{
+    struct magic_slot *slot = arg;
+
+    pthread_mutex_lock(&slot->pool->lock);
+    slot->next = slot->pool->idle;
+    slot->pool->idle = slot;
+    pthread_mutex_unlock(&slot->pool->lock);
+    return;
+}
+
+/*
+ * Set up ri->magic_cookies.
+ */
+bool init_magic_cookies(struct rpminspect *ri)
+{
+    struct magic_pool *pool = NULL;
+
+    assert(ri != NULL);
+
+    pool = calloc(1, sizeof(*pool));
+    assert(pool != NULL);
+
+    if (pthread_key_create(&pool->key, return_magic_cookie) != 0) {
+        fprintf(stderr, _("*** Unable to create thread key for the magic library\n"));
+        fflush(stderr);
+        free(pool);
+        return false;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    ri->magic_cookies = pool;
+    return true;
+}
+
+/*
+ * Close every libmagic cookie and tear down ri->magic_cookies.  Call
+ * once the threads using them are gone.
+ */
+void free_magic_cookies(struct rpminspect *ri)
+{
+    struct magic_pool *pool = NULL;
+    struct magic_slot *slot = NULL;
+
+    assert(ri != NULL);
+
+    if ((pool = ri->magic_cookies) == NULL) {
+        return;
+    }
+
+    if ((slot = pthread_getspecific(pool->key)) != NULL) {
+        pthread_setspecific(pool->key, NULL);
+        return_magic_cookie(slot);
+    }
+
+    pthread_key_delete(pool->key);
+
+    while ((slot = pool->idle) != NULL) {
+        pool->idle = slot->next;
+        magic_close(slot->cookie);
+        free(slot);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+    ri->magic_cookies = NULL;
+    return;
+}
+
+/*
+ * Return the libmagic cookie for the calling thread.  The first time,
+ * take an idle one from the pool or, if there is none, open a new one
+ * and load the magic database.
+ */
+static magic_t get_magic_cookie(struct rpminspect *ri)
+{
+    struct magic_pool *pool = NULL;
+    struct magic_slot *slot = NULL;
+    magic_t cookie = NULL;
+
+    assert(ri != NULL);
+    assert(ri->magic_cookies != NULL);
+    pool = ri->magic_cookies;
+
+    if ((slot = pthread_getspecific(pool->key)) != NULL) {
+        return slot->cookie;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    if ((slot = pool->idle) != NULL) {
+        pool->idle = slot->next;
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    if (slot == NULL) {
+        cookie = magic_open(MAGIC_MIME | MAGIC_CHECK);
+
+        if (cookie == NULL) {
+            fprintf(stderr, _("*** Unable to initialize the magic library\n"));
+            fflush(stderr);
+            return NULL;
+        }
+
+        if (magic_load(cookie, NULL) != 0) {
+            fprintf(stderr, _("*** Unable to load the magic database: %s\n"), magic_error(cookie));
+            fflush(stderr);
+            magic_close(cookie);
+            return NULL;
+        }
+
+        slot = calloc(1, sizeof(*slot));
+        assert(slot != NULL);
+        slot->cookie = cookie;
+        slot->pool = pool;
+    }
+
+    if (pthread_setspecific(pool->key, slot) != 0) {
+        fprintf(stderr, _("*** Unable to save the magic library cookie\n"));
+        fflush(stderr);
+        return_magic_cookie(slot);
+        return NULL;
+    }
+
+    return slot->cookie;
+}
+
+/*
+ * Intern a libmagic MIME result, dropping any trailing metadata after
+ * the MIME type, such as 'charset=binary' and stuff like that.
+ */
+static unsigned int mime_type_id(const char *tmp)
+{
+    char *type = NULL;
+    unsigned int id = 0;
+    size_t len;
+
+    if (tmp == NULL) {
+        return 0;
+    }
+
+    len = strcspn(tmp, ";");
+
+    if (tmp[len] == '\0') {
+        return intern_id(tmp);
+    }
+
+    type = strndup(tmp, len);
+    assert(type != NULL);
+    id = intern_id(type);
+    free(type);
+    return id;
+}
+
+/*
+ * Return the MIME type ID of a block of file data, used when the file
+ * is not on disk (e.g., while streaming a payload).
+ */
+unsigned int get_buffer_mime_type_id(struct rpminspect *ri, const void *buf, size_t len)
+{
+    magic_t cookie;
+
+    assert(ri != NULL);
+
+    if ((cookie = get_magic_cookie(ri)) == NULL) {
+        return 0;
+    }
+
+    return mime_type_id(magic_buffer(cookie, buf, len));
+}
+
+/*
+ * Return the MIME type ID of the specified file, see enum mime_type.
+ * The ID is cached in the rpmfile_entry_t.  If that is not 0, this
+ * function returns that value.  Otherwise it gets the MIME type,
+ * caches it, and returns the value.
+ */
+unsigned int get_mime_type_id(struct rpminspect *ri, rpmfile_entry_t *file)
+{
+    unsigned int id = 0;
+    magic_t cookie;
+
+    assert(ri != NULL);
     assert(file != NULL);
 
     /* MIME type is cached, return it */
-    if (file->type != NULL) {
-        return file->type;
+    lock_file_entry(file);
+    id = file->type_id;
+    unlock_file_entry(file);
+
+    if (id != 0) {
+        return id;
     }
 
     /* Get and cache MIME type */
     assert(file->fullpath != NULL);
-    cookie = magic_open(MAGIC_MIME | MAGIC_CHECK);
 
-    if (cookie == NULL) {
-        fprintf(stderr, _("*** Unable to initialize the magic library\n"));
-        fflush(stderr);
-        return ret;
+    if ((cookie = get_magic_cookie(ri)) == NULL) {
+        return 0;
     }
 
-    if (magic_load(cookie, NULL) != 0) {
-        fprintf(stderr, _("*** Unable to load the magic database: %s\n"), magic_error(cookie));
-        fflush(stderr);
-        magic_close(cookie);
-        return ret;
-    }
+    id = mime_type_id(magic_file(cookie, file->fullpath));
 
-    if ((tmp = magic_file(cookie, file->fullpath)) != NULL) {
-        file->type = strdup(tmp);
+    /* Another thread may have done the same, the IDs are equal */
+    lock_file_entry(file);
+    file->type_id = id;
+    unlock_file_entry(file);
 
-        /*
-         * Trim any trailing metadata after the MIME type, such
-         * as 'charset=binary' and stuff like that.
-         */
-        if ((pos = index(file->type, ';')) != NULL) {
-            *pos = '\0';
-            file->type = realloc(file->type, strlen(file->type) + 1);
-        }
-    }
+    return id;
+}
 
-    magic_close(cookie);
-    return file->type;
+/*
+ * Return the MIME type string of the specified file.  The string is
+ * interned, the caller should not free the pointer returned.
+ */
+const char *get_mime_type(struct rpminspect *ri, rpmfile_entry_t *file)
+{
+    return intern_string(get_mime_type_id(ri, file));
 }
 
 /* Return true if the named file is a text file according to libmagic */
-bool is_text_file(rpmfile_entry_t *file)
+bool is_text_file(struct rpminspect *ri, rpmfile_entry_t *file)
 {
     bool ret = false;
-    char *type = NULL;
+    const char *type = NULL;
 
+    assert(ri != NULL);
     assert(file != NULL);
-    type = get_mime_type(file);
+    type = get_mime_type(ri, file);
 
     if (strprefix(type, "text/")) {
         ret = true;
@@ -24,9 +24,10 @@
  */
 
 struct format formats[] = {
-    { FORMAT_TEXT, "text", &output_text },
-    { FORMAT_JSON, "json", &output_json },
-    { -1, NULL, NULL }
+    { FORMAT_TEXT, "text", &output_text, &text_sink },
+    { FORMAT_JSON, "json", &output_json, NULL },
+    { FORMAT_JSONL, "jsonl", &output_jsonl, &jsonl_sink },
+    { -1, NULL, NULL, NULL }
 };
 
 const char *format_desc(unsigned int format)
@@ -36,6 +37,8 @@ const char *format_desc(unsigned int format)
             return _("Plain text suitable for the console and piping through paging programs.");
         case FORMAT_JSON:
             return _("Results organized as a JSON data structure suitable for reading by web applications and other frontend tools.");
+        case FORMAT_JSONL:
+            return _("One JSON object per result per line, written as the inspections run.  Suitable for large result sets and streaming consumers.");
         default:
             return NULL;
     }
@@ -25,5 +25,6 @@
 
 #define FORMAT_TEXT 0
 #define FORMAT_JSON 1
+#define FORMAT_JSONL 2
 
 #endif
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * JSON Lines output: one JSON object per result, each on its own
+ * line, written as the results come in.  Each object carries the
+ * inspection header along with the fields the json format uses.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <json.h>
+
+#include "rpminspect.h"
+
+/* State of a JSON Lines results sink */
+struct jsonl_output {
+    FILE *fp;
+    bool close_fp;
+};
+
+static void jsonl_add(results_sink_t *sink, const results_entry_t *result) {
+    struct jsonl_output *out = sink->data;
+    struct json_object *jr = NULL;
+
+    jr = json_object_new_object();
+    json_object_object_add(jr, "inspection", json_object_new_string(result->header));
+    json_object_object_add(jr, "result", json_object_new_string(strseverity(result->severity)));
+    json_object_object_add(jr, "waiver authorization", json_object_new_string(strwaiverauth(result->waiverauth)));
+
+    if (result->msg != NULL) {
+        json_object_object_add(jr, "message", json_object_new_string(result->msg));
+    }
+
+    if (result->screendump != NULL) {
+        json_object_object_add(jr, "screendump", json_object_new_string(result->screendump));
+    }
+
+    if (result->remedy != NULL) {
+        json_object_object_add(jr, "remedy", json_object_new_string(result->remedy));
+    }
+
+    fprintf(out->fp, "%s\n", json_object_to_json_string_ext(jr, JSON_C_TO_STRING_PLAIN));
+    json_object_put(jr);
+    return;
+}
+
+static void jsonl_close(results_sink_t *sink) {
+    struct jsonl_output *out = sink->data;
+    int r = 0;
+
+    r = fflush(out->fp);
+    assert(r == 0);
+
+    if (out->close_fp) {
+        r = fclose(out->fp);
+        assert(r == 0);
+    }
+
+    free(out);
+    free(sink);
+    return;
+}
+
+/*
+ * Return a results sink that writes JSON Lines to dest, or to stdout
+ * if dest is NULL.  Returns NULL if dest cannot be opened.
+ */
+results_sink_t *jsonl_sink(const char *dest) {
+    results_sink_t *sink = NULL;
+    struct jsonl_output *out = NULL;
+    FILE *fp = NULL;
+
+    /* default to stdout unless a filename was specified */
+    if (dest == NULL) {
+        fp = stdout;
+    } else {
+        fp = fopen(dest, "w");
+
+        if (fp == NULL) {
+            fprintf(stderr, _("*** Error opening %s for writing: %s\n"), dest, strerror(errno));
+            fflush(stderr);
+            return NULL;
+        }
+    }
+
+    out = calloc(1, sizeof(*out));
+    assert(out != NULL);
+    out->fp = fp;
+    out->close_fp = (dest != NULL);
+
+    sink = calloc(1, sizeof(*sink));
+    assert(sink != NULL);
+    sink->add = jsonl_add;
+    sink->close = jsonl_close;
+    sink->data = out;
+    return sink;
+}
+
+/*
+ * Output a results_t in JSON Lines format.
+ */
+void output_jsonl(const results_t *results, const char *dest) {
+    results_sink_t *sink = NULL;
+    results_entry_t *result = NULL;
+
+    if ((sink = jsonl_sink(dest)) == NULL) {
+        return;
+    }
+
+    TAILQ_FOREACH(result, results, items) {
+        sink->add(sink, result);
+    }
+
+    sink->close(sink);
+    return;
+}
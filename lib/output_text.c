@@ -17,112 +17,169 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
 
 #include "rpminspect.h"
 
+/* State of a text results sink */
+struct text_output {
+    FILE *fp;
+    bool close_fp;
+    char *header;
+    int count;
+    bool first;
+    size_t width;
+};
+
 /*
- * Output a results_t in plain text format.
+ * Write one result.  A header is written each time the inspection
+ * changes, and results are numbered within an inspection.
  */
-void output_text(const results_t *results, const char *dest) {
-    results_entry_t *result = NULL;
+static void text_add(results_sink_t *sink, const results_entry_t *result) {
+    struct text_output *out = sink->data;
+    FILE *fp = out->fp;
     int r = 0;
-    int count = 0;
     int len = 0;
-    bool displayed_header = false;
-    bool first = true;
-    FILE *fp = NULL;
-    char *header = NULL;
     char *msg = NULL;
-    size_t width = tty_width();
 
-    /* default to stdout unless a filename was specified */
-    if (dest == NULL) {
-        fp = stdout;
-    } else {
-        fp = fopen(dest, "w");
+    if (out->header == NULL || strcmp(out->header, result->header)) {
+        free(out->header);
+        out->header = strdup(result->header);
+        assert(out->header != NULL);
+        out->count = 1;
 
-        if (fp == NULL) {
-            fprintf(stderr, _("*** Error opening %s for writing: %s\n"), dest, strerror(errno));
-            fflush(stderr);
-            return;
+        if (!out->first) {
+            fprintf(fp, "\n");
         }
-    }
 
-    /* output the results */
-    TAILQ_FOREACH(result, results, items) {
-        if (header == NULL || strcmp(header, result->header)) {
-            header = result->header;
-            displayed_header = false;
-            count = 1;
+        len = strlen(out->header) + 1;
+        fprintf(fp, "%s:\n", out->header);
+
+        for (r = 0; r < len; r++) {
+            fprintf(fp, "-");
         }
 
-        if (first) {
-            first = false;
+        fprintf(fp, "\n");
+    } else {
+        fprintf(fp, "\n");
+    }
+
+    out->first = false;
+
+    if (result->msg != NULL) {
+        xasprintf(&msg, "%d) %s\n", out->count++, result->msg);
+
+        if (out->width) {
+            printwrap(msg, out->width, 0, fp);
         } else {
-            fprintf(fp, "\n");
+            fprintf(fp, "%s", msg);
         }
 
-        if (!displayed_header) {
-            len = strlen(header) + 1;
-            fprintf(fp, "%s:\n", header);
+        fprintf(fp, "\n");
+        free(msg);
+    }
 
-            for (r = 0; r < len; r++) {
-                fprintf(fp, "-");
-            }
+    fprintf(fp, _("Result: %s\n"), strseverity(result->severity));
 
-            fprintf(fp, "\n");
-            displayed_header = true;
+    if (result->severity != RESULT_OK && result->severity != RESULT_INFO) {
+        fprintf(fp, _("Waiver Authorization: %s\n\n"), strwaiverauth(result->waiverauth));
+
+        if (result->screendump != NULL) {
+            fprintf(fp, _("Screendump:\n%s\n\n"), result->screendump);
         }
 
-        if (result->msg != NULL) {
-            xasprintf(&msg, "%d) %s\n", count++, result->msg);
+        if (result->remedy != NULL) {
+            xasprintf(&msg, _("Suggested Remedy:\n%s"), result->remedy);
 
-            if (width) {
-                printwrap(msg, width, 0, fp);
+            if (out->width) {
+                printwrap(msg, out->width, 0, fp);
             } else {
                 fprintf(fp, "%s", msg);
             }
 
-            fprintf(fp, "\n");
             free(msg);
         }
 
-        fprintf(fp, _("Result: %s\n"), strseverity(result->severity));
+        fprintf(fp, "\n");
+    }
 
-        if (result->severity != RESULT_OK && result->severity != RESULT_INFO) {
-            fprintf(fp, _("Waiver Authorization: %s\n\n"), strwaiverauth(result->waiverauth));
+    return;
+}
 
-            if (result->screendump != NULL) {
-                fprintf(fp, _("Screendump:\n%s\n\n"), result->screendump);
-            }
+static void text_close(results_sink_t *sink) {
+    struct text_output *out = sink->data;
+    int r = 0;
 
-            if (result->remedy != NULL) {
-                xasprintf(&msg, _("Suggested Remedy:\n%s"), result->remedy);
+    /* tidy up and return */
+    r = fflush(out->fp);
+    assert(r == 0);
 
-                if (width) {
-                    printwrap(msg, width, 0, fp);
-                } else {
-                    fprintf(fp, "%s", msg);
-                }
+    if (out->close_fp) {
+        r = fclose(out->fp);
+        assert(r == 0);
+    }
 
-                free(msg);
-            }
+    free(out->header);
+    free(out);
+    free(sink);
+    return;
+}
 
-            fprintf(fp, "\n");
+/*
+ * Return a results sink that writes plain text to dest, or to stdout
+ * if dest is NULL.  Returns NULL if dest cannot be opened.
+ */
+results_sink_t *text_sink(const char *dest) {
+    results_sink_t *sink = NULL;
+    struct text_output *out = NULL;
+    FILE *fp = NULL;
+
+    /* default to stdout unless a filename was specified */
+    if (dest == NULL) {
+        fp = stdout;
+    } else {
+        fp = fopen(dest, "w");
+
+        if (fp == NULL) {
+            fprintf(stderr, _("*** Error opening %s for writing: %s\n"), dest, strerror(errno));
+            fflush(stderr);
+            return NULL;
         }
     }
 
-    /* tidy up and return */
-    r = fflush(fp);
-    assert(r == 0);
+    out = calloc(1, sizeof(*out));
+    assert(out != NULL);
+    out->fp = fp;
+    out->close_fp = (dest != NULL);
+    out->first = true;
+    out->width = tty_width();
+
+    sink = calloc(1, sizeof(*sink));
+    assert(sink != NULL);
+    sink->add = text_add;
+    sink->close = text_close;
+    sink->data = out;
+    return sink;
+}
 
-    if (dest != NULL) {
-        r = fclose(fp);
-        assert(r == 0);
+/*
+ * Output a results_t in plain text format.
+ */
+void output_text(const results_t *results, const char *dest) {
+    results_sink_t *sink = NULL;
+    results_entry_t *result = NULL;
+
+    if ((sink = text_sink(dest)) == NULL) {
+        return;
+    }
+
+    TAILQ_FOREACH(result, results, items) {
+        sink->add(sink, result);
     }
 
+    sink->close(sink);
     return;
 }
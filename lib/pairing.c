@@ -0,0 +1,504 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Pair up the files in the before and after builds of a package.
+ *
+ * Files are matched in passes, from the best kind of match to the
+ * worst, and each pass only looks at files earlier passes left
+ * unpaired:
+ *
+ *   1. The paths are the same.
+ *   2. The paths are the same once the version and version-release
+ *      of each package are replaced with a placeholder, e.g.
+ *      /usr/share/doc/foo-1.2/README and /usr/share/doc/foo-1.3/README.
+ *   3. The paths are the same once the digits in shared library
+ *      version suffixes and python3.X directories are replaced with a
+ *      placeholder, e.g. libfoo.so.1.2.3 and libfoo.so.2.0.0, or
+ *      /usr/lib/python3.8/ and /usr/lib/python3.9/.
+ *
+ * Passes 2 and 3 index the unpaired after files by their normalized
+ * path and look up each unpaired before file the same way.  Keys are
+ * built in a single reused buffer and copied into the index's arena,
+ * so there are no allocations per file.  A normalized path shared by
+ * more than one after file is not used for matching since there is
+ * no telling which file is the right one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include <sys/queue.h>
+#include <sys/stat.h>
+#include <rpm/header.h>
+
+#include "rpminspect.h"
+
+/* Placeholders used in normalized paths */
+#define KEY_VR      '\001'
+#define KEY_VERSION '\002'
+#define KEY_NUMBER  '#'
+
+/* Kinds of keys in the moved file index */
+#define MOVED_PATH    'p'
+#define MOVED_CONTENT 'c'
+
+/* Value for keys that more than one after file normalizes to */
+static const char ambiguous[] = "";
+
+/* Reused buffer for normalized paths */
+struct keybuf {
+    char *data;
+    size_t size;
+};
+
+/* What the version substitution pass replaces on each side */
+struct pairing {
+    const char *before_version;
+    const char *after_version;
+    char *before_vr;
+    char *after_vr;
+    bool versions;              /* true if pass 2 can find anything */
+};
+
+enum pass {
+    PASS_VERSION,
+    PASS_RENAME
+};
+
+static void set_peer(rpmfile_entry_t *before, rpmfile_entry_t *after)
+{
+    before->peer_file = after;
+    after->peer_file = before;
+}
+
+/*
+ * Replace vr and then version in key with placeholders.  Either may
+ * be NULL.  The key is rewritten in place since it can only get
+ * shorter.
+ */
+static void version_key(char *key, const char *vr, const char *version)
+{
+    size_t vrlen = (vr == NULL) ? 0 : strlen(vr);
+    size_t vlen = (version == NULL) ? 0 : strlen(version);
+    char *r = key;
+    char *w = key;
+
+    while (*r != '\0') {
+        if (vrlen > 0 && !strncmp(r, vr, vrlen)) {
+            *w++ = KEY_VR;
+            r += vrlen;
+        } else if (vlen > 0 && !strncmp(r, version, vlen)) {
+            *w++ = KEY_VERSION;
+            r += vlen;
+        } else {
+            *w++ = *r++;
+        }
+    }
+
+    *w = '\0';
+    return;
+}
+
+/*
+ * Replace the digits in a shared library version suffix and in
+ * python3.X and cpython-3X names with a placeholder.  The key is
+ * rewritten in place since it can only get shorter.  Returns true if
+ * anything was replaced.
+ */
+static bool rename_key(char *key)
+{
+    char *base = NULL;
+    char *so = NULL;
+    char *r = key;
+    char *w = key;
+    size_t skip = 0;
+    bool changed = false;
+
+    /* only a basename ending in .so.[0-9.]+ counts as a soname */
+    base = strrchr(key, '/');
+    so = strstr((base == NULL) ? key : base, ".so.");
+
+    if (so != NULL) {
+        so += 4;
+
+        if (*so == '\0' || strspn(so, "0123456789.") != strlen(so)) {
+            so = NULL;
+        }
+    }
+
+    while (*r != '\0') {
+        if (so != NULL && r >= so && isdigit((unsigned char) *r)) {
+            skip = 0;
+        } else if (strprefix(r, "python3.") && isdigit((unsigned char) r[8])) {
+            skip = 8;
+        } else if (strprefix(r, "cpython-3") && isdigit((unsigned char) r[9])) {
+            skip = 9;
+        } else {
+            *w++ = *r++;
+            continue;
+        }
+
+        /* keep the prefix, collapse the number that follows it */
+        while (skip-- > 0) {
+            *w++ = *r++;
+        }
+
+        while (isdigit((unsigned char) *r)) {
+            r++;
+        }
+
+        *w++ = KEY_NUMBER;
+        changed = true;
+    }
+
+    *w = '\0';
+    return changed;
+}
+
+/*
+ * Return the key for file in the given pass, or NULL if the pass
+ * cannot match it.  The key is built in kb.
+ */
+static const char *pass_key(struct keybuf *kb, const struct pairing *p, enum pass pass, const rpmfile_entry_t *file, bool before)
+{
+    size_t len = strlen(file->localpath) + 1;
+
+    if (kb->size < len) {
+        kb->data = realloc(kb->data, len);
+        assert(kb->data != NULL);
+        kb->size = len;
+    }
+
+    memcpy(kb->data, file->localpath, len);
+
+    /*
+     * Renames go first so version numbers that happen to appear in
+     * a soname are not taken for the package version.  An unchanged
+     * key was already tried by the earlier passes.
+     */
+    if (pass == PASS_RENAME && !rename_key(kb->data)) {
+        return NULL;
+    }
+
+    if (p->versions) {
+        if (before) {
+            version_key(kb->data, p->before_vr, p->before_version);
+        } else {
+            version_key(kb->data, p->after_vr, p->after_version);
+        }
+    }
+
+    return kb->data;
+}
+
+/* Match the files left over from the earlier passes by their keys for this pass */
+static void pair_by_key(const struct pairing *p, enum pass pass, rpmfile_t *before, rpmfile_t *after, size_t unpaired)
+{
+    hashmap_t *table = NULL;
+    rpmfile_entry_t *file = NULL;
+    rpmfile_entry_t *peer = NULL;
+    struct keybuf kb = { NULL, 0 };
+    const char *key = NULL;
+
+    table = hashmap_new(unpaired);
+
+    TAILQ_FOREACH(file, after, items) {
+        if (file->peer_file != NULL || (key = pass_key(&kb, p, pass, file, false)) == NULL) {
+            continue;
+        }
+
+        if (!hashmap_put(table, key, file)) {
+            hashmap_put(table, key, (void *) ambiguous);
+        }
+    }
+
+    TAILQ_FOREACH(file, before, items) {
+        if (file->peer_file != NULL || (key = pass_key(&kb, p, pass, file, true)) == NULL) {
+            continue;
+        }
+
+        peer = hashmap_get(table, key);
+
+        if (peer != NULL && peer != (void *) ambiguous) {
+            set_peer(file, peer);
+            hashmap_remove(table, key);
+        }
+    }
+
+    free(kb.data);
+    hashmap_free(table, NULL);
+    return;
+}
+
+/* Find matching files between the before and after lists, and populate the "peer_file" members of the entries. */
+void find_file_peers(rpmfile_t *before, rpmfile_t *after)
+{
+    struct pairing p;
+    Header before_hdr;
+    Header after_hdr;
+    hashmap_t *table = NULL;
+    rpmfile_entry_t *file = NULL;
+    rpmfile_entry_t *peer = NULL;
+    size_t count = 0;
+
+    assert(before != NULL);
+    assert(after != NULL);
+
+    /* Make sure there is something to match */
+    if (TAILQ_EMPTY(before) || TAILQ_EMPTY(after)) {
+        return;
+    }
+
+    /* Pass 1: the paths match */
+    TAILQ_FOREACH(file, after, items) {
+        count++;
+    }
+
+    table = hashmap_new(count);
+
+    TAILQ_FOREACH(file, after, items) {
+        hashmap_put(table, file->localpath, file);
+    }
+
+    TAILQ_FOREACH(file, before, items) {
+        if ((peer = hashmap_get(table, file->localpath)) != NULL) {
+            set_peer(file, peer);
+            count--;
+        }
+    }
+
+    hashmap_free(table, NULL);
+
+    if (count == 0) {
+        return;
+    }
+
+    /* The version strings only need to be read once per package */
+    before_hdr = TAILQ_FIRST(before)->rpm_header;
+    after_hdr = TAILQ_FIRST(after)->rpm_header;
+
+    memset(&p, 0, sizeof(p));
+    p.before_version = headerGetString(before_hdr, RPMTAG_VERSION);
+    p.after_version = headerGetString(after_hdr, RPMTAG_VERSION);
+
+    if (p.before_version != NULL && p.after_version != NULL) {
+        xasprintf(&p.before_vr, "%s-%s", p.before_version, headerGetString(before_hdr, RPMTAG_RELEASE));
+        xasprintf(&p.after_vr, "%s-%s", p.after_version, headerGetString(after_hdr, RPMTAG_RELEASE));
+
+        /* only substitute what actually changed */
+        if (!strcmp(p.before_version, p.after_version)) {
+            p.before_version = NULL;
+            p.after_version = NULL;
+        }
+
+        if (!strcmp(p.before_vr, p.after_vr)) {
+            free(p.before_vr);
+            free(p.after_vr);
+            p.before_vr = NULL;
+            p.after_vr = NULL;
+        }
+
+        p.versions = (p.before_vr != NULL || p.before_version != NULL);
+    }
+
+    /* Pass 2: the paths match with the version substituted */
+    if (p.versions) {
+        pair_by_key(&p, PASS_VERSION, before, after, count);
+    }
+
+    /* Pass 3: the paths match with soname and python versions substituted */
+    pair_by_key(&p, PASS_RENAME, before, after, count);
+
+    free(p.before_vr);
+    free(p.after_vr);
+    return;
+}
+
+/*
+ * Build the key for a file in the moved file index: the kind of key,
+ * the package architecture, and the path or checksum.
+ */
+static const char *move_key(struct keybuf *kb, char kind, const char *arch, const char *s)
+{
+    size_t len = strlen(arch) + strlen(s) + 3;
+
+    if (kb->size < len) {
+        kb->data = realloc(kb->data, len);
+        assert(kb->data != NULL);
+        kb->size = len;
+    }
+
+    snprintf(kb->data, len, "%c%s:%s", kind, arch, s);
+    return kb->data;
+}
+
+/* Add the unpaired after files to the moved file index */
+static void index_moved(hashmap_t *table, struct keybuf *kb, const struct rpminspect *ri, char kind)
+{
+    rpmpeer_entry_t *peer = NULL;
+    rpmfile_entry_t *file = NULL;
+    const char *arch = NULL;
+    const char *key = NULL;
+
+    TAILQ_FOREACH(peer, ri->peers, items) {
+        if (peer->after_files == NULL || headerIsSource(peer->after_hdr)) {
+            continue;
+        }
+
+        arch = get_rpm_header_arch(peer->after_hdr);
+
+        TAILQ_FOREACH(file, peer->after_files, items) {
+            if (file->peer_file != NULL) {
+                continue;
+            }
+
+            if (kind == MOVED_PATH) {
+                key = move_key(kb, kind, arch, file->localpath);
+            } else if (S_ISREG(file->st.st_mode) && file->st.st_size > 0 && checksum(ri, file) != NULL) {
+                key = move_key(kb, kind, arch, checksum(ri, file));
+            } else {
+                continue;
+            }
+
+            if (!hashmap_put(table, key, file)) {
+                hashmap_put(table, key, (void *) ambiguous);
+            }
+        }
+    }
+
+    return;
+}
+
+/* Look up a before file in the moved file index, in its own arch then noarch */
+static rpmfile_entry_t *find_moved(hashmap_t *table, struct keybuf *kb, const char *arch, char kind, const char *s)
+{
+    rpmfile_entry_t *peer = NULL;
+
+    peer = hashmap_get(table, move_key(kb, kind, arch, s));
+
+    if (peer == NULL && strcmp(arch, "noarch")) {
+        peer = hashmap_get(table, move_key(kb, kind, "noarch", s));
+    }
+
+    /* already taken by another before file */
+    if (peer == (void *) ambiguous || (peer != NULL && peer->peer_file != NULL)) {
+        return NULL;
+    }
+
+    return peer;
+}
+
+/* Pair each unpaired before file with what it finds in the moved file index */
+static void pair_moved(hashmap_t *table, struct keybuf *kb, const struct rpminspect *ri, char kind)
+{
+    rpmpeer_entry_t *peer = NULL;
+    rpmfile_entry_t *file = NULL;
+    rpmfile_entry_t *moved = NULL;
+    const char *arch = NULL;
+
+    TAILQ_FOREACH(peer, ri->peers, items) {
+        if (peer->before_files == NULL || headerIsSource(peer->before_hdr)) {
+            continue;
+        }
+
+        arch = get_rpm_header_arch(peer->before_hdr);
+
+        TAILQ_FOREACH(file, peer->before_files, items) {
+            if (file->peer_file != NULL) {
+                continue;
+            }
+
+            if (kind == MOVED_PATH) {
+                moved = find_moved(table, kb, arch, kind, file->localpath);
+            } else if (S_ISREG(file->st.st_mode) && file->st.st_size > 0 && checksum(ri, file) != NULL) {
+                moved = find_moved(table, kb, arch, kind, checksum(ri, file));
+            } else {
+                continue;
+            }
+
+            if (moved != NULL) {
+                set_peer(file, moved);
+            }
+        }
+    }
+
+    return;
+}
+
+/*
+ * Pair files that moved to a different subpackage.  Run after
+ * find_file_peers() has paired the files within each peer.
+ *
+ * The files each peer left unpaired go in one index for the whole
+ * build, keyed by architecture and path.  Each unpaired before file
+ * is looked up in its own architecture and then in noarch, since
+ * files commonly move from an arch specific subpackage to a noarch
+ * one.  Files left over after that are indexed and looked up by
+ * SHA-256 the same way, which catches files that were both moved and
+ * renamed.  Only files no match was found for are checksummed, and
+ * their checksums usually come from the package header.
+ *
+ * Moved files get a peer_file in another package, so they are
+ * compared like any other pair instead of being reported as removed
+ * and added.  The movedfiles inspection reports them.
+ */
+void find_moved_files(struct rpminspect *ri)
+{
+    hashmap_t *table = NULL;
+    struct keybuf kb = { NULL, 0 };
+    rpmpeer_entry_t *peer = NULL;
+    rpmfile_entry_t *file = NULL;
+    size_t unpaired = 0;
+
+    assert(ri != NULL);
+
+    if (ri->peers == NULL) {
+        return;
+    }
+
+    /* Nothing to do unless a before file is still unpaired */
+    TAILQ_FOREACH(peer, ri->peers, items) {
+        if (peer->before_files == NULL || headerIsSource(peer->before_hdr)) {
+            continue;
+        }
+
+        TAILQ_FOREACH(file, peer->before_files, items) {
+            if (file->peer_file == NULL) {
+                unpaired++;
+            }
+        }
+    }
+
+    if (unpaired == 0) {
+        return;
+    }
+
+    table = hashmap_new(unpaired);
+
+    /* By path first, then by content */
+    index_moved(table, &kb, ri, MOVED_PATH);
+    pair_moved(table, &kb, ri, MOVED_PATH);
+    index_moved(table, &kb, ri, MOVED_CONTENT);
+    pair_moved(table, &kb, ri, MOVED_CONTENT);
+
+    free(kb.data);
+    hashmap_free(table, NULL);
+    return;
+}
@@ -18,10 +18,189 @@
  */
 
 #include <stdbool.h>
+#include <stdlib.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "rpminspect.h"
 
+/* A payload waiting to be extracted by the extraction pool */
+struct extract_job {
+    const char *pkg;
+    Header hdr;
+    rpmfile_t **files;        /* where to store the extracted file list */
+    TAILQ_ENTRY(extract_job) items;
+};
+
+/*
+ * Threads extracting payloads while add_peer() keeps finding more
+ * packages.  Decompression is CPU bound, so payloads for different
+ * packages are extracted concurrently up to ri->extract_jobs at a time.
+ */
+struct extract_pool {
+    struct rpminspect *ri;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    TAILQ_HEAD(, extract_job) queue;
+    bool done;                /* no more jobs will be queued */
+    pthread_t *threads;
+    unsigned int nthreads;
+};
+
+static void *extract_worker(void *arg)
+{
+    struct extract_pool *pool = arg;
+    struct extract_job *job = NULL;
+
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+
+        while (TAILQ_EMPTY(&pool->queue) && !pool->done) {
+            pthread_cond_wait(&pool->cond, &pool->lock);
+        }
+
+        if (TAILQ_EMPTY(&pool->queue)) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+
+        job = TAILQ_FIRST(&pool->queue);
+        TAILQ_REMOVE(&pool->queue, job, items);
+        pthread_mutex_unlock(&pool->lock);
+
+        /* Each job owns its file list slot, nothing else is shared */
+        *job->files = extract_rpm(pool->ri, job->pkg, job->hdr);
+        free(job);
+    }
+
+    return NULL;
+}
+
+/*
+ * Start the extraction pool if more than one payload may be extracted
+ * at a time.  Returns NULL if extraction should happen inline.
+ */
+static struct extract_pool *start_extract_pool(struct rpminspect *ri)
+{
+    unsigned int i;
+    unsigned int limit;
+    struct extract_pool *pool = NULL;
+
+    limit = (ri->extract_jobs > 0) ? ri->extract_jobs : ri->jobs;
+
+    if (limit <= 1) {
+        return NULL;
+    }
+
+    pool = calloc(1, sizeof(*pool));
+    assert(pool != NULL);
+    pool->ri = ri;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    TAILQ_INIT(&pool->queue);
+
+    pool->threads = calloc(limit, sizeof(*pool->threads));
+    assert(pool->threads != NULL);
+
+    for (i = 0; i < limit; i++) {
+        if (pthread_create(&pool->threads[pool->nthreads], NULL, extract_worker, pool) != 0) {
+            break;
+        }
+
+        pool->nthreads++;
+    }
+
+    /* Could not start any threads, extract inline */
+    if (pool->nthreads == 0) {
+        free(pool->threads);
+        pthread_cond_destroy(&pool->cond);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+/*
+ * Extract a payload, either right away or by handing it to the
+ * extraction pool.
+ */
+static void queue_extract(struct rpminspect *ri, const char *pkg, Header hdr, rpmfile_t **files)
+{
+    struct extract_job *job = NULL;
+
+    if (ri->extractor == NULL) {
+        *files = extract_rpm(ri, pkg, hdr);
+        return;
+    }
+
+    job = calloc(1, sizeof(*job));
+    assert(job != NULL);
+    job->pkg = pkg;
+    job->hdr = hdr;
+    job->files = files;
+
+    pthread_mutex_lock(&ri->extractor->lock);
+    TAILQ_INSERT_TAIL(&ri->extractor->queue, job, items);
+    pthread_cond_signal(&ri->extractor->cond);
+    pthread_mutex_unlock(&ri->extractor->lock);
+
+    return;
+}
+
+/*
+ * Wait for all queued payloads to be extracted and pair up the files
+ * of each peer, then look for files that moved between subpackages.
+ * Finally build the file tables.  Call once all packages have been
+ * added with add_peer().
+ */
+void finish_peers(struct rpminspect *ri)
+{
+    unsigned int i;
+    struct extract_pool *pool = NULL;
+    rpmpeer_entry_t *peer = NULL;
+
+    assert(ri != NULL);
+
+    if ((pool = ri->extractor) == NULL) {
+        /* add_peer() already paired the files of each peer */
+        find_moved_files(ri);
+        build_file_tables(ri);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->done = true;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->nthreads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    free(pool->threads);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+    ri->extractor = NULL;
+
+    /* Both sides of every peer are now available */
+    if (ri->peers == NULL) {
+        return;
+    }
+
+    TAILQ_FOREACH(peer, ri->peers, items) {
+        if (peer->before_files && peer->after_files) {
+            find_file_peers(peer->before_files, peer->after_files);
+        }
+    }
+
+    find_moved_files(ri);
+    build_file_tables(ri);
+    return;
+}
+
 /*
  * Initialize a new rpmpeer_t list.
  */
@@ -34,6 +213,31 @@ rpmpeer_t *init_rpmpeer(void) {
     return peers;
 }
 
+/*
+ * Bytes held by the arenas of every file list in peers.
+ */
+size_t rpmpeer_arena_size(const rpmpeer_t *peers)
+{
+    const rpmpeer_entry_t *entry = NULL;
+    size_t ret = 0;
+
+    if (peers == NULL) {
+        return 0;
+    }
+
+    TAILQ_FOREACH(entry, peers, items) {
+        if (entry->before_files != NULL) {
+            ret += arena_size(entry->before_files->arena);
+        }
+
+        if (entry->after_files != NULL) {
+            ret += arena_size(entry->after_files->arena);
+        }
+    }
+
+    return ret;
+}
+
 /*
  * Free memory associated with an rpmpeer_t list.
  */
@@ -68,7 +272,8 @@ void free_rpmpeer(rpmpeer_t *peers) {
 /*
  * Add the specified package as a peer in the list of packages.
  */
-int add_peer(rpmpeer_t **peers, int whichbuild, bool fetch_only, const char *pkg, Header hdr) {
+int add_peer(struct rpminspect *ri, int whichbuild, bool fetch_only, const char *pkg, Header hdr) {
+    rpmpeer_t **peers = NULL;
     rpmpeer_entry_t *peer = NULL;
     bool found = false;
     const char *newname = NULL;
@@ -78,10 +283,17 @@ int add_peer(rpmpeer_t **peers, int whichbuild, bool fetch_only, const char *pkg
     bool existingsrc = false;
     bool newsrc = false;
 
-    assert(peers != NULL);
+    assert(ri != NULL);
     assert(pkg != NULL);
     assert(hdr != NULL);
 
+    peers = &ri->peers;
+
+    /* Start extracting in the background with the first package */
+    if (!fetch_only && ri->extractor == NULL && ri->peers == NULL) {
+        ri->extractor = start_extract_pool(ri);
+    }
+
     if (*peers == NULL) {
         *peers = init_rpmpeer();
     }
@@ -131,7 +343,7 @@ int add_peer(rpmpeer_t **peers, int whichbuild, bool fetch_only, const char *pkg
         if (fetch_only) {
             peer->before_files = NULL;
         } else {
-            peer->before_files = extract_rpm(pkg, hdr);
+            queue_extract(ri, peer->before_rpm, hdr, &peer->before_files);
         }
     } else if (whichbuild == AFTER_BUILD) {
         peer->after_hdr = hdr;
@@ -140,7 +352,7 @@ int add_peer(rpmpeer_t **peers, int whichbuild, bool fetch_only, const char *pkg
         if (fetch_only) {
             peer->after_files = NULL;
         } else {
-            peer->after_files = extract_rpm(pkg, hdr);
+            queue_extract(ri, peer->after_rpm, hdr, &peer->after_files);
         }
     }
 
@@ -148,7 +360,8 @@ int add_peer(rpmpeer_t **peers, int whichbuild, bool fetch_only, const char *pkg
         TAILQ_INSERT_TAIL(*peers, peer, items);
     }
 
-    if (peer->before_files && peer->after_files) {
+    /* With the extraction pool, finish_peers() pairs the files */
+    if (ri->extractor == NULL && peer->before_files && peer->after_files) {
         find_file_peers(peer->before_files, peer->after_files);
     }
 
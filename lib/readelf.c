@@ -19,6 +19,7 @@
 
 #include <assert.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -49,22 +50,28 @@ Elf64_Half get_elf_type(Elf *elf)
     return ehdr.e_type;
 }
 
+/* libelf version check, done once even with several threads */
+static pthread_once_t libelf_once = PTHREAD_ONCE_INIT;
+static bool libelf_ok = false;
+
+static void init_libelf(void)
+{
+    libelf_ok = (elf_version(EV_CURRENT) != EV_NONE);
+    return;
+}
+
 static Elf * get_elf_with_kind(const char *fullpath, int *out_fd, Elf_Kind kind)
 {
     int fd;
     Elf *elf = NULL;
     struct stat sbuf;
 
-    static bool initialized = false;
-
     /* library version check */
-    if (!initialized) {
-        if (elf_version(EV_CURRENT) == EV_NONE) {
-            fprintf(stderr, _("libelf version mismatch\n"));
-            return NULL;
-        }
+    pthread_once(&libelf_once, init_libelf);
 
-        initialized = true;
+    if (!libelf_ok) {
+        fprintf(stderr, _("libelf version mismatch\n"));
+        return NULL;
     }
 
     /* make sure this is a regular file */
@@ -326,6 +333,270 @@ char *get_elf_soname(const char *filepath) {
     return soname;
 }
 
+/* Return the GNU build-id in a note section as a hex string, or NULL */
+static char *read_build_id(Elf_Data *data)
+{
+    GElf_Nhdr nhdr;
+    size_t offset = 0;
+    size_t name_offset;
+    size_t desc_offset;
+    const unsigned char *desc = NULL;
+    char *build_id = NULL;
+    size_t i;
+
+    while ((offset = gelf_getnote(data, offset, &nhdr, &name_offset, &desc_offset)) > 0) {
+        if (nhdr.n_type != NT_GNU_BUILD_ID || nhdr.n_namesz != sizeof(ELF_NOTE_GNU) ||
+            memcmp((const char *) data->d_buf + name_offset, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU))) {
+            continue;
+        }
+
+        desc = (const unsigned char *) data->d_buf + desc_offset;
+        build_id = calloc((nhdr.n_descsz * 2) + 1, 1);
+        assert(build_id != NULL);
+
+        for (i = 0; i < nhdr.n_descsz; i++) {
+            sprintf(build_id + (i * 2), "%02x", desc[i]);
+        }
+
+        break;
+    }
+
+    return build_id;
+}
+
+/*
+ * Return the set of named symbols in a symbol table.  The names are
+ * the ones in the string table, nothing is copied.
+ */
+static symset_t *read_symbols(Elf *elf, const GElf_Shdr *shdr, Elf_Data *data)
+{
+    GElf_Sym sym;
+    const char **names = NULL;
+    const char *name = NULL;
+    symset_t *set = NULL;
+    size_t nentries;
+    size_t n = 0;
+    size_t i;
+
+    nentries = (shdr->sh_entsize > 0) ? shdr->sh_size / shdr->sh_entsize : 0;
+    names = calloc(nentries + 1, sizeof(*names));
+    assert(names != NULL);
+
+    for (i = 0; i < nentries; i++) {
+        if (gelf_getsym(data, i, &sym) == NULL) {
+            continue;
+        }
+
+        name = elf_strptr(elf, shdr->sh_link, sym.st_name);
+
+        if (name != NULL && *name != '\0') {
+            names[n++] = name;
+        }
+    }
+
+    set = symset_new(names, n);
+    free(names);
+    return set;
+}
+
+/*
+ * Read everything in elf_info_t from the open Elf.  Everything libelf
+ * would otherwise load lazily (section headers, section data, string
+ * table checks) is loaded here, so that later on several inspection
+ * threads can read the same Elf at once.
+ */
+static void read_elf_info(elf_info_t *info)
+{
+    Elf *elf = info->elf;
+    Elf_Scn *scn = NULL;
+    Elf_Data *data = NULL;
+    size_t shstrndx = 0;
+    size_t dynstr = 0;
+    size_t i;
+    size_t j;
+    const char *name = NULL;
+    string_entry_t *entry = NULL;
+
+    if (elf_getshdrstrndx(elf, &shstrndx) != 0 || elf_getshdrnum(elf, &info->shnum) != 0) {
+        info->shnum = 0;
+    }
+
+    info->shdrs = calloc(info->shnum + 1, sizeof(*info->shdrs));
+    assert(info->shdrs != NULL);
+    info->shnames = calloc(info->shnum + 1, sizeof(*info->shnames));
+    assert(info->shnames != NULL);
+
+    for (i = 1; i < info->shnum; i++) {
+        if ((scn = elf_getscn(elf, i)) == NULL || gelf_getshdr(scn, &info->shdrs[i]) == NULL) {
+            continue;
+        }
+
+        info->shnames[i] = elf_strptr(elf, shstrndx, info->shdrs[i].sh_name);
+        data = elf_getdata(scn, NULL);
+
+        if (data == NULL) {
+            continue;
+        }
+
+        if (info->shdrs[i].sh_type == SHT_STRTAB) {
+            elf_strptr(elf, i, 0);
+        } else if (info->shdrs[i].sh_type == SHT_DYNAMIC && info->dyn == NULL && info->shdrs[i].sh_entsize > 0) {
+            info->ndyn = info->shdrs[i].sh_size / info->shdrs[i].sh_entsize;
+            info->dyn = calloc(info->ndyn + 1, sizeof(*info->dyn));
+            assert(info->dyn != NULL);
+            dynstr = info->shdrs[i].sh_link;
+
+            for (j = 0; j < info->ndyn; j++) {
+                gelf_getdyn(data, j, &info->dyn[j]);
+            }
+        } else if (info->shdrs[i].sh_type == SHT_NOTE && info->build_id == NULL) {
+            info->build_id = read_build_id(data);
+        } else if (info->shdrs[i].sh_type == SHT_DYNSYM && info->dynsyms == NULL) {
+            info->dynsyms = read_symbols(elf, &info->shdrs[i], data);
+        }
+    }
+
+    if (info->dynsyms == NULL) {
+        info->dynsyms = symset_new(NULL, 0);
+    }
+
+    if (elf_getphdrnum(elf, &info->phnum) != 0) {
+        info->phnum = 0;
+    }
+
+    info->phdrs = calloc(info->phnum + 1, sizeof(*info->phdrs));
+    assert(info->phdrs != NULL);
+
+    for (i = 0; i < info->phnum; i++) {
+        gelf_getphdr(elf, i, &info->phdrs[i]);
+    }
+
+    /* The names of the dynamic tags we report on */
+    for (i = 0; i < info->ndyn && info->dyn[i].d_tag != DT_NULL; i++) {
+        if (info->dyn[i].d_tag != DT_SONAME && info->dyn[i].d_tag != DT_NEEDED) {
+            continue;
+        }
+
+        if ((name = elf_strptr(elf, dynstr, info->dyn[i].d_un.d_val)) == NULL) {
+            continue;
+        }
+
+        if (info->dyn[i].d_tag == DT_SONAME) {
+            info->soname = name;
+            continue;
+        }
+
+        if (info->needed == NULL) {
+            info->needed = calloc(1, sizeof(*info->needed));
+            assert(info->needed != NULL);
+            TAILQ_INIT(info->needed);
+        }
+
+        entry = calloc(1, sizeof(*entry));
+        assert(entry != NULL);
+        entry->data = (char *) name;
+        TAILQ_INSERT_TAIL(info->needed, entry, items);
+    }
+
+    return;
+}
+
+/*
+ * Open and read the file as an ELF object.  The file is mapped and
+ * its descriptor closed right away, so any number of these can be
+ * kept without running out of descriptors.  Returns an elf_info_t
+ * with a NULL elf if the file is not an ELF object.
+ */
+static elf_info_t *open_elf_info(const char *fullpath)
+{
+    elf_info_t *info = NULL;
+    int fd;
+
+    info = calloc(1, sizeof(*info));
+    assert(info != NULL);
+
+    pthread_once(&libelf_once, init_libelf);
+
+    if (!libelf_ok || (fd = open(fullpath, O_RDONLY | O_CLOEXEC)) == -1) {
+        return info;
+    }
+
+    info->elf = elf_begin(fd, ELF_C_READ_MMAP_PRIVATE, NULL);
+
+    if (info->elf == NULL || elf_kind(info->elf) != ELF_K_ELF || gelf_getehdr(info->elf, &info->ehdr) == NULL) {
+        elf_end(info->elf);
+        info->elf = NULL;
+        close(fd);
+        return info;
+    }
+
+    /* Everything is mapped (or read if it could not be), the descriptor is not needed */
+    elf_cntl(info->elf, ELF_C_FDREAD);
+    elf_cntl(info->elf, ELF_C_FDDONE);
+    close(fd);
+
+    read_elf_info(info);
+    return info;
+}
+
+/*
+ * Return the ELF analysis of a regular file, or NULL if it is not an
+ * ELF object (archives included).  The file is only opened and read
+ * the first time; after that every inspection gets the same
+ * elf_info_t, which lives until the file list is freed.  The caller
+ * must not call elf_end() on info->elf.
+ */
+const elf_info_t *get_elf_info(rpmfile_entry_t *file)
+{
+    elf_info_t *info = NULL;
+
+    assert(file != NULL);
+
+    lock_file_entry(file);
+    info = file->elf_info;
+    unlock_file_entry(file);
+
+    if (info == NULL) {
+        if (file->fullpath == NULL || !S_ISREG(file->st.st_mode)) {
+            return NULL;
+        }
+
+        info = open_elf_info(file->fullpath);
+
+        /* Another thread may have beaten us to it, keep the first one */
+        lock_file_entry(file);
+
+        if (file->elf_info == NULL) {
+            file->elf_info = info;
+        } else {
+            free_elf_info(info);
+        }
+
+        info = file->elf_info;
+        unlock_file_entry(file);
+    }
+
+    return (info->elf == NULL) ? NULL : info;
+}
+
+void free_elf_info(elf_info_t *info)
+{
+    if (info == NULL) {
+        return;
+    }
+
+    list_free(info->needed, NULL);
+    symset_free(info->dynsyms);
+    free(info->build_id);
+    free(info->dyn);
+    free(info->phdrs);
+    free(info->shnames);
+    free(info->shdrs);
+    elf_end(info->elf);
+    free(info);
+    return;
+}
+
 static string_list_t * get_elf_symbol_list(Elf *elf, bool (*filter)(const char *),
         uint32_t sh_type, const char *table_name)
 {
@@ -28,6 +28,27 @@
 
 #include "types.h"
 
+/*
+ * What is known about an ELF object after reading it once, see
+ * get_elf_info().  The strings point in to the mapped file and live
+ * as long as elf.
+ */
+struct _elf_info_t {
+    Elf *elf;                  /* NULL if the file is not an ELF object */
+    GElf_Ehdr ehdr;
+    size_t shnum;
+    GElf_Shdr *shdrs;          /* section headers, by section index */
+    const char **shnames;      /* section names, by section index */
+    size_t phnum;
+    GElf_Phdr *phdrs;          /* program headers */
+    GElf_Dyn *dyn;             /* the dynamic section, NULL if there is none */
+    size_t ndyn;
+    const char *soname;        /* DT_SONAME, NULL if there is none */
+    string_list_t *needed;     /* DT_NEEDED in order, NULL if there are none */
+    char *build_id;            /* NT_GNU_BUILD_ID in hex, NULL if there is none */
+    symset_t *dynsyms;         /* names in .dynsym, empty if there is none */
+};
+
 Elf * get_elf(const char *, int *);
 Elf * get_elf_archive(const char *, int *);
 Elf64_Half get_elf_type(Elf *);
@@ -37,6 +58,8 @@ Elf_Scn * get_elf_section(Elf *, int64_t, const char *, Elf_Scn *, GElf_Shdr *);
 Elf_Scn * get_elf_extended_section(Elf *, Elf_Scn *, GElf_Shdr *);
 GElf_Phdr * get_elf_phdr(Elf *, Elf64_Word, GElf_Phdr *);
 char *get_elf_soname(const char *);
+const elf_info_t *get_elf_info(rpmfile_entry_t *);
+void free_elf_info(elf_info_t *);
 
 bool have_dynamic_tag(Elf *, const Elf64_Sxword);
 bool get_dynamic_tags(Elf *, const Elf64_Sxword, GElf_Dyn **, size_t *, GElf_Shdr *);
@@ -47,4 +70,7 @@ string_list_t * get_elf_exported_functions(Elf *, bool (*)(const char *));
 typedef bool (*elf_ar_action)(Elf *, string_list_t **);
 void elf_archive_iterate(int, Elf *, elf_ar_action, string_list_t **);
 
+/* elfcmp.c */
+string_list_t *compare_elf(const elf_info_t *, const elf_info_t *);
+
 #endif
@@ -17,10 +17,26 @@
  */
 
 #include <sys/queue.h>
+#include <string.h>
 #include <assert.h>
 
 #include "rpminspect.h"
 
+/*
+ * Results normally collect in ri->results and are output at the end.
+ * When ri->results_sink is set, each one is handed to the sink as
+ * soon as its place in the output is known and then dropped, so
+ * memory does not grow with the number of results.  Results reported
+ * on a thread with its own list (below) are still held until that
+ * list is merged.
+ *
+ * When set, add_result() on this thread appends to this list rather
+ * than ri->results.  foreach_peer_file_parallel() uses this to keep
+ * the results for each file apart until they are merged back in
+ * order.
+ */
+static __thread results_t *thread_results = NULL;
+
 /*
  * Initialize a new results_t list.
  */
@@ -77,17 +93,33 @@ void add_result(struct rpminspect *ri, severity_t severity,
                 waiverauth_t waiverauth, const char *header, char *msg,
                 char *screendump, const char *remedy) {
     results_entry_t *entry = NULL;
+    results_entry_t streamed;
 
     assert(ri != NULL);
     assert(severity >= 0);
     assert(header != NULL);
 
-    if (severity > ri->worst_result) {
-        ri->worst_result = severity;
-    }
-
-    if (ri->results == NULL) {
-        ri->results = init_results();
+    if (thread_results == NULL) {
+        if (severity > ri->worst_result) {
+            ri->worst_result = severity;
+        }
+
+        /* nothing to keep, the sink has what it needs when it returns */
+        if (ri->results_sink != NULL) {
+            memset(&streamed, 0, sizeof(streamed));
+            streamed.severity = severity;
+            streamed.waiverauth = waiverauth;
+            streamed.header = (char *) header;
+            streamed.msg = msg;
+            streamed.screendump = screendump;
+            streamed.remedy = (char *) remedy;
+            ri->results_sink->add(ri->results_sink, &streamed);
+            return;
+        }
+
+        if (ri->results == NULL) {
+            ri->results = init_results();
+        }
     }
 
     entry = calloc(1, sizeof(*entry));
@@ -109,6 +141,85 @@ void add_result(struct rpminspect *ri, severity_t severity,
         entry->remedy = strdup(remedy);
     }
 
-    TAILQ_INSERT_TAIL(ri->results, entry, items);
+    if (thread_results == NULL) {
+        TAILQ_INSERT_TAIL(ri->results, entry, items);
+    } else {
+        TAILQ_INSERT_TAIL(thread_results, entry, items);
+    }
+
+    return;
+}
+
+/*
+ * Direct add_result() calls made on the current thread to the given
+ * list.  Pass NULL to go back to adding results to ri->results.  The
+ * previous list is returned so callers can nest.
+ */
+results_t *set_thread_results(results_t *results) {
+    results_t *prev = thread_results;
+
+    thread_results = results;
+    return prev;
+}
+
+/*
+ * Move all of the entries in the given results_t to the end of the
+ * list add_result() would use on this thread.  If that is ri->results,
+ * the worst result seen is updated too, and with a results sink the
+ * entries go to the sink instead.  The results_t passed in is
+ * freed.
+ */
+void merge_results(struct rpminspect *ri, results_t *results) {
+    results_entry_t *entry = NULL;
+
+    assert(ri != NULL);
+
+    if (results == NULL) {
+        return;
+    }
+
+    if (thread_results != NULL) {
+        TAILQ_CONCAT(thread_results, results, items);
+        free(results);
+        return;
+    }
+
+    TAILQ_FOREACH(entry, results, items) {
+        if (entry->severity > ri->worst_result) {
+            ri->worst_result = entry->severity;
+        }
+
+        if (ri->results_sink != NULL) {
+            ri->results_sink->add(ri->results_sink, entry);
+        }
+    }
+
+    if (ri->results_sink != NULL) {
+        free_results(results);
+        return;
+    }
+
+    if (ri->results == NULL) {
+        ri->results = init_results();
+    }
+
+    TAILQ_CONCAT(ri->results, results, items);
+    free(results);
+    return;
+}
+
+/*
+ * Finish the output of the results sink, if there is one, and stop
+ * using it.
+ */
+void close_results_sink(struct rpminspect *ri) {
+    assert(ri != NULL);
+
+    if (ri->results_sink == NULL) {
+        return;
+    }
+
+    ri->results_sink->close(ri->results_sink);
+    ri->results_sink = NULL;
     return;
 }
@@ -52,6 +52,7 @@
 #define HEADER_ARCH          "architectures"
 #define HEADER_SUBPACKAGES   "subpackages"
 #define HEADER_CHANGELOG     "changelog"
+#define HEADER_MOVEDFILES    "moved-files"
 
 /*
  * Inspection remedies
@@ -154,4 +155,7 @@
 /* changelog */
 #define REMEDY_CHANGELOG _("Make sure the spec file in the after build contains a valid %%changelog section.")
 
+/* movedfiles */
+#define REMEDY_MOVEDFILES _("Files moved between subpackages.  Verify these changes are correct and that the subpackage dependencies still pull in the files where they are needed.")
+
 #endif
@@ -18,6 +18,8 @@
  */
 
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <rpm/rpmlib.h>
 #include <rpm/rpmts.h>
@@ -46,7 +48,6 @@ int init_librpm(void)
 /* Return an RPM header struct for the given package filename. */
 Header get_rpm_header(struct rpminspect *ri, const char *pkg)
 {
-    rpmts ts;
     FD_t fd;
     rpmRC result;
     char *bpkg = NULL;
@@ -59,12 +60,8 @@ Header get_rpm_header(struct rpminspect *ri, const char *pkg)
     bpkg = basename(pkg);
 
     /* First see if we can return the cached header */
-    if (ri->header_cache != NULL) {
-        TAILQ_FOREACH(hentry, ri->header_cache, items) {
-            if (!strcmp(hentry->pkg, bpkg)) {
-                return hentry->hdr;
-            }
-        }
+    if ((hentry = hashmap_get(ri->header_index, bpkg)) != NULL) {
+        return hentry->hdr;
     }
 
     /* No?  Then read the header in, cache it, and return it. */
@@ -82,19 +79,26 @@ Header get_rpm_header(struct rpminspect *ri, const char *pkg)
     }
 
     hentry = calloc(1, sizeof(*hentry));
-    hentry->pkg = strdup(bpkg);
+    assert(hentry != NULL);
 
-    ts = rpmtsCreate();
-    rpmtsSetVSFlags(ts, _RPMVSF_NODIGESTS | _RPMVSF_NOSIGNATURES);
-    result = rpmReadPackageFile(ts, fd, pkg, &hentry->hdr);
-    rpmtsFree(ts);
+    /* one transaction set is enough to read every package */
+    if (ri->ts == NULL) {
+        ri->ts = rpmtsCreate();
+        rpmtsSetVSFlags(ri->ts, _RPMVSF_NODIGESTS | _RPMVSF_NOSIGNATURES);
+    }
+
+    result = rpmReadPackageFile(ri->ts, fd, pkg, &hentry->hdr);
     Fclose(fd);
 
     if (result != RPMRC_OK) {
         fprintf(stderr, _("*** error reading package header for %s\n"), pkg);
+        free(hentry);
         return NULL;
     }
 
+    hentry->pkg = strdup(bpkg);
+    assert(hentry->pkg != NULL);
+
     if (ri->header_cache == NULL) {
         /* Initialize the header cache if necessary */
         ri->header_cache = calloc(1, sizeof(*ri->header_cache));
@@ -102,7 +106,13 @@ Header get_rpm_header(struct rpminspect *ri, const char *pkg)
         TAILQ_INIT(ri->header_cache);
     }
 
+    if (ri->header_index == NULL) {
+        ri->header_index = hashmap_new(HEADER_INDEX_SIZE);
+    }
+
     TAILQ_INSERT_TAIL(ri->header_cache, hentry, items);
+    hashmap_put(ri->header_index, hentry->pkg, hentry);
+
     return hentry->hdr;
 }
 
@@ -99,9 +99,34 @@ enum {
 enum { BEFORE_BUILD, AFTER_BUILD };
 
 /*
- * Supported checksum types.
+ * Supported checksum types.  FASTSUM is a 64-bit non-cryptographic
+ * hash (XXH64), only meant for telling files apart quickly.
  */
-enum checksum { NULLSUM, MD5SUM, SHA1SUM, SHA256SUM };
+enum checksum { NULLSUM, MD5SUM, SHA1SUM, SHA256SUM, FASTSUM, NUM_CHECKSUMS };
+
+/* Select checksum types for compute_checksums() and checksum_begin() */
+#define CHECKSUM_MASK(type) (1U << (type))
+
+/*
+ * MIME types that inspections dispatch on.  These are the intern IDs
+ * of the type strings, see intern.c.  Any other type has an ID of at
+ * least NUM_MIME_TYPES.
+ */
+enum mime_type {
+    MIME_NONE,
+    MIME_ZIP,
+    MIME_JAVA_APPLET,
+    MIME_OCTET_STREAM,
+    MIME_GZIP,
+    MIME_BZIP2,
+    MIME_XZ,
+    MIME_PIE_EXECUTABLE,
+    MIME_EXECUTABLE,
+    MIME_OBJECT,
+    MIME_GETTEXT_TRANSLATION,
+    MIME_C_SOURCE,
+    NUM_MIME_TYPES
+};
 
 /* Common functions */
 
@@ -112,11 +137,46 @@ int init_rpminspect(struct rpminspect *, const char *, const char *);
 
 /* free.c */
 void free_regex(regex_t *);
-void free_mapping(struct hsearch_data *, string_list_t *);
+void free_mapping(hashmap_t *, string_list_t *);
 void free_rpminspect(struct rpminspect *);
 
+/* arena.c */
+arena_t *arena_new(void);
+void *arena_alloc(arena_t *, size_t);
+char *arena_strdup(arena_t *, const char *);
+char *arena_printf(arena_t *, const char *, ...) __attribute__ ((format(printf, 2, 3)));
+size_t arena_size(const arena_t *);
+void arena_free(arena_t *);
+
+/* hashmap.c */
+hashmap_t *hashmap_new(size_t);
+void hashmap_free(hashmap_t *, void (*)(void *));
+bool hashmap_put(hashmap_t *, const char *, void *);
+bool hashmap_find(const hashmap_t *, const char *, void **);
+void *hashmap_get(const hashmap_t *, const char *);
+bool hashmap_remove(hashmap_t *, const char *);
+size_t hashmap_count(const hashmap_t *);
+bool hashmap_next(const hashmap_t *, size_t *, const char **, void **);
+
+/* intern.c */
+unsigned int intern_id(const char *);
+const char *intern_string(unsigned int);
+const char *intern(const char *);
+void intern_free(void);
+
+/* symset.c */
+symset_t *symset_new(const char **, size_t);
+symset_t *symset_from_list(const string_list_t *);
+void symset_free(symset_t *);
+size_t symset_count(const symset_t *);
+bool symset_contains(const symset_t *, const char *);
+symset_t *symset_intersection(const symset_t *, const symset_t *);
+symset_t *symset_difference(const symset_t *, const symset_t *);
+symset_t *symset_filter(const symset_t *, bool (*)(const char *));
+string_list_t *symset_names(const symset_t *);
+
 /* listfuncs.c */
-struct hsearch_data * list_to_table(const string_list_t *);
+hashmap_t * list_to_table(const string_list_t *);
 string_list_t * list_difference(const string_list_t *, const string_list_t *);
 string_list_t * list_intersection(const string_list_t *, const string_list_t *);
 string_list_t * list_union(const string_list_t *, const string_list_t *);
@@ -176,6 +236,7 @@ bool has_bad_word(const char *, const string_list_t *);
 
 /* copyfile.c */
 int copyfile(const char *, const char *, bool, bool);
+int linkfile(const char *, const char *);
 
 /* rpm.c */
 int init_librpm(void);
@@ -183,20 +244,49 @@ Header get_rpm_header(struct rpminspect *, const char *);
 char *get_nevra(Header);
 const char *get_rpm_header_arch(Header);
 
+/* download.c */
+void add_download(download_list_t **, const char *, const char *, const char *);
+void free_downloads(download_list_t *);
+bool run_downloads(const struct rpminspect *, download_list_t *, download_done_func, void *);
+
+/* anacache.c */
+rpmfile_t *load_analysis(const struct rpminspect *, Header, const char *);
+void store_analysis(const struct rpminspect *, Header, const rpmfile_t *);
+void save_analysis_cache(const struct rpminspect *);
+
+/* dlcache.c */
+bool fetch_cached(const struct rpminspect *, const char *, const char *);
+void store_cached(const struct rpminspect *, const char *, const char *);
+void prune_download_cache(const struct rpminspect *);
+
 /* peers.c */
 rpmpeer_t *init_rpmpeer(void);
 void free_rpmpeer(rpmpeer_t *);
-int add_peer(rpmpeer_t **, int, bool, const char *, Header);
+size_t rpmpeer_arena_size(const rpmpeer_t *);
+int add_peer(struct rpminspect *, int, bool, const char *, Header);
+void finish_peers(struct rpminspect *);
+
+/* filetable.c */
+void build_file_tables(struct rpminspect *);
+void free_file_table(file_table_t *);
+unsigned int select_files(const file_table_t *, mode_t, bool, uint32_t *);
 
 /* files.c */
+rpmfile_t *new_files(void);
+rpmfile_entry_t *new_file_entry(rpmfile_t *);
 void free_files(rpmfile_t *files);
-rpmfile_t * extract_rpm(const char *, Header);
+rpmfile_t * extract_rpm(struct rpminspect *, const char *, Header);
 const char * get_file_path(const rpmfile_entry_t *file);
 bool process_file_path(const rpmfile_entry_t *, regex_t *, regex_t *);
-void find_file_peers(rpmfile_t *, rpmfile_t *);
+void lock_file_entry(const rpmfile_entry_t *);
+void unlock_file_entry(const rpmfile_entry_t *);
 cap_t get_cap(rpmfile_entry_t *);
 bool is_debug_or_build_path(const char *);
 
+/* pairing.c */
+void find_file_peers(rpmfile_t *, rpmfile_t *);
+void find_moved_files(struct rpminspect *);
+
 /* tty.c */
 size_t tty_width(void);
 
@@ -204,28 +294,52 @@ size_t tty_width(void);
 results_t *init_results(void);
 void free_results(results_t *);
 void add_result(struct rpminspect *, severity_t, waiverauth_t, const char *, char *, char *, const char *);
+results_t *set_thread_results(results_t *);
+void merge_results(struct rpminspect *, results_t *);
+void close_results_sink(struct rpminspect *);
 
 /* output.c */
 const char *format_desc(unsigned int);
 
 /* output_text.c */
+results_sink_t *text_sink(const char *);
 void output_text(const results_t *, const char *);
 
 /* output_json.c */
 void output_json(const results_t *, const char *);
 
+/* output_jsonl.c */
+results_sink_t *jsonl_sink(const char *);
+void output_jsonl(const results_t *, const char *);
+
 /* unpack.c */
 int unpack_archive(const char *, const char *, const bool);
 
 /* magic.c */
-char *get_mime_type(rpmfile_entry_t *);
-bool is_text_file(rpmfile_entry_t *);
+bool init_magic_cookies(struct rpminspect *);
+void free_magic_cookies(struct rpminspect *);
+unsigned int get_mime_type_id(struct rpminspect *, rpmfile_entry_t *);
+const char *get_mime_type(struct rpminspect *, rpmfile_entry_t *);
+unsigned int get_buffer_mime_type_id(struct rpminspect *, const void *, size_t);
+bool is_text_file(struct rpminspect *, rpmfile_entry_t *);
 
 /* checksums.c */
+checksum_ctx_t *checksum_begin(unsigned int);
+void checksum_update(checksum_ctx_t *, const void *, size_t);
+void checksum_end(checksum_ctx_t *, char **);
+bool compute_checksums(const char *, mode_t *, unsigned int, char **);
 char *compute_checksum(const char *, mode_t *, enum checksum);
-char *checksum(rpmfile_entry_t *);
+const char *get_header_digest(const rpmfile_entry_t *);
+void check_header_digest(const rpmfile_entry_t *, const char *);
+char *known_checksum(const struct rpminspect *, rpmfile_entry_t *);
+char *checksum(const struct rpminspect *, rpmfile_entry_t *);
 
 /* runcmd.c */
+void set_cmd_timeout(unsigned int);
+char **build_argv(const char *, ...);
+void free_argv(char **);
+void run_cmds(runcmd_t *, size_t);
+char *run_cmd_vp(int *, char **);
 char *run_cmd(int *, const char *, ...);
 
 /* whitelist.c */
@@ -24,119 +24,428 @@
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "rpminspect.h"
 
+extern char **environ;
+
+/* Seconds a command may run before it is killed, 0 means no limit */
+static unsigned int cmd_timeout = CMD_TIMEOUT;
+
+/* Milliseconds between checks on a child that closed its output */
+#define REAP_INTERVAL 50
+
+/* A child process started by run_cmds() */
+struct child {
+    pid_t pid;
+    int fd;                 /* read end of the output pipe, -1 at EOF */
+    char *buf;
+    size_t len;
+    size_t size;
+    time_t deadline;
+    bool timed_out;
+};
+
 /*
- * Generic popen() wrapper to return the output of the process and the
- * exit code (if desired).  This function returns an allocated string of
- * the output from the program that ran or NULL if there was no output.
- *
- * The first argument is a pointer to an int that will hold the exit code
- * from popen().  If this pointer is NULL, then the caller does not want
- * the exit code and the function does nothing.
- *
- * The second argument is the command followed by any additional arguments
- * that should be included with it.  Note that it is not a format string,
- * all of the subsequent arguments need to be strings because they all
- * get concatenated together.
+ * Set the number of seconds a command run by run_cmd() or run_cmds()
+ * is allowed to take.  0 disables the timeout.
  */
-char *run_cmd(int *exitcode, const char *cmd, ...)
+void set_cmd_timeout(unsigned int seconds)
 {
-    va_list ap;
-    int status;
-    char *output = NULL;
-    char *tail = NULL;
-    size_t n = BUFSIZ;
-    char *buf = NULL;
-    FILE *cmdfp = NULL;
-    char *built = NULL;
+    cmd_timeout = seconds;
+    return;
+}
+
+/* Append a copy of arg to the NULL terminated argv, growing it as needed */
+static char **add_arg(char **argv, size_t *argc, const char *arg)
+{
+    /* the vector is sized in powers of two, leave room for the NULL */
+    if (*argc == 0 || ((*argc + 1) & *argc) == 0) {
+        argv = realloc(argv, (*argc + 1) * 2 * sizeof(*argv));
+        assert(argv != NULL);
+    }
+
+    argv[*argc] = strdup(arg);
+    assert(argv[*argc] != NULL);
+    (*argc)++;
+    argv[*argc] = NULL;
+    return argv;
+}
+
+/*
+ * Build a NULL terminated argument vector.  The first argument is the
+ * command, which is split on whitespace so it may carry options (e.g.,
+ * ANNOCHECK_CMD followed by the configured annocheck options).  The
+ * remaining arguments are each used as a single argument as-is, they
+ * are not split or interpreted by a shell.
+ */
+static char **vbuild_argv(const char *cmd, va_list ap)
+{
+    char **argv = NULL;
+    size_t argc = 0;
+    char *copy = NULL;
+    char *token = NULL;
+    char *saveptr = NULL;
     char *element = NULL;
 
     assert(cmd != NULL);
 
-    /* Allocate a large buffer to use for building the command */
-    built = strdup(cmd);
-    assert(built != NULL);
+    copy = strdup(cmd);
+    assert(copy != NULL);
 
-    /* Add the remaining elements */
-    va_start(ap, cmd);
+    for (token = strtok_r(copy, " \t", &saveptr); token != NULL; token = strtok_r(NULL, " \t", &saveptr)) {
+        argv = add_arg(argv, &argc, token);
+    }
+
+    free(copy);
 
     while ((element = va_arg(ap, char *)) != NULL) {
-        xasprintf(&output, "%s %s", built, element);
-        assert(output != NULL);
-        free(built);
-        built = output;
+        argv = add_arg(argv, &argc, element);
     }
 
+    assert(argv != NULL);
+    return argv;
+}
+
+/*
+ * Build an argument vector for run_cmd_vp() or a runcmd_t.  The
+ * variadic arguments must be terminated with NULL.  Free the result
+ * with free_argv().
+ */
+char **build_argv(const char *cmd, ...)
+{
+    va_list ap;
+    char **argv = NULL;
+
+    va_start(ap, cmd);
+    argv = vbuild_argv(cmd, ap);
     va_end(ap);
 
-    /* always combine stdout and stderr */
-    xasprintf(&output, "%s 2>&1", built);
-    assert(output != NULL);
-    free(built);
-    built = output;
+    return argv;
+}
 
-    /* shrink memory allocation */
-    built = realloc(built, strlen(built) + 1);
+void free_argv(char **argv)
+{
+    char **arg = NULL;
 
-    /* run the command */
-    cmdfp = popen(built, "r");
+    if (argv == NULL) {
+        return;
+    }
 
-    if (cmdfp == NULL) {
-        fprintf(stderr, _("error running `%s`: %s\n"), built, strerror(errno));
+    for (arg = argv; *arg != NULL; arg++) {
+        free(*arg);
+    }
+
+    free(argv);
+    return;
+}
+
+/*
+ * Start one command.  Standard input is /dev/null and standard error
+ * goes to the same pipe as standard output so the output comes back
+ * in the order the program wrote it.  If cmd->outfile is set, standard
+ * output is written to that file instead and only standard error is
+ * captured.
+ */
+static bool spawn_cmd(runcmd_t *cmd, struct child *child)
+{
+    int fds[2];
+    int r;
+    posix_spawn_file_actions_t actions;
+
+    assert(cmd != NULL);
+    assert(cmd->argv != NULL && cmd->argv[0] != NULL);
+    assert(child != NULL);
+
+    if (pipe2(fds, O_CLOEXEC) == -1) {
+        fprintf(stderr, _("*** unable to create pipe for `%s`: %s\n"), cmd->argv[0], strerror(errno));
         fflush(stderr);
-        free(built);
         return false;
     }
 
-    /*
-     * Read in all of the information back from the command and store
-     * it as our result.  Just concatenate the string as we read it
-     * back in buffer size chunks.
-     */
-    output = NULL;
-    buf = calloc(1, n);
-    assert(buf != NULL);
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
 
-    while (getline(&buf, &n, cmdfp) != -1) {
-        if (output == NULL) {
-            output = strdup(buf);
-        } else {
-            xasprintf(&tail, "%s%s", output, buf);
-            assert(tail != NULL);
-            free(output);
-            output = tail;
+    if (cmd->outfile) {
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, cmd->outfile, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    } else {
+        posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    }
+
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+
+    r = posix_spawnp(&child->pid, cmd->argv[0], &actions, NULL, cmd->argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+
+    if (r != 0) {
+        fprintf(stderr, _("*** unable to run `%s`: %s\n"), cmd->argv[0], strerror(r));
+        fflush(stderr);
+        close(fds[0]);
+        return false;
+    }
+
+    child->fd = fds[0];
+
+    if (cmd_timeout > 0) {
+        child->deadline = time(NULL) + cmd_timeout;
+    }
+
+    return true;
+}
+
+/*
+ * Read what is available from the child.  Closes the descriptor at
+ * end of file.
+ */
+static void read_child(struct child *child)
+{
+    ssize_t n;
+
+    /* keep room for the terminating NUL */
+    if (child->size - child->len < BUFSIZ) {
+        child->size = (child->size == 0) ? BUFSIZ * 2 : child->size * 2;
+        child->buf = realloc(child->buf, child->size);
+        assert(child->buf != NULL);
+    }
+
+    n = read(child->fd, child->buf + child->len, child->size - child->len - 1);
+
+    if (n > 0) {
+        child->len += n;
+    } else if (n == 0 || errno != EINTR) {
+        close(child->fd);
+        child->fd = -1;
+    }
+
+    return;
+}
+
+/*
+ * Wait for the child to exit.  A child can close its output and keep
+ * running, so until it exits the deadline is still checked and the
+ * child is killed once it passes.  Returns what waitpid() returned.
+ */
+static pid_t reap_child(struct child *child, int *status)
+{
+    pid_t r;
+
+    while (true) {
+        r = waitpid(child->pid, status, child->deadline ? WNOHANG : 0);
+
+        if (r == -1 && errno == EINTR) {
+            continue;
+        } else if (r != 0) {
+            return r;
+        }
+
+        if (time(NULL) >= child->deadline) {
+            kill(child->pid, SIGKILL);
+            child->timed_out = true;
+            child->deadline = 0;
+            continue;
         }
+
+        poll(NULL, 0, REAP_INTERVAL);
     }
+}
 
-    free(buf);
+/*
+ * Run all of the given commands at the same time and wait for all of
+ * them to finish.  For each command, output is set to an allocated
+ * string holding what the program wrote (without a trailing newline)
+ * or NULL if there was no output.  exitcode is set to the exit status
+ * of the program, 128 plus the signal number if it was killed, or -1
+ * if it could not be run at all.  Commands still running after the
+ * timeout are killed.
+ */
+void run_cmds(runcmd_t *cmds, size_t ncmds)
+{
+    size_t i;
+    size_t nfds;
+    int status = 0;
+    int wait_ms;
+    time_t now;
+    struct child *children = NULL;
+    struct pollfd *pfds = NULL;
+    size_t *map = NULL;
 
-    /* Capture the return code from the validation tool */
-    status = pclose(cmdfp);
+    assert(cmds != NULL);
 
-    if (exitcode != NULL) {
-        *exitcode = status;
+    if (ncmds == 0) {
+        return;
     }
 
-    if (status == -1) {
-        fprintf(stderr, _("error closing `%s`: %s\n"), built, strerror(errno));
-        fflush(stderr);
-        free(built);
-        free(output);
-        return NULL;
+    children = calloc(ncmds, sizeof(*children));
+    pfds = calloc(ncmds, sizeof(*pfds));
+    map = calloc(ncmds, sizeof(*map));
+    assert(children != NULL && pfds != NULL && map != NULL);
+
+    /* Start everything */
+    for (i = 0; i < ncmds; i++) {
+        cmds[i].output = NULL;
+        cmds[i].exitcode = -1;
+        children[i].fd = -1;
+        children[i].pid = -1;
+        spawn_cmd(&cmds[i], &children[i]);
+    }
+
+    /* Collect output until every pipe is closed */
+    while (true) {
+        nfds = 0;
+        wait_ms = -1;
+        now = time(NULL);
+
+        for (i = 0; i < ncmds; i++) {
+            if (children[i].fd == -1) {
+                continue;
+            }
+
+            if (children[i].deadline) {
+                if (now >= children[i].deadline) {
+                    kill(children[i].pid, SIGKILL);
+                    close(children[i].fd);
+                    children[i].fd = -1;
+                    children[i].timed_out = true;
+                    continue;
+                }
+
+                if (wait_ms == -1 || (children[i].deadline - now) * 1000 < wait_ms) {
+                    wait_ms = (children[i].deadline - now) * 1000;
+                }
+            }
+
+            pfds[nfds].fd = children[i].fd;
+            pfds[nfds].events = POLLIN;
+            pfds[nfds].revents = 0;
+            map[nfds] = i;
+            nfds++;
+        }
+
+        if (nfds == 0) {
+            break;
+        }
+
+        if (poll(pfds, nfds, wait_ms) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            fprintf(stderr, _("*** error waiting for command output: %s\n"), strerror(errno));
+            fflush(stderr);
+
+            for (i = 0; i < nfds; i++) {
+                kill(children[map[i]].pid, SIGKILL);
+                close(pfds[i].fd);
+                children[map[i]].fd = -1;
+            }
+
+            break;
+        }
+
+        for (i = 0; i < nfds; i++) {
+            if (pfds[i].revents) {
+                read_child(&children[map[i]]);
+            }
+        }
     }
 
-    /* There may be no results from the tool */
-    if (output != NULL) {
-        /* Trim trailing newline */
-        tail = rindex(output, '\n');
+    /* Reap the children and hand back the results */
+    for (i = 0; i < ncmds; i++) {
+        if (children[i].pid == -1) {
+            continue;
+        }
+
+        if (reap_child(&children[i], &status) == -1) {
+            fprintf(stderr, _("*** error waiting for `%s`: %s\n"), cmds[i].argv[0], strerror(errno));
+            fflush(stderr);
+        } else if (WIFEXITED(status)) {
+            cmds[i].exitcode = WEXITSTATUS(status);
+        } else if (WIFSIGNALED(status)) {
+            cmds[i].exitcode = 128 + WTERMSIG(status);
+        }
+
+        if (children[i].timed_out) {
+            fprintf(stderr, _("*** `%s` killed after %u seconds\n"), cmds[i].argv[0], cmd_timeout);
+            fflush(stderr);
+        }
 
-        if (tail != NULL) {
-            tail[strcspn(tail, "\n")] = 0;
+        if (children[i].len > 0) {
+            /* Trim trailing newline */
+            if (children[i].buf[children[i].len - 1] == '\n') {
+                children[i].len--;
+            }
+
+            children[i].buf[children[i].len] = '\0';
+            cmds[i].output = realloc(children[i].buf, children[i].len + 1);
+        } else {
+            free(children[i].buf);
         }
     }
 
-    free(built);
+    free(children);
+    free(pfds);
+    free(map);
+    return;
+}
+
+/*
+ * Run the command in argv and return its output and exit code as
+ * described for run_cmds().  The exitcode pointer may be NULL if the
+ * caller does not care about it.
+ */
+char *run_cmd_vp(int *exitcode, char **argv)
+{
+    runcmd_t cmd;
+
+    assert(argv != NULL);
+
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.argv = argv;
+    run_cmds(&cmd, 1);
+
+    if (exitcode != NULL) {
+        *exitcode = cmd.exitcode;
+    }
+
+    return cmd.output;
+}
+
+/*
+ * Convenience wrapper around run_cmd_vp().  This function returns an
+ * allocated string of the output from the program that ran or NULL if
+ * there was no output.
+ *
+ * The first argument is a pointer to an int that will hold the exit code
+ * of the program.  If this pointer is NULL, then the caller does not
+ * want the exit code.
+ *
+ * The second argument is the command followed by any additional arguments
+ * that should be included with it, terminated by NULL.  See build_argv()
+ * for how they are turned in to the argument vector.  No shell is
+ * involved, so redirections and quoting have no special meaning.
+ */
+char *run_cmd(int *exitcode, const char *cmd, ...)
+{
+    va_list ap;
+    char **argv = NULL;
+    char *output = NULL;
+
+    assert(cmd != NULL);
+
+    va_start(ap, cmd);
+    argv = vbuild_argv(cmd, ap);
+    va_end(ap);
+
+    output = run_cmd_vp(exitcode, argv);
+    free_argv(argv);
     return output;
 }
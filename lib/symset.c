@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Sets of symbol names.
+ *
+ * A set is a sorted array of names, so intersection and difference
+ * are a single merge over both arrays.  Each set also has a bloom
+ * filter over its names, sized from the number of names.
+ * symset_contains() checks it before searching the array, which turns
+ * away most lookups of symbols that are not in the set.
+ *
+ * A set made with symset_new() uses the names it is given, so the set
+ * of an ELF symbol table points in to the string table and reading it
+ * copies nothing and takes no locks.  symset_from_list() copies the
+ * names.  A set made from other sets uses their names and has to be
+ * freed before them.
+ *
+ * Sets do not change once made, so any number of threads may use one.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "rpminspect.h"
+
+/* Filter bits per name, about a 5% false positive rate with two bits set per name */
+#define BLOOM_BITS_PER_NAME 8
+
+struct _symset_t {
+    size_t count;
+    const char **names;         /* sorted, no duplicates */
+    arena_t *arena;             /* copies of the names, or NULL */
+    uint64_t *bloom;
+    size_t bloom_bits;          /* a power of two */
+};
+
+/* FNV-1a */
+static uint64_t hash_name(const char *name)
+{
+    uint64_t h = UINT64_C(0xcbf29ce484222325);
+
+    while (*name != '\0') {
+        h ^= (unsigned char) *name++;
+        h *= UINT64_C(0x100000001b3);
+    }
+
+    return h;
+}
+
+/* Set the two filter bits for a name */
+static void bloom_add(symset_t *set, const char *name)
+{
+    uint64_t h = hash_name(name);
+    size_t a = h & (set->bloom_bits - 1);
+    size_t b = (h >> 32) & (set->bloom_bits - 1);
+
+    set->bloom[a / 64] |= UINT64_C(1) << (a % 64);
+    set->bloom[b / 64] |= UINT64_C(1) << (b % 64);
+    return;
+}
+
+static bool bloom_test(const symset_t *set, const char *name)
+{
+    uint64_t h = hash_name(name);
+    size_t a = h & (set->bloom_bits - 1);
+    size_t b = (h >> 32) & (set->bloom_bits - 1);
+
+    return (set->bloom[a / 64] & (UINT64_C(1) << (a % 64))) &&
+           (set->bloom[b / 64] & (UINT64_C(1) << (b % 64)));
+}
+
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(const char * const *) a, *(const char * const *) b);
+}
+
+/* Make a set that takes over an array of names already sorted and unique */
+static symset_t *new_symset(const char **names, size_t count, arena_t *arena)
+{
+    symset_t *set = NULL;
+    size_t i;
+
+    set = calloc(1, sizeof(*set));
+    assert(set != NULL);
+    set->names = names;
+    set->count = count;
+    set->arena = arena;
+
+    if (count == 0) {
+        return set;
+    }
+
+    set->bloom_bits = 64;
+
+    while (set->bloom_bits < count * BLOOM_BITS_PER_NAME) {
+        set->bloom_bits *= 2;
+    }
+
+    set->bloom = calloc(set->bloom_bits / 64, sizeof(*set->bloom));
+    assert(set->bloom != NULL);
+
+    for (i = 0; i < count; i++) {
+        bloom_add(set, names[i]);
+    }
+
+    return set;
+}
+
+/* Sort names and drop empty names and duplicates, returns the new count */
+static size_t sort_names(const char **names, size_t count)
+{
+    size_t n = 0;
+    size_t i;
+
+    qsort(names, count, sizeof(*names), compare_names);
+
+    for (i = 0; i < count; i++) {
+        if (names[i] != NULL && *names[i] != '\0' && (n == 0 || strcmp(names[n - 1], names[i]))) {
+            names[n++] = names[i];
+        }
+    }
+
+    return n;
+}
+
+/*
+ * Make a set of the names in an array in any order.  Empty names and
+ * duplicates are dropped.  The array is not kept but the names are,
+ * they have to outlive the set.
+ */
+symset_t *symset_new(const char **names, size_t count)
+{
+    const char **sorted = NULL;
+
+    if (count == 0) {
+        return new_symset(NULL, 0, NULL);
+    }
+
+    sorted = malloc(count * sizeof(*sorted));
+    assert(sorted != NULL);
+    memcpy(sorted, names, count * sizeof(*sorted));
+    return new_symset(sorted, sort_names(sorted, count), NULL);
+}
+
+/* Make a set from a list of names, the set has its own copies */
+symset_t *symset_from_list(const string_list_t *list)
+{
+    const string_entry_t *entry = NULL;
+    const char **names = NULL;
+    arena_t *arena = NULL;
+    size_t n = 0;
+
+    if (list == NULL || TAILQ_EMPTY(list)) {
+        return new_symset(NULL, 0, NULL);
+    }
+
+    arena = arena_new();
+    names = malloc(list_len(list) * sizeof(*names));
+    assert(names != NULL);
+
+    TAILQ_FOREACH(entry, list, items) {
+        names[n++] = arena_strdup(arena, entry->data);
+    }
+
+    return new_symset(names, sort_names(names, n), arena);
+}
+
+void symset_free(symset_t *set)
+{
+    if (set == NULL) {
+        return;
+    }
+
+    free(set->names);
+    free(set->bloom);
+    arena_free(set->arena);
+    free(set);
+    return;
+}
+
+size_t symset_count(const symset_t *set)
+{
+    return (set == NULL) ? 0 : set->count;
+}
+
+/* Return true if the set has the given name */
+bool symset_contains(const symset_t *set, const char *name)
+{
+    if (set == NULL || set->count == 0 || name == NULL || !bloom_test(set, name)) {
+        return false;
+    }
+
+    return bsearch(&name, set->names, set->count, sizeof(name), compare_names) != NULL;
+}
+
+/* Return a new set of what is in both sets */
+symset_t *symset_intersection(const symset_t *a, const symset_t *b)
+{
+    const char **names = NULL;
+    size_t i = 0;
+    size_t j = 0;
+    size_t n = 0;
+    int cmp;
+
+    if (a == NULL || b == NULL || a->count == 0 || b->count == 0) {
+        return new_symset(NULL, 0, NULL);
+    }
+
+    names = malloc(((a->count < b->count) ? a->count : b->count) * sizeof(*names));
+    assert(names != NULL);
+
+    while (i < a->count && j < b->count) {
+        cmp = strcmp(a->names[i], b->names[j]);
+
+        if (cmp < 0) {
+            i++;
+        } else if (cmp > 0) {
+            j++;
+        } else {
+            names[n++] = a->names[i];
+            i++;
+            j++;
+        }
+    }
+
+    return new_symset(names, n, NULL);
+}
+
+/* Return a new set of what is in a but not in b */
+symset_t *symset_difference(const symset_t *a, const symset_t *b)
+{
+    const char **names = NULL;
+    size_t i = 0;
+    size_t j = 0;
+    size_t n = 0;
+    int cmp;
+
+    if (a == NULL || a->count == 0) {
+        return new_symset(NULL, 0, NULL);
+    }
+
+    names = malloc(a->count * sizeof(*names));
+    assert(names != NULL);
+
+    while (i < a->count) {
+        cmp = (b == NULL || j == b->count) ? -1 : strcmp(a->names[i], b->names[j]);
+
+        if (cmp < 0) {
+            names[n++] = a->names[i];
+            i++;
+        } else if (cmp > 0) {
+            j++;
+        } else {
+            i++;
+            j++;
+        }
+    }
+
+    return new_symset(names, n, NULL);
+}
+
+/* Return a new set of the names in the set that pass the filter */
+symset_t *symset_filter(const symset_t *set, bool (*filter)(const char *))
+{
+    const char **names = NULL;
+    size_t n = 0;
+    size_t i;
+
+    if (set == NULL || set->count == 0) {
+        return new_symset(NULL, 0, NULL);
+    }
+
+    names = malloc(set->count * sizeof(*names));
+    assert(names != NULL);
+
+    for (i = 0; i < set->count; i++) {
+        if (filter(set->names[i])) {
+            names[n++] = set->names[i];
+        }
+    }
+
+    return new_symset(names, n, NULL);
+}
+
+/*
+ * Return the names in the set as a list in alphabetical order.  The
+ * names belong to the set, free the list with list_free(list, NULL).
+ */
+string_list_t *symset_names(const symset_t *set)
+{
+    string_list_t *list = NULL;
+    string_entry_t *entry = NULL;
+    size_t i;
+
+    list = calloc(1, sizeof(*list));
+    assert(list != NULL);
+    TAILQ_INIT(list);
+
+    for (i = 0; i < symset_count(set); i++) {
+        entry = calloc(1, sizeof(*entry));
+        assert(entry != NULL);
+        entry->data = (char *) set->names[i];
+        TAILQ_INSERT_TAIL(list, entry, items);
+    }
+
+    return list;
+}
@@ -20,10 +20,11 @@
  * This header defines types used by librpminspect
  */
 
+#include <pthread.h>
 #include <regex.h>
+#include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
-#include <search.h>
 #include <sys/queue.h>
 #include <sys/stat.h>
 #include <sys/capability.h>
@@ -43,6 +44,18 @@ typedef struct _string_entry_t {
 
 typedef TAILQ_HEAD(string_entry_s, _string_entry_t) string_list_t;
 
+/*
+ * Arena allocator and string keyed hash map, see arena.c and
+ * hashmap.c.  Both are opaque.
+ */
+typedef struct _arena_t arena_t;
+typedef struct _hashmap_t hashmap_t;
+typedef struct _elf_info_t elf_info_t;
+typedef struct _symset_t symset_t;
+
+/* In progress checksum computation, see checksums.c */
+typedef struct _checksum_ctx_t checksum_ctx_t;
+
 /*
  * A file is information about a file in an RPM payload.
  *
@@ -60,7 +73,8 @@ typedef TAILQ_HEAD(string_entry_s, _string_entry_t) string_list_t;
  *
  * idx is the index for this file into the RPM array tags such as RPMTAG_FILESIZES.
  *
- * type is the MIME type string that you would get from 'file --mime-type'.
+ * type_id is the intern ID of the MIME type string that you would get
+ * from 'file --mime-type', or 0 if it has not been looked up yet.
  */
 typedef struct _rpmfile_entry_t {
     Header rpm_header;
@@ -68,14 +82,40 @@ typedef struct _rpmfile_entry_t {
     char *localpath;
     struct stat st;
     int idx;
-    char *type;
+    unsigned int type_id;
     char *checksum;
     cap_t cap;
+    elf_info_t *elf_info;      /* see get_elf_info() */
     struct _rpmfile_entry_t *peer_file;
     TAILQ_ENTRY(_rpmfile_entry_t) items;
 } rpmfile_entry_t;
 
-typedef TAILQ_HEAD(rpmfile_s, _rpmfile_entry_t) rpmfile_t;
+/*
+ * Columns of a file list, one row per file in list order, see
+ * filetable.c.  Scanning a column touches far less memory than
+ * walking the list.  peered is 1 if the file has a peer_file, else 0.
+ */
+typedef struct _file_table_t {
+    unsigned int count;
+    rpmfile_entry_t **entries;
+    uint32_t *mode;
+    uint8_t *peered;
+    arena_t *arena;            /* holds everything above */
+} file_table_t;
+
+/*
+ * A list of files.  This is a TAILQ_HEAD with extra members: the
+ * arena holding the entries and their localpath and fullpath strings
+ * when the list was made by new_files(), so free_files() can release
+ * them all at once, and the list's file table once the files of all
+ * peers are paired.  Lists built by hand must leave both NULL.
+ */
+typedef struct rpmfile_s {
+    struct _rpmfile_entry_t *tqh_first;
+    struct _rpmfile_entry_t **tqh_last;
+    arena_t *arena;
+    file_table_t *table;
+} rpmfile_t;
 
 /*
  * A peer is a mapping of a built RPM from the before and after builds.
@@ -123,6 +163,18 @@ typedef struct _results_entry_t {
 
 typedef TAILQ_HEAD(results_s, _results_entry_t) results_t;
 
+/*
+ * Receives results one at a time as they are reported, in the order
+ * they will be output, instead of collecting them in ri->results.
+ * The entry passed to add() and its strings only live for the call.
+ * close() finishes the output and frees the sink.  See results.c.
+ */
+typedef struct _results_sink_t {
+    void (*add)(struct _results_sink_t *, const results_entry_t *);
+    void (*close)(struct _results_sink_t *);
+    void *data;
+} results_sink_t;
+
 /*
  * Known types of Koji builds
  */
@@ -222,6 +274,9 @@ struct rpminspect {
     char *workdir;             /* full path to working directory */
     char *profiledir;          /* full path to profiles directory */
     char *worksubdir;          /* within workdir, where these builds go */
+    char *analysis_cache;      /* extracted payloads kept between runs */
+    unsigned long long analysis_cache_size; /* cache limit in bytes */
+    unsigned int command_timeout;  /* seconds before external commands are killed */
 
     /* Vendor data */
     char *vendor_data_dir;     /* main vendor data directory */
@@ -236,6 +291,10 @@ struct rpminspect {
     char *kojihub;             /* URL of Koji hub */
     char *kojiursine;          /* URL to access packages built in Koji */
     char *kojimbs;             /* URL to access module packages in Koji */
+    unsigned int download_jobs;    /* concurrent package downloads */
+    unsigned int download_retries; /* extra attempts for a failed download */
+    char *download_cache;      /* directory of previously downloaded packages */
+    unsigned long long download_cache_size; /* cache limit in bytes */
 
     /* Information used by different tests */
     string_list_t *badwords;   /* Space-delimited list of words prohibited
@@ -301,15 +360,15 @@ struct rpminspect {
     specname_primary_t specprimary;
 
     /* hash table of product release -> JVM major versions */
-    struct hsearch_data *jvm_table;
+    hashmap_t *jvm_table;
     string_list_t *jvm_keys;
 
     /* hash table of annocheck tests */
-    struct hsearch_data *annocheck_table;
+    hashmap_t *annocheck_table;
     string_list_t *annocheck_keys;
 
     /* hash table of product release regexps */
-    struct hsearch_data *products;
+    hashmap_t *products;
     string_list_t *product_keys;
 
     /* Options specified by the user */
@@ -317,6 +376,10 @@ struct rpminspect {
     char *after;               /* after build ID arg given on cmdline */
     uint64_t tests;            /* which tests to run (default: ALL) */
     bool verbose;              /* verbose inspection output? */
+    unsigned int jobs;         /* threads for per-file inspection work */
+    unsigned int extract_jobs; /* payloads to extract at once, 0 = jobs */
+    bool stream_payloads;      /* stream payloads instead of unpacking them */
+    bool verify_digests;       /* check header file digests against the payload */
 
     /* Failure threshold */
     severity_t threshold;
@@ -336,10 +399,20 @@ struct rpminspect {
 
     /* accumulated data of the build set */
     rpmpeer_t *peers;               /* list of packages */
+    struct extract_pool *extractor; /* running payload extraction, see peers.c */
     header_cache_t *header_cache;   /* RPM header cache */
+    hashmap_t *header_index;   /* header_cache by package name */
+    rpmts ts;                  /* used to read every package header */
 
-    /* inspection results */
+    /* inspection results, or where they go as they are reported */
     results_t *results;
+    results_sink_t *results_sink;
+
+    /* threads started beyond the calling one, see take_jobs() */
+    unsigned int busy_jobs;
+
+    /* libmagic cookies lent to threads, see magic.c */
+    struct magic_pool *magic_cookies;
 };
 
 /*
@@ -354,11 +427,15 @@ struct format {
 
     /* output driver function */
     void (*driver)(const results_t *, const char *);
+
+    /* streaming output, or NULL if the format needs all of the results */
+    results_sink_t *(*sink)(const char *);
 };
 
 /*
  * Definition for an inspection.  Inspections are assigned a flag (see
- * inspect.h), a short name, and a function pointer to the driver.  The
+ * inspect.h), a short name, what they depend on, and a function
+ * pointer to the driver.  The
  * driver function needs to take a struct rpminspect pointer as the only
  * argument.  The driver returns true on success and false on failure.
  */
@@ -380,6 +457,21 @@ struct inspect {
      */
     bool single_build;
 
+    /*
+     * NEEDS_PAYLOAD (see inspect.h) if the inspection reads the
+     * payload, otherwise 0.  run_inspections() starts the payload
+     * inspections first.
+     */
+    unsigned int needs;
+
+    /*
+     * True if this inspection can run at the same time as other
+     * inspections.  It must not change anything in struct rpminspect
+     * that other inspections read, and it must not change process
+     * wide state such as the current working directory.
+     */
+    bool thread_safe;
+
     /* the driver function for the inspection */
     bool (*driver)(struct rpminspect *);
 };
@@ -394,6 +486,7 @@ typedef struct _koji_rpmlist_entry_t {
     char *release;
     int epoch;
     long long int size;
+    char *payloadhash;
     TAILQ_ENTRY(_koji_rpmlist_entry_t) items;
 } koji_rpmlist_entry_t;
 
@@ -550,7 +643,42 @@ TAILQ_HEAD(alias_list_t, alias_entry_t);
 typedef struct _kernel_alias_data {
     size_t num_aliases;
     struct alias_list_t *alias_list;
-    struct hsearch_data *alias_table;
+    hashmap_t *alias_table;
 } kernel_alias_data_t;
 
+/*
+ * A file to fetch with run_downloads().  If key is not NULL the file
+ * can be taken from and stored in the download cache under that key.
+ * fp, handle and tries are used while the transfer is running.
+ * retry_at is when a failed transfer may start again, in milliseconds
+ * on the monotonic clock, or 0 if it is not waiting to be retried.
+ */
+typedef struct _download_entry_t {
+    char *src;
+    char *dst;
+    char *key;
+    FILE *fp;
+    void *handle;
+    unsigned int tries;
+    uint64_t retry_at;
+    TAILQ_ENTRY(_download_entry_t) items;
+} download_entry_t;
+
+typedef TAILQ_HEAD(download_entry_s, _download_entry_t) download_list_t;
+
+/* Called by run_downloads() with the destination of each finished file */
+typedef int (*download_done_func)(const char *, void *);
+
+/*
+ * A command for run_cmds().  argv is NULL terminated and argv[0] is
+ * looked up in the PATH.  If outfile is not NULL, standard output is
+ * written to that file.  run_cmds() fills in output and exitcode.
+ */
+typedef struct _runcmd_t {
+    char **argv;
+    const char *outfile;
+    char *output;
+    int exitcode;
+} runcmd_t;
+
 #endif
@@ -43,11 +43,14 @@ static char *build_desc[] = { "before", "after" };
 /* Local prototypes */
 static void set_worksubdir(struct rpminspect *, workdir_t, const struct koji_build *, const struct koji_task *);
 static int get_rpm_info(const char *);
+static int gather(struct rpminspect *);
 static void prune_local(const int);
 static int copytree(const char *, const struct stat *, int, struct FTW *);
 static int download_build(const struct rpminspect *, struct koji_build *);
 static int download_task(const struct rpminspect *, struct koji_task *);
 static void curl_helper(const bool, const char *, const char *);
+static int download_done(const char *, void *);
+static int fetch_packages(download_list_t *);
 
 /*
  * Set the working subdirectory for this particular run based on whether
@@ -122,7 +125,7 @@ static int get_rpm_info(const char *pkg) {
     arch = get_rpm_header_arch(h);
 
     if (allowed_arch(workri, arch)) {
-        ret = add_peer(&workri->peers, whichbuild, fetch_only, pkg, h);
+        ret = add_peer(workri, whichbuild, fetch_only, pkg, h);
     }
 
     return ret;
@@ -303,6 +306,107 @@ static void curl_helper(const bool verbose, const char *src, const char *dst) {
     return;
 }
 
+/*
+ * Packages being downloaded, in download list order.  The headers are
+ * read as each package arrives, but packages are only added as peers
+ * in list order so the peer list is the same from run to run.
+ */
+struct arrivals {
+    download_entry_t **entries;
+    Header *headers;            /* NULL if the package is not used */
+    bool *arrived;
+    size_t count;
+    size_t next;                /* first package not added as a peer yet */
+};
+
+/* Add the arrived packages as peers, up to the first one still missing */
+static int add_arrivals(struct arrivals *a, bool finished)
+{
+    while (a->next < a->count && (finished || a->arrived[a->next])) {
+        if (a->headers[a->next] != NULL &&
+            add_peer(workri, whichbuild, fetch_only, a->entries[a->next]->dst, a->headers[a->next])) {
+            return -1;
+        }
+
+        a->next++;
+    }
+
+    return 0;
+}
+
+/*
+ * Called by run_downloads() as each package arrives, so headers are
+ * read (and payload extraction queued) while the rest download.
+ */
+static int download_done(const char *dst, void *user_data) {
+    struct arrivals *a = user_data;
+    Header h = NULL;
+    size_t i;
+
+    /* find the package in the list */
+    i = a->next;
+
+    while (i < a->count && strcmp(a->entries[i]->dst, dst)) {
+        i++;
+    }
+
+    assert(i < a->count);
+    h = get_rpm_header(workri, dst);
+
+    if (h == NULL) {
+        fprintf(stderr, _("*** error reading RPM: %s\n"), dst);
+        fflush(stderr);
+        return -1;
+    }
+
+    if (allowed_arch(workri, get_rpm_header_arch(h))) {
+        a->headers[i] = h;
+    }
+
+    a->arrived[i] = true;
+    return add_arrivals(a, false);
+}
+
+/* Download the packages and add them as peers */
+static int fetch_packages(download_list_t *downloads)
+{
+    struct arrivals a;
+    download_entry_t *entry = NULL;
+    bool ok;
+
+    memset(&a, 0, sizeof(a));
+
+    if (downloads != NULL) {
+        TAILQ_FOREACH(entry, downloads, items) {
+            a.count++;
+        }
+    }
+
+    a.entries = calloc(a.count + 1, sizeof(*a.entries));
+    a.headers = calloc(a.count + 1, sizeof(*a.headers));
+    a.arrived = calloc(a.count + 1, sizeof(*a.arrived));
+    assert(a.entries != NULL && a.headers != NULL && a.arrived != NULL);
+    a.count = 0;
+
+    if (downloads != NULL) {
+        TAILQ_FOREACH(entry, downloads, items) {
+            a.entries[a.count++] = entry;
+        }
+    }
+
+    /* packages that could not be downloaded are skipped at the end */
+    ok = run_downloads(workri, downloads, download_done, &a);
+
+    if (ok && add_arrivals(&a, true)) {
+        ok = false;
+    }
+
+    free(a.entries);
+    free(a.headers);
+    free(a.arrived);
+    return ok ? 0 : -1;
+}
+
 /*
  * Given a remote artifact specification in a Koji build, download it
  * to our working directory.
@@ -314,6 +418,7 @@ static int download_build(const struct rpminspect *ri, struct koji_build *build)
     char *src = NULL;
     char *dst = NULL;
     char *pkg = NULL;
+    char *key = NULL;
     FILE *fp = NULL;
     yaml_parser_t parser;
     yaml_token_t token;
@@ -321,6 +426,8 @@ static int download_build(const struct rpminspect *ri, struct koji_build *build)
     string_list_t *filter = NULL;
     string_entry_t *filtered_rpm = NULL;
     bool filtered = false;
+    download_list_t *downloads = NULL;
+    int ret;
 
     assert(build != NULL);
     assert(build->builds != NULL);
@@ -348,6 +455,7 @@ static int download_build(const struct rpminspect *ri, struct koji_build *build)
             if (mkdirp(dst, mode)) {
                 fprintf(stderr, _("*** error creating directory %s: %s\n"), dst, strerror(errno));
                 fflush(stderr);
+                free_downloads(downloads);
                 return -1;
             }
 
@@ -443,6 +551,7 @@ static int download_build(const struct rpminspect *ri, struct koji_build *build)
             if (mkdirp(dst, mode)) {
                 fprintf(stderr, _("*** error creating directory %s: %s\n"), dst, strerror(errno));
                 fflush(stderr);
+                free_downloads(downloads);
                 return -1;
             }
 
@@ -497,26 +606,26 @@ static int download_build(const struct rpminspect *ri, struct koji_build *build)
                 xasprintf(&src, "%s/vol/%s/packages/%s/%s/%s/%s/%s", (workri->buildtype == KOJI_BUILD_MODULE) ? workri->kojimbs : workri->kojiursine, build->volume_name, buildentry->package_name, build->version, build->release, rpm->arch, pkg);
             }
 
-            curl_helper(workri->verbose, src, dst);
-
-            /* gather the RPM header */
-            if (get_rpm_info(dst)) {
-                fprintf(stderr, _("*** error reading RPM: %s\n"), dst);
-                fflush(stderr);
-                return -1;
-            }
+            /* the same build always has the same packages */
+            xasprintf(&key, "build/%d/%s/%lld/%s", buildentry->build_id, pkg, rpm->size, (rpm->payloadhash == NULL) ? "" : rpm->payloadhash);
+            add_download(&downloads, src, dst, key);
 
             /* start over */
             free(src);
             free(dst);
             free(pkg);
+            free(key);
         }
 
         list_free(filter, free);
         filter = NULL;
     }
 
-    return 0;
+    /* fetch the packages, headers are read as each one arrives */
+    ret = fetch_packages(downloads);
+    free_downloads(downloads);
+
+    return ret;
 }
 
 /*
@@ -530,8 +639,11 @@ static int download_task(const struct rpminspect *ri, struct koji_task *task)
     char *src = NULL;
     char *dst = NULL;
     char *tail = NULL;
+    char *key = NULL;
     koji_task_entry_t *descendent = NULL;
     string_entry_t *entry = NULL;
+    download_list_t *downloads = NULL;
+    int ret;
 
     assert(ri != NULL);
     assert(task != NULL);
@@ -553,6 +665,7 @@ static int download_task(const struct rpminspect *ri, struct koji_task *task)
         if (mkdirp(dst, mode)) {
             fprintf(stderr, _("*** error creating directory %s: %s\n"), dst, strerror(errno));
             fflush(stderr);
+            free_downloads(downloads);
             return -1;
         }
 
@@ -571,6 +684,7 @@ static int download_task(const struct rpminspect *ri, struct koji_task *task)
             if (mkdirp(dst, mode)) {
                 fprintf(stderr, _("*** error creating directory %s: %s\n"), dst, strerror(errno));
                 fflush(stderr);
+                free_downloads(downloads);
                 return -1;
             }
 
@@ -582,14 +696,9 @@ static int download_task(const struct rpminspect *ri, struct koji_task *task)
             assert(dst != NULL);
 
             xasprintf(&src, "%s/work/%s", workri->kojiursine, entry->data);
-            curl_helper(workri->verbose, src, dst);
-
-            /* gather the RPM header */
-            if (get_rpm_info(dst)) {
-                fprintf(stderr, _("*** error reading RPM: %s\n"), dst);
-                fflush(stderr);
-                return -1;
-            }
+            xasprintf(&key, "task/%s", entry->data);
+            add_download(&downloads, src, dst, key);
+            free(key);
 
             free(dst);
             free(src);
@@ -605,21 +714,20 @@ static int download_task(const struct rpminspect *ri, struct koji_task *task)
             }
 
             xasprintf(&src, "%s/work/%s", workri->kojiursine, entry->data);
-            curl_helper(workri->verbose, src, dst);
-
-            /* gather the RPM header */
-            if (get_rpm_info(dst)) {
-                fprintf(stderr, _("*** error reading RPM: %s\n"), dst);
-                fflush(stderr);
-                return -1;
-            }
+            xasprintf(&key, "task/%s", entry->data);
+            add_download(&downloads, src, dst, key);
+            free(key);
 
             free(dst);
             free(src);
         }
     }
 
-    return 0;
+    /* fetch the packages, headers are read as each one arrives */
+    ret = fetch_packages(downloads);
+    free_downloads(downloads);
+
+    return ret;
 }
 
 /* Returns true if the string specifies a task ID, which is just an int */
@@ -641,20 +749,13 @@ static bool is_task_id(const char *id)
 }
 
 /*
- * Determines if specified builds are local or remote and fetches
- * them to the working directory.  Either build can be local or
- * remote.
+ * Does the work for gather_builds().  Payloads may still be extracting
+ * in the background when this returns.
  */
-int gather_builds(struct rpminspect *ri, bool fo) {
+static int gather(struct rpminspect *ri) {
     struct koji_build *build = NULL;
     struct koji_task *task = NULL;
 
-    assert(ri != NULL);
-    assert(ri->after != NULL);
-
-    workri = ri;
-    fetch_only = fo;
-
     /* process after first so the temp directory gets the NV of that pkg */
     if (ri->after != NULL) {
         whichbuild = AFTER_BUILD;
@@ -752,3 +853,25 @@ int gather_builds(struct rpminspect *ri, bool fo) {
 
     return 0;
 }
+
+/*
+ * Determines if specified builds are local or remote and fetches
+ * them to the working directory.  Either build can be local or
+ * remote.
+ */
+int gather_builds(struct rpminspect *ri, bool fo) {
+    int ret;
+
+    assert(ri != NULL);
+    assert(ri->after != NULL);
+
+    workri = ri;
+    fetch_only = fo;
+
+    ret = gather(ri);
+
+    /* Wait for the payloads and pair up the files */
+    finish_peers(ri);
+
+    return ret;
+}
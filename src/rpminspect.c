@@ -24,6 +24,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/resource.h>
 #include <signal.h>
 #include <unistd.h>
 #include <limits.h>
@@ -67,6 +68,10 @@ static void usage(const char *progname)
     printf(_("  -l, --list               List available tests and formats\n"));
     printf(_("  -w PATH, --workdir=PATH  Temporary directory to use\n"));
     printf(_("                             (default: %s)\n"), DEFAULT_WORKDIR);
+    printf(_("  -j N, --jobs=N           Number of threads for per-file checks\n"));
+    printf(_("                             (default: 1)\n"));
+    printf(_("  -S, --stream             Stream payloads, only write out files that\n"));
+    printf(_("                             inspections read\n"));
     printf(_("  -f, --fetch-only         Fetch builds only, do not perform inspections\n"));
     printf(_("                             (implies -k)\n"));
     printf(_("  -k, --keep               Do not remove the comparison working files\n"));
@@ -94,8 +99,7 @@ static char *get_product_release(const favor_release_t favor_release, const char
     char *after_product = NULL;
     char *needle = NULL;
     string_entry_t *entry = NULL;
-    ENTRY e;
-    ENTRY *eptr;
+    char *product_re = NULL;
     regex_t product_regex;
     int result;
     char reg_error[BUFSIZ];
@@ -176,16 +180,15 @@ static char *get_product_release(const favor_release_t favor_release, const char
                 }
 
                 /* find this product in the hash table */
-                e.key = entry->data;
-                hsearch_r(e, FIND, &eptr, ri.products);
+                product_re = hashmap_get(ri.products, entry->data);
 
                 /* if the config file entry is empty, just ignore it */
-                if (eptr == NULL) {
+                if (product_re == NULL) {
                     continue;
                 }
 
                 /* build a regex for this product release string */
-                result = regcomp(&product_regex, eptr->data, 0);
+                result = regcomp(&product_regex, product_re, 0);
 
                 if (result != 0) {
                     regerror(result, &product_regex, reg_error, sizeof(reg_error));
@@ -299,7 +302,7 @@ int main(int argc, char **argv) {
     int idx = 0;
     int ret = RI_INSPECTION_SUCCESS;
     glob_t expand;
-    char *short_options = "c:p:T:E:a:r:o:F:lw:t:fkdv\?V";
+    char *short_options = "c:p:T:E:a:r:o:F:lw:t:j:Sfkdv\?V";
     struct option long_options[] = {
         { "config", required_argument, 0, 'c' },
         { "profile", required_argument, 0, 'p' },
@@ -312,6 +315,8 @@ int main(int argc, char **argv) {
         { "format", required_argument, 0, 'F' },
         { "workdir", required_argument, 0, 'w' },
         { "threshold", required_argument, 0, 't' },
+        { "jobs", required_argument, 0, 'j' },
+        { "stream", no_argument, 0, 'S' },
         { "fetch-only", no_argument, 0, 'f' },
         { "keep", no_argument, 0, 'k' },
         { "debug", no_argument, 0, 'd' },
@@ -331,9 +336,12 @@ int main(int argc, char **argv) {
     char *output = NULL;
     char *release = NULL;
     char *threshold = NULL;
+    long jobs = 1;
+    char *endptr = NULL;
     int formatidx = -1;
     bool fetch_only = false;
     bool keep = false;
+    bool stream = false;
     bool list = false;
     bool debug = false;
     bool verbose = false;
@@ -352,6 +360,7 @@ int main(int argc, char **argv) {
     rpmpeer_entry_t *peer = NULL;
     const char *after_rel = NULL;
     const char *before_rel = NULL;
+    struct rusage rusage;
 
     /* Be friendly to "rpminspect ... 2>&1 | tee" use case */
     setlinebuf(stdout);
@@ -445,6 +454,20 @@ int main(int argc, char **argv) {
             case 't':
                 threshold = strdup(optarg);
                 break;
+            case 'j':
+                errno = 0;
+                jobs = strtol(optarg, &endptr, 10);
+
+                if (errno != 0 || *optarg == '\0' || *endptr != '\0' || jobs < 1 || jobs > UINT_MAX) {
+                    fprintf(stderr, _("*** Invalid number of jobs: `%s`.\n"), optarg);
+                    fflush(stderr);
+                    return RI_PROGRAM_ERROR;
+                }
+
+                break;
+            case 'S':
+                stream = true;
+                break;
             case 'f':
                 fetch_only = true;        /* -f implies -k */
                 /* fall through */
@@ -538,7 +561,10 @@ int main(int argc, char **argv) {
 
     /* various options from the command line */
     set_debug_mode(debug);
+    set_cmd_timeout(ri.command_timeout);
     ri.verbose = verbose;
+    ri.jobs = (unsigned int) jobs;
+    ri.stream_payloads = stream;
     ri.product_release = release;
     ri.threshold = getseverity(threshold);
 
@@ -709,25 +735,31 @@ int main(int argc, char **argv) {
             }
         }
 
-        for (i = 0; inspections[i].flag != 0; i++) {
-            /* test not selected by user */
-            if (!(ri.tests & inspections[i].flag)) {
-                continue;
-            }
+        /* formats that can stream write results as they are reported */
+        if (formatidx == -1) {
+            formatidx = 0;                 /* default to 'text' output */
+        }
 
-            /* inspection requires before/after builds and we have one */
-            if (ri.before == NULL && !inspections[i].single_build) {
-                continue;
-            }
+        if (formats[formatidx].sink != NULL) {
+            ri.results_sink = formats[formatidx].sink(output);
 
-            inspections[i].driver(&ri);
+            if (ri.results_sink == NULL) {
+                free_rpminspect(&ri);
+                return RI_PROGRAM_ERROR;
+            }
         }
 
-        /* output the results */
-        if (formatidx == -1) {
-            formatidx = 0;                 /* default to 'text' output */
+        run_inspections(&ri);
+        close_results_sink(&ri);
+        save_analysis_cache(&ri);
+
+        /* memory high-water mark, the file lists are most of it */
+        if (verbose && getrusage(RUSAGE_SELF, &rusage) == 0) {
+            fprintf(stderr, _("Peak memory use: %ld KiB, %zu KiB of it in file lists\n"),
+                    rusage.ru_maxrss, rpmpeer_arena_size(ri.peers) / 1024);
         }
 
+        /* output the results the other formats need all at once */
         if (ri.results != NULL) {
             formats[formatidx].driver(ri.results, output);
         }
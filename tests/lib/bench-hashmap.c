@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compare glibc's hsearch_r(), which the path and alias tables used
+ * to be built on, against hashmap_t.  Keys look like package file
+ * paths.  hsearch_r() is given the 25% headroom the old callers used.
+ *
+ * glibc's hash only takes in the first several characters of a key,
+ * so paths under a long common directory mostly collide and its
+ * lookups slow down with the number of keys.
+ *
+ * Usage: bench-hashmap [COUNT]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <search.h>
+
+#include "rpminspect.h"
+
+#define DEFAULT_COUNT 20000
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec / 1e9);
+}
+
+int main(int argc, char **argv)
+{
+    long count = DEFAULT_COUNT;
+    long i;
+    long found = 0;
+    char **keys = NULL;
+    struct hsearch_data htab;
+    ENTRY e;
+    ENTRY *eptr;
+    hashmap_t *map = NULL;
+    double start;
+    double old_insert;
+    double old_lookup;
+    double new_insert;
+    double new_lookup;
+
+    if (argc > 1) {
+        count = strtol(argv[1], NULL, 10);
+    }
+
+    keys = calloc(count, sizeof(*keys));
+    assert(keys != NULL);
+
+    for (i = 0; i < count; i++) {
+        xasprintf(&keys[i], "/usr/lib/python3.8/site-packages/pkg%ld/module%ld.py", i % 97, i);
+    }
+
+    /* hsearch_r */
+    memset(&htab, 0, sizeof(htab));
+    start = now();
+
+    if (hcreate_r(count * 1.25, &htab) == 0) {
+        fprintf(stderr, "*** unable to create hash table\n");
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < count; i++) {
+        e.key = keys[i];
+        e.data = keys[i];
+        hsearch_r(e, ENTER, &eptr, &htab);
+    }
+
+    old_insert = now() - start;
+    start = now();
+
+    for (i = 0; i < count; i++) {
+        e.key = keys[i];
+
+        if (hsearch_r(e, FIND, &eptr, &htab) != 0) {
+            found++;
+        }
+    }
+
+    old_lookup = now() - start;
+    hdestroy_r(&htab);
+
+    /* hashmap_t, starting small the way callers that cannot size it do */
+    start = now();
+    map = hashmap_new(0);
+
+    for (i = 0; i < count; i++) {
+        hashmap_put(map, keys[i], keys[i]);
+    }
+
+    new_insert = now() - start;
+    start = now();
+
+    for (i = 0; i < count; i++) {
+        if (hashmap_find(map, keys[i], NULL)) {
+            found++;
+        }
+    }
+
+    new_lookup = now() - start;
+    hashmap_free(map, NULL);
+
+    if (found != count * 2) {
+        fprintf(stderr, "*** lookups failed: %ld of %ld found\n", found, count * 2);
+        return EXIT_FAILURE;
+    }
+
+    printf("keys:              %ld\n", count);
+    printf("hsearch_r insert:  %10.1f ns/key\n", (old_insert * 1e9) / count);
+    printf("hsearch_r lookup:  %10.1f ns/key\n", (old_lookup * 1e9) / count);
+    printf("hashmap insert:    %10.1f ns/key\n", (new_insert * 1e9) / count);
+    printf("hashmap lookup:    %10.1f ns/key\n", (new_lookup * 1e9) / count);
+
+    for (i = 0; i < count; i++) {
+        free(keys[i]);
+    }
+
+    free(keys);
+    return EXIT_SUCCESS;
+}
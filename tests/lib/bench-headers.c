@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Load many RPM headers through get_rpm_header() and look them all up
+ * again, the way copytree() does for a large local compose.  The
+ * lookups are also timed against a walk of the header cache list,
+ * which is what get_rpm_header() used to do for every call.
+ *
+ * Usage: bench-headers RPM [COUNT]
+ *
+ * RPM is linked in to a temporary directory under COUNT different
+ * names (10000 by default) so each one is read and cached separately.
+ * Without an RPM the benchmark is skipped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <assert.h>
+#include <rpm/rpmlib.h>
+
+#include "rpminspect.h"
+
+#define DEFAULT_COUNT 10000
+
+/* meson treats this exit code as a skipped test */
+#define EXIT_SKIP 77
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec / 1e9);
+}
+
+/* What get_rpm_header() used to do to find a cached header */
+static Header old_lookup(struct rpminspect *ri, const char *pkg)
+{
+    header_cache_entry_t *hentry = NULL;
+    const char *bpkg = basename(pkg);
+
+    TAILQ_FOREACH(hentry, ri->header_cache, items) {
+        if (!strcmp(hentry->pkg, bpkg)) {
+            return hentry->hdr;
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    char tmpdir[] = "/tmp/bench-headers.XXXXXX";
+    char **paths = NULL;
+    long count = DEFAULT_COUNT;
+    long i;
+    struct rpminspect ri;
+    double start;
+    double load_time;
+    double new_time;
+    double old_time;
+
+    if (argc < 2) {
+        printf("no RPM given, skipping\n");
+        return EXIT_SKIP;
+    }
+
+    if (argc > 2) {
+        count = strtol(argv[2], NULL, 10);
+    }
+
+    if (init_librpm() != RPMRC_OK || mkdtemp(tmpdir) == NULL) {
+        fprintf(stderr, "*** unable to set up\n");
+        return EXIT_FAILURE;
+    }
+
+    /* COUNT packages with different names */
+    paths = calloc(count, sizeof(*paths));
+    assert(paths != NULL);
+
+    for (i = 0; i < count; i++) {
+        xasprintf(&paths[i], "%s/pkg%ld-1.0-1.noarch.rpm", tmpdir, i);
+
+        if (symlink(argv[1], paths[i]) != 0) {
+            fprintf(stderr, "*** unable to create %s\n", paths[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    memset(&ri, 0, sizeof(ri));
+
+    /* read and cache every header */
+    start = now();
+
+    for (i = 0; i < count; i++) {
+        if (get_rpm_header(&ri, paths[i]) == NULL) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    load_time = now() - start;
+
+    /* look them all up again */
+    start = now();
+
+    for (i = 0; i < count; i++) {
+        get_rpm_header(&ri, paths[i]);
+    }
+
+    new_time = now() - start;
+
+    start = now();
+
+    for (i = 0; i < count; i++) {
+        old_lookup(&ri, paths[i]);
+    }
+
+    old_time = now() - start;
+
+    printf("headers:           %ld\n", count);
+    printf("load:              %10.1f us/header\n", (load_time * 1e6) / count);
+    printf("hash lookup:       %10.3f us/header\n", (new_time * 1e6) / count);
+    printf("list walk lookup:  %10.3f us/header\n", (old_time * 1e6) / count);
+
+    for (i = 0; i < count; i++) {
+        unlink(paths[i]);
+        free(paths[i]);
+    }
+
+    free(paths);
+    rmdir(tmpdir);
+    free_rpminspect(&ri);
+    rpmFreeRpmrc();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compare the per-file cost of MIME type lookups when the magic
+ * database is loaded for every file (the old get_mime_type()) against
+ * the per-thread cookie get_mime_type() uses now.
+ *
+ * Usage: bench-magic [DIRECTORY [MAXFILES]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <time.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <magic.h>
+
+#include "rpminspect.h"
+
+#define DEFAULT_DIR "/usr/bin"
+#define DEFAULT_MAXFILES 2000
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec / 1e9);
+}
+
+/* What get_mime_type() used to do for each file */
+static char *old_mime_type(const char *path)
+{
+    char *ret = NULL;
+    const char *tmp = NULL;
+    magic_t cookie;
+
+    cookie = magic_open(MAGIC_MIME | MAGIC_CHECK);
+    assert(cookie != NULL);
+
+    if (magic_load(cookie, NULL) == 0 && (tmp = magic_file(cookie, path)) != NULL) {
+        ret = strdup(tmp);
+    }
+
+    magic_close(cookie);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = DEFAULT_DIR;
+    long maxfiles = DEFAULT_MAXFILES;
+    DIR *d = NULL;
+    struct dirent *de = NULL;
+    char **paths = NULL;
+    long npaths = 0;
+    long i;
+    struct rpminspect ri;
+    rpmfile_entry_t file;
+    double start;
+    double old_time;
+    double new_time;
+
+    if (argc > 1) {
+        dir = argv[1];
+    }
+
+    if (argc > 2) {
+        maxfiles = strtol(argv[2], NULL, 10);
+    }
+
+    /* Collect the regular files to look at */
+    if ((d = opendir(dir)) == NULL) {
+        fprintf(stderr, "*** unable to open %s\n", dir);
+        return EXIT_FAILURE;
+    }
+
+    paths = calloc(maxfiles, sizeof(*paths));
+    assert(paths != NULL);
+
+    while ((de = readdir(d)) != NULL && npaths < maxfiles) {
+        if (de->d_type == DT_REG) {
+            xasprintf(&paths[npaths], "%s/%s", dir, de->d_name);
+            npaths++;
+        }
+    }
+
+    closedir(d);
+
+    if (npaths == 0) {
+        fprintf(stderr, "*** no regular files found in %s\n", dir);
+        return EXIT_FAILURE;
+    }
+
+    /* Load the magic database for every file */
+    start = now();
+
+    for (i = 0; i < npaths; i++) {
+        free(old_mime_type(paths[i]));
+    }
+
+    old_time = now() - start;
+
+    /* Reuse the per-thread cookie */
+    memset(&ri, 0, sizeof(ri));
+
+    if (!init_magic_cookies(&ri)) {
+        return EXIT_FAILURE;
+    }
+
+    start = now();
+
+    for (i = 0; i < npaths; i++) {
+        memset(&file, 0, sizeof(file));
+        file.fullpath = paths[i];
+        get_mime_type(&ri, &file);
+    }
+
+    new_time = now() - start;
+    free_magic_cookies(&ri);
+    intern_free();
+
+    printf("files:             %ld\n", npaths);
+    printf("per-file cookie:   %10.1f us/file\n", (old_time * 1e6) / npaths);
+    printf("per-thread cookie: %10.1f us/file\n", (new_time * 1e6) / npaths);
+
+    for (i = 0; i < npaths; i++) {
+        free(paths[i]);
+    }
+
+    free(paths);
+    return EXIT_SUCCESS;
+}
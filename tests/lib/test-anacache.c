@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <limits.h>
+#include <libgen.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <rpm/header.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+#define DIGEST "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+#define OLD_DIGEST "1123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+#define NEW_DIGEST "2123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+
+static char workdir[] = "/tmp/test-anacache.XXXXXX";
+static struct rpminspect ri;
+static Header hdr = NULL;
+
+int init_test_anacache(void) {
+    if (mkdtemp(workdir) == NULL) {
+        return -1;
+    }
+
+    memset(&ri, 0, sizeof(ri));
+    xasprintf(&ri.analysis_cache, "%s/cache", workdir);
+    ri.analysis_cache_size = ANALYSIS_CACHE_SIZE * 1024ULL * 1024ULL;
+
+    hdr = headerNew();
+    headerPutString(hdr, RPMTAG_SHA256HEADER, DIGEST);
+    return 0;
+}
+
+int clean_test_anacache(void) {
+    headerFree(hdr);
+    free(ri.analysis_cache);
+    rmtree(workdir, true, false);
+    return 0;
+}
+
+/* Add a file to the list, creating it under dir */
+static void add_file(rpmfile_t *files, const char *dir, const char *localpath, mode_t mode, const char *contents)
+{
+    rpmfile_entry_t *file = NULL;
+    FILE *fp = NULL;
+    char *parent = NULL;
+
+    file = calloc(1, sizeof(*file));
+    assert(file != NULL);
+    file->rpm_header = hdr;
+    file->localpath = strdup(localpath);
+    file->idx = files->tqh_first == NULL ? 0 : 1;
+    file->st.st_mode = mode;
+    xasprintf(&file->fullpath, "%s%s", dir, localpath);
+
+    parent = strdup(file->fullpath);
+    mkdirp(dirname(parent), S_IRWXU);
+    free(parent);
+
+    if (S_ISDIR(mode)) {
+        mkdirp(file->fullpath, S_IRWXU);
+    } else if (S_ISLNK(mode)) {
+        RI_ASSERT_EQUAL(symlink(contents, file->fullpath), 0);
+    } else {
+        fp = fopen(file->fullpath, "w");
+        assert(fp != NULL);
+        fputs(contents, fp);
+        fclose(fp);
+        file->st.st_size = strlen(contents);
+    }
+
+    TAILQ_INSERT_TAIL(files, file, items);
+}
+
+static rpmfile_entry_t *find_file(rpmfile_t *files, const char *localpath)
+{
+    rpmfile_entry_t *file = NULL;
+
+    TAILQ_FOREACH(file, files, items) {
+        if (!strcmp(file->localpath, localpath)) {
+            return file;
+        }
+    }
+
+    return NULL;
+}
+
+void test_analysis_cache(void) {
+    rpmfile_t *files = NULL;
+    rpmfile_t *cached = NULL;
+    rpmfile_entry_t *file = NULL;
+    rpmpeer_entry_t *peer = NULL;
+    char *src = NULL;
+    char *dst = NULL;
+    char target[PATH_MAX];
+    ssize_t len;
+
+    /* nothing cached yet */
+    xasprintf(&src, "%s/pkg-1.0-1.x86_64", workdir);
+    xasprintf(&dst, "%s/again-1.0-1.x86_64", workdir);
+    RI_ASSERT_PTR_NULL(load_analysis(&ri, hdr, dst));
+
+    /* a small extracted payload */
+    files = calloc(1, sizeof(*files));
+    assert(files != NULL);
+    TAILQ_INIT(files);
+    mkdirp(src, S_IRWXU);
+    add_file(files, src, "/usr/bin/tool", S_IFREG | 0755, "#!/bin/sh\n");
+    add_file(files, src, "/usr/share", S_IFDIR | 0755, NULL);
+    add_file(files, src, "/usr/bin/alias", S_IFLNK | 0777, "tool");
+
+    store_analysis(&ri, hdr, files);
+
+    /* the inspections learn something and it is saved at the end */
+    file = find_file(files, "/usr/bin/tool");
+    file->checksum = strdup("abc123");
+    file->type_id = intern_id("text/x-shellscript");
+    peer = calloc(1, sizeof(*peer));
+    assert(peer != NULL);
+    peer->after_hdr = hdr;
+    peer->after_files = files;
+    ri.peers = init_rpmpeer();
+    TAILQ_INSERT_TAIL(ri.peers, peer, items);
+    save_analysis_cache(&ri);
+
+    /* another run gets the payload and the analysis back */
+    cached = load_analysis(&ri, hdr, dst);
+    RI_ASSERT_PTR_NOT_NULL(cached);
+
+    file = find_file(cached, "/usr/bin/tool");
+    RI_ASSERT_PTR_NOT_NULL(file);
+    RI_ASSERT_STRING_EQUAL(file->checksum, "abc123");
+    RI_ASSERT_STRING_EQUAL(intern_string(file->type_id), "text/x-shellscript");
+    RI_ASSERT_EQUAL(file->st.st_size, strlen("#!/bin/sh\n"));
+    RI_ASSERT_EQUAL(file->idx, 0);
+    RI_ASSERT_EQUAL(access(file->fullpath, R_OK), 0);
+    RI_ASSERT_TRUE(strprefix(file->fullpath, dst));
+
+    file = find_file(cached, "/usr/bin/alias");
+    RI_ASSERT_PTR_NOT_NULL(file);
+    len = readlink(file->fullpath, target, sizeof(target) - 1);
+    RI_ASSERT_EQUAL(len, 4);
+
+    file = find_file(cached, "/usr/share");
+    RI_ASSERT_PTR_NOT_NULL(file);
+    RI_ASSERT_TRUE(S_ISDIR(file->st.st_mode));
+
+    free_files(cached);
+    free_rpmpeer(ri.peers);
+    ri.peers = NULL;
+    free(src);
+    free(dst);
+}
+
+void test_analysis_cache_version(void) {
+    char *path = NULL;
+    char *dst = NULL;
+    FILE *fp = NULL;
+
+    /* an entry from another format version is not used */
+    xasprintf(&path, "%s/01/%s/files.json", ri.analysis_cache, DIGEST);
+    fp = fopen(path, "w");
+    RI_ASSERT_PTR_NOT_NULL(fp);
+
+    if (fp != NULL) {
+        fprintf(fp, "{ \"version\": %d, \"files\": [ ] }\n", ANALYSIS_CACHE_VERSION + 1);
+        fclose(fp);
+    }
+
+    xasprintf(&dst, "%s/old-1.0-1.x86_64", workdir);
+    RI_ASSERT_PTR_NULL(load_analysis(&ri, hdr, dst));
+    RI_ASSERT_NOT_EQUAL(access(dst, F_OK), 0);
+
+    free(path);
+    free(dst);
+}
+
+/* Store a payload of one file with the given contents under a new header */
+static Header store_payload(const char *digest, const char *name, const char *contents, rpmfile_t **files)
+{
+    Header h = NULL;
+    rpmfile_entry_t *file = NULL;
+    char *dir = NULL;
+
+    h = headerNew();
+    headerPutString(h, RPMTAG_SHA256HEADER, digest);
+
+    *files = calloc(1, sizeof(**files));
+    assert(*files != NULL);
+    TAILQ_INIT(*files);
+    xasprintf(&dir, "%s/%s", workdir, name);
+    mkdirp(dir, S_IRWXU);
+    add_file(*files, dir, "/usr/share/data", S_IFREG | 0644, contents);
+
+    TAILQ_FOREACH(file, *files, items) {
+        file->rpm_header = h;
+    }
+
+    store_analysis(&ri, h, *files);
+    free(dir);
+    return h;
+}
+
+void test_analysis_cache_prune(void) {
+    Header old_hdr = NULL;
+    Header new_hdr = NULL;
+    rpmfile_t *old_files = NULL;
+    rpmfile_t *new_files = NULL;
+    rpmpeer_entry_t *peer = NULL;
+    struct timespec times[2] = { { 946684800, 0 }, { 946684800, 0 } };
+    char *big = NULL;
+    char *old_entry = NULL;
+    char *new_entry = NULL;
+    char *stale_tmp = NULL;
+    char *fresh_tmp = NULL;
+    char *path = NULL;
+    FILE *fp = NULL;
+    unsigned long long size = 0;
+
+    /* a large entry that has not been used in a long time */
+    big = malloc(1024 * 1024 + 1);
+    assert(big != NULL);
+    memset(big, 'x', 1024 * 1024);
+    big[1024 * 1024] = '\0';
+    old_hdr = store_payload(OLD_DIGEST, "old-1.0-1.x86_64", big, &old_files);
+    xasprintf(&old_entry, "%s/11/%s", ri.analysis_cache, OLD_DIGEST);
+    RI_ASSERT_EQUAL(utimensat(AT_FDCWD, old_entry, times, 0), 0);
+
+    /* the payload size is recorded with the entry */
+    xasprintf(&path, "%s/size", old_entry);
+    fp = fopen(path, "r");
+    RI_ASSERT_PTR_NOT_NULL(fp);
+    RI_ASSERT_EQUAL(fscanf(fp, "%llu", &size), 1);
+    RI_ASSERT_EQUAL(size, 1024 * 1024);
+    fclose(fp);
+    free(path);
+
+    /* an entry left half written long ago and one being written now */
+    xasprintf(&stale_tmp, "%s/11/%s.tmp.abcdef", ri.analysis_cache, OLD_DIGEST);
+    RI_ASSERT_EQUAL(mkdirp(stale_tmp, S_IRWXU), 0);
+    RI_ASSERT_EQUAL(utimensat(AT_FDCWD, stale_tmp, times, 0), 0);
+    xasprintf(&fresh_tmp, "%s/11/%s.tmp.ghijkl", ri.analysis_cache, OLD_DIGEST);
+    RI_ASSERT_EQUAL(mkdirp(fresh_tmp, S_IRWXU), 0);
+
+    /* a small entry used by this run */
+    new_hdr = store_payload(NEW_DIGEST, "new-1.0-1.x86_64", "data\n", &new_files);
+    xasprintf(&new_entry, "%s/21/%s", ri.analysis_cache, NEW_DIGEST);
+
+    peer = calloc(1, sizeof(*peer));
+    assert(peer != NULL);
+    peer->after_hdr = new_hdr;
+    peer->after_files = new_files;
+    ri.peers = init_rpmpeer();
+    TAILQ_INSERT_TAIL(ri.peers, peer, items);
+
+    /* only the least recently used entry has to go to fit */
+    ri.analysis_cache_size = 512 * 1024;
+    save_analysis_cache(&ri);
+    RI_ASSERT_NOT_EQUAL(access(old_entry, F_OK), 0);
+    RI_ASSERT_EQUAL(access(new_entry, F_OK), 0);
+    RI_ASSERT_NOT_EQUAL(access(stale_tmp, F_OK), 0);
+    RI_ASSERT_EQUAL(access(fresh_tmp, F_OK), 0);
+    ri.analysis_cache_size = ANALYSIS_CACHE_SIZE * 1024ULL * 1024ULL;
+
+    free_rpmpeer(ri.peers);
+    ri.peers = NULL;
+    free_files(old_files);
+    headerFree(old_hdr);
+    headerFree(new_hdr);
+    free(old_entry);
+    free(new_entry);
+    free(stale_tmp);
+    free(fresh_tmp);
+    free(big);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("anacache", init_test_anacache, clean_test_anacache);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test analysis cache", test_analysis_cache) == NULL ||
+        CU_add_test(pSuite, "test analysis cache version", test_analysis_cache_version) == NULL ||
+        CU_add_test(pSuite, "test analysis cache pruning", test_analysis_cache_prune) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
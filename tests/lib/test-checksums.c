@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <rpm/header.h>
+#include <rpm/rpmpgp.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+/* larger than one chunk and not a multiple of anything */
+#define BIGSIZE ((3 * 1024 * 1024) + 123)
+
+#define ABC_SHA256 "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"
+
+#define ALL_SUMS (CHECKSUM_MASK(MD5SUM) | CHECKSUM_MASK(SHA1SUM) | CHECKSUM_MASK(SHA256SUM) | CHECKSUM_MASK(FASTSUM))
+
+static char workdir[] = "/tmp/test-checksums.XXXXXX";
+static char *small = NULL;
+static char *empty = NULL;
+static char *big = NULL;
+static unsigned char *bigdata = NULL;
+
+static char *write_file(const char *name, const void *data, size_t len)
+{
+    char *path = NULL;
+    FILE *fp = NULL;
+
+    xasprintf(&path, "%s/%s", workdir, name);
+    fp = fopen(path, "w");
+    assert(fp != NULL);
+    assert(fwrite(data, 1, len, fp) == len);
+    fclose(fp);
+    return path;
+}
+
+static void free_sums(char **sums)
+{
+    int i;
+
+    for (i = 0; i < NUM_CHECKSUMS; i++) {
+        free(sums[i]);
+    }
+}
+
+int init_test_checksums(void) {
+    size_t i;
+
+    if (mkdtemp(workdir) == NULL) {
+        return -1;
+    }
+
+    bigdata = malloc(BIGSIZE);
+    assert(bigdata != NULL);
+
+    for (i = 0; i < BIGSIZE; i++) {
+        bigdata[i] = ((i * 7) + (i >> 8)) & 0xff;
+    }
+
+    small = write_file("small", "abc", 3);
+    empty = write_file("empty", "", 0);
+    big = write_file("big", bigdata, BIGSIZE);
+    return 0;
+}
+
+int clean_test_checksums(void) {
+    free(small);
+    free(empty);
+    free(big);
+    free(bigdata);
+    rmtree(workdir, true, false);
+    return 0;
+}
+
+void test_compute_checksum(void) {
+    char *sum = NULL;
+
+    sum = compute_checksum(small, NULL, MD5SUM);
+    RI_ASSERT_STRING_EQUAL(sum, "900150983cd24fb0d6963f7d28e17f72");
+    free(sum);
+
+    sum = compute_checksum(small, NULL, SHA1SUM);
+    RI_ASSERT_STRING_EQUAL(sum, "a9993e364706816aba3e25717850c26c9cd0d89d");
+    free(sum);
+
+    sum = compute_checksum(small, NULL, SHA256SUM);
+    RI_ASSERT_STRING_EQUAL(sum, ABC_SHA256);
+    free(sum);
+
+    sum = compute_checksum(small, NULL, FASTSUM);
+    RI_ASSERT_STRING_EQUAL(sum, "44bc2cf5ad770999");
+    free(sum);
+
+    /* empty files are not mapped */
+    sum = compute_checksum(empty, NULL, FASTSUM);
+    RI_ASSERT_STRING_EQUAL(sum, "ef46db3751d8e999");
+    free(sum);
+
+    sum = compute_checksum(empty, NULL, SHA256SUM);
+    RI_ASSERT_STRING_EQUAL(sum, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    free(sum);
+
+    RI_ASSERT_PTR_NULL(compute_checksum(small, NULL, NULLSUM));
+}
+
+void test_compute_checksums(void) {
+    char *sums[NUM_CHECKSUMS];
+
+    /* every digest from one pass over a file several chunks long */
+    RI_ASSERT_TRUE(compute_checksums(big, NULL, ALL_SUMS, sums));
+    RI_ASSERT_PTR_NULL(sums[NULLSUM]);
+    RI_ASSERT_STRING_EQUAL(sums[MD5SUM], "076c2a5f4363d92b56e2194ba35dce52");
+    RI_ASSERT_STRING_EQUAL(sums[SHA1SUM], "c099cf6463156f96cc8c2c5019bf96ebc86d8a1c");
+    RI_ASSERT_STRING_EQUAL(sums[SHA256SUM], "68682f8dfa203d9b35799d0e318dc664634f7c55585ab13517365b746eb206cf");
+    RI_ASSERT_STRING_EQUAL(sums[FASTSUM], "9e2ce43939b70611");
+    free_sums(sums);
+
+    /* only what was asked for */
+    RI_ASSERT_TRUE(compute_checksums(small, NULL, CHECKSUM_MASK(SHA256SUM) | CHECKSUM_MASK(FASTSUM), sums));
+    RI_ASSERT_PTR_NULL(sums[MD5SUM]);
+    RI_ASSERT_PTR_NULL(sums[SHA1SUM]);
+    RI_ASSERT_STRING_EQUAL(sums[SHA256SUM], ABC_SHA256);
+    RI_ASSERT_STRING_EQUAL(sums[FASTSUM], "44bc2cf5ad770999");
+    free_sums(sums);
+
+    /* missing files fail cleanly */
+    RI_ASSERT_FALSE(compute_checksums("/nonexistent/file", NULL, ALL_SUMS, sums));
+    RI_ASSERT_PTR_NULL(sums[SHA256SUM]);
+}
+
+void test_checksum_stream(void) {
+    checksum_ctx_t *ctx = NULL;
+    char *sums[NUM_CHECKSUMS];
+    size_t off = 0;
+    size_t n = 1;
+
+    /* uneven pieces have to give the same result as one big update */
+    ctx = checksum_begin(CHECKSUM_MASK(SHA256SUM) | CHECKSUM_MASK(FASTSUM));
+
+    while (off < BIGSIZE) {
+        if (n > BIGSIZE - off) {
+            n = BIGSIZE - off;
+        }
+
+        checksum_update(ctx, bigdata + off, n);
+        off += n;
+        n = (n * 3) % 1021 + 1;
+    }
+
+    checksum_end(ctx, sums);
+    RI_ASSERT_STRING_EQUAL(sums[SHA256SUM], "68682f8dfa203d9b35799d0e318dc664634f7c55585ab13517365b746eb206cf");
+    RI_ASSERT_STRING_EQUAL(sums[FASTSUM], "9e2ce43939b70611");
+    free_sums(sums);
+}
+
+void test_header_digest(void) {
+    struct rpminspect ri;
+    Header hdr = NULL;
+    const char *digests[] = { "", ABC_SHA256, "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef" };
+    rpmfile_entry_t file;
+
+    memset(&ri, 0, sizeof(ri));
+    memset(&file, 0, sizeof(file));
+    hdr = headerNew();
+    headerPutStringArray(hdr, RPMTAG_FILEDIGESTS, digests, 3);
+    file.rpm_header = hdr;
+    file.localpath = "/usr/share/foo/abc";
+    file.st.st_mode = S_IFREG | 0644;
+
+    /* MD5 digests (no algorithm tag) are not used */
+    file.idx = 1;
+    RI_ASSERT_PTR_NULL(get_header_digest(&file));
+
+    /* the header digest is used as is, the file is never read */
+    headerPutUint32(hdr, RPMTAG_FILEDIGESTALGO, (uint32_t []) { PGPHASHALGO_SHA256 }, 1);
+    file.fullpath = "/nonexistent/file";
+    RI_ASSERT_STRING_EQUAL(get_header_digest(&file), ABC_SHA256);
+    RI_ASSERT_STRING_EQUAL(checksum(&ri, &file), ABC_SHA256);
+    free(file.checksum);
+    file.checksum = NULL;
+
+    /* files without a digest */
+    file.idx = 0;
+    RI_ASSERT_PTR_NULL(get_header_digest(&file));
+    RI_ASSERT_PTR_NULL(known_checksum(&ri, &file));
+
+    /* when verifying, the payload wins over a wrong header digest */
+    ri.verify_digests = true;
+    file.idx = 2;
+    file.fullpath = small;
+    RI_ASSERT_PTR_NULL(known_checksum(&ri, &file));
+    RI_ASSERT_STRING_EQUAL(checksum(&ri, &file), ABC_SHA256);
+    free(file.checksum);
+
+    headerFree(hdr);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("checksums", init_test_checksums, clean_test_checksums);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test compute_checksum()", test_compute_checksum) == NULL ||
+        CU_add_test(pSuite, "test compute_checksums()", test_compute_checksums) == NULL ||
+        CU_add_test(pSuite, "test streaming checksums", test_checksum_stream) == NULL ||
+        CU_add_test(pSuite, "test header file digests", test_header_digest) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Tests for run_downloads().  A small HTTP server on the loopback
+ * interface stands in for the Koji package URL:
+ *
+ *   /packages/NAME   returns "contents of NAME"
+ *   /slow/NAME       the same, after one second
+ *   /flaky/NAME      503 for the first two requests, then the contents
+ *   /missing/NAME    404
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+static int server_fd = -1;
+static int server_port = 0;
+static pthread_t server_thread;
+static pthread_mutex_t hits_lock = PTHREAD_MUTEX_INITIALIZER;
+static int flaky_hits = 0;
+static int missing_hits = 0;
+static int cached_hits = 0;
+static char workdir[] = "/tmp/test-download.XXXXXX";
+static struct rpminspect ri;
+
+static void *serve_connection(void *arg)
+{
+    int fd = (int) (intptr_t) arg;
+    char req[1024];
+    char path[512];
+    char *body = NULL;
+    char *resp = NULL;
+    const char *status = "200 OK";
+    const char *name = NULL;
+    ssize_t n;
+    size_t len = 0;
+
+    /* read the request line and headers */
+    while (len < sizeof(req) - 1 && (n = read(fd, req + len, sizeof(req) - 1 - len)) > 0) {
+        len += n;
+        req[len] = '\0';
+
+        if (strstr(req, "\r\n\r\n")) {
+            break;
+        }
+    }
+
+    req[len] = '\0';
+
+    if (sscanf(req, "GET %511s ", path) != 1) {
+        close(fd);
+        return NULL;
+    }
+
+    name = rindex(path, '/') + 1;
+
+    if (strprefix(path, "/slow/")) {
+        sleep(1);
+    } else if (strprefix(path, "/flaky/")) {
+        pthread_mutex_lock(&hits_lock);
+
+        if (flaky_hits++ < 2) {
+            status = "503 Service Unavailable";
+        }
+
+        pthread_mutex_unlock(&hits_lock);
+    } else if (strprefix(path, "/missing/")) {
+        pthread_mutex_lock(&hits_lock);
+        missing_hits++;
+        pthread_mutex_unlock(&hits_lock);
+        status = "404 Not Found";
+    } else if (strprefix(path, "/cached/")) {
+        pthread_mutex_lock(&hits_lock);
+        cached_hits++;
+        pthread_mutex_unlock(&hits_lock);
+    }
+
+    xasprintf(&body, "contents of %s", name);
+    xasprintf(&resp, "HTTP/1.1 %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n%s", status, strlen(body), body);
+
+    if (write(fd, resp, strlen(resp)) == -1) {
+        fprintf(stderr, "*** unable to write response\n");
+    }
+
+    free(body);
+    free(resp);
+    close(fd);
+    return NULL;
+}
+
+static void *serve(void *arg __attribute__((unused)))
+{
+    int fd;
+    pthread_t t;
+
+    while ((fd = accept(server_fd, NULL, NULL)) != -1) {
+        if (pthread_create(&t, NULL, serve_connection, (void *) (intptr_t) fd) == 0) {
+            pthread_detach(t);
+        } else {
+            close(fd);
+        }
+    }
+
+    return NULL;
+}
+
+int init_test_download(void) {
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+
+    if (mkdtemp(workdir) == NULL) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == -1 ||
+        bind(server_fd, (struct sockaddr *) &addr, sizeof(addr)) == -1 ||
+        listen(server_fd, 16) == -1 ||
+        getsockname(server_fd, (struct sockaddr *) &addr, &addrlen) == -1) {
+        return -1;
+    }
+
+    server_port = ntohs(addr.sin_port);
+
+    if (pthread_create(&server_thread, NULL, serve, NULL) != 0) {
+        return -1;
+    }
+
+    memset(&ri, 0, sizeof(ri));
+    ri.download_jobs = DOWNLOAD_JOBS;
+    ri.download_retries = DOWNLOAD_RETRIES;
+    ri.download_cache_size = DOWNLOAD_CACHE_SIZE * 1024ULL * 1024ULL;
+    return 0;
+}
+
+int clean_test_download(void) {
+    shutdown(server_fd, SHUT_RDWR);
+    close(server_fd);
+    pthread_join(server_thread, NULL);
+    rmtree(workdir, true, false);
+    return 0;
+}
+
+/* Queue NAME from the given server directory, cached under key if given */
+static void queue_key(download_list_t **list, const char *dir, const char *name, const char *key)
+{
+    char *src = NULL;
+    char *dst = NULL;
+
+    xasprintf(&src, "http://127.0.0.1:%d/%s/%s", server_port, dir, name);
+    xasprintf(&dst, "%s/%s", workdir, name);
+    add_download(list, src, dst, key);
+    free(src);
+    free(dst);
+}
+
+static void queue(download_list_t **list, const char *dir, const char *name)
+{
+    queue_key(list, dir, name, NULL);
+}
+
+/* Remove a downloaded file */
+static void remove_file(const char *name)
+{
+    char *path = NULL;
+
+    xasprintf(&path, "%s/%s", workdir, name);
+    unlink(path);
+    free(path);
+}
+
+/* Returns true if the package for key is in the download cache */
+static bool is_cached(const char *key)
+{
+    char *path = NULL;
+    bool ret;
+
+    xasprintf(&path, "%s/probe.rpm", workdir);
+    ret = fetch_cached(&ri, key, path);
+    unlink(path);
+    free(path);
+    return ret;
+}
+
+/* Return the contents of a downloaded file or NULL */
+static char *read_file(const char *name)
+{
+    char *path = NULL;
+    char buf[BUFSIZ];
+    FILE *fp = NULL;
+    size_t n = 0;
+
+    xasprintf(&path, "%s/%s", workdir, name);
+    fp = fopen(path, "r");
+    free(path);
+
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    n = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[n] = '\0';
+    return strdup(buf);
+}
+
+/* Records how many files arrived */
+static int count_done(const char *dst __attribute__((unused)), void *user_data)
+{
+    (*(int *) user_data)++;
+    return 0;
+}
+
+static int fail_done(const char *dst __attribute__((unused)), void *user_data __attribute__((unused)))
+{
+    return -1;
+}
+
+void test_run_downloads(void) {
+    download_list_t *list = NULL;
+    char *contents = NULL;
+    int done = 0;
+
+    queue(&list, "packages", "a.rpm");
+    queue(&list, "packages", "b.rpm");
+    queue(&list, "packages", "c.rpm");
+
+    RI_ASSERT_TRUE(run_downloads(&ri, list, count_done, &done));
+    RI_ASSERT_EQUAL(done, 3);
+
+    contents = read_file("b.rpm");
+    RI_ASSERT_PTR_NOT_NULL(contents);
+    RI_ASSERT_STRING_EQUAL(contents, "contents of b.rpm");
+    free(contents);
+
+    free_downloads(list);
+}
+
+void test_run_downloads_parallel(void) {
+    download_list_t *list = NULL;
+    int done = 0;
+    time_t start;
+
+    queue(&list, "slow", "s1.rpm");
+    queue(&list, "slow", "s2.rpm");
+    queue(&list, "slow", "s3.rpm");
+    queue(&list, "slow", "s4.rpm");
+
+    /* four one second transfers, four at a time */
+    start = time(NULL);
+    RI_ASSERT_TRUE(run_downloads(&ri, list, count_done, &done));
+    RI_ASSERT_TRUE(time(NULL) - start < 3);
+    RI_ASSERT_EQUAL(done, 4);
+
+    free_downloads(list);
+}
+
+void test_run_downloads_retry(void) {
+    download_list_t *list = NULL;
+    char *contents = NULL;
+    int done = 0;
+    struct timespec start;
+    struct timespec end;
+    long elapsed;
+
+    /* the server fails twice, there are three retries */
+    queue(&list, "flaky", "f.rpm");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    RI_ASSERT_TRUE(run_downloads(&ri, list, count_done, &done));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    RI_ASSERT_EQUAL(done, 1);
+    RI_ASSERT_EQUAL(flaky_hits, 3);
+
+    /* the second retry waits twice as long as the first */
+    elapsed = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+    RI_ASSERT_TRUE(elapsed >= DOWNLOAD_RETRY_DELAY * 3);
+
+    contents = read_file("f.rpm");
+    RI_ASSERT_PTR_NOT_NULL(contents);
+    RI_ASSERT_STRING_EQUAL(contents, "contents of f.rpm");
+    free(contents);
+
+    free_downloads(list);
+}
+
+void test_run_downloads_missing(void) {
+    download_list_t *list = NULL;
+    int done = 0;
+
+    /* a 404 is not retried and leaves no file behind */
+    queue(&list, "missing", "m.rpm");
+    queue(&list, "packages", "d.rpm");
+    RI_ASSERT_TRUE(run_downloads(&ri, list, count_done, &done));
+    RI_ASSERT_EQUAL(done, 1);
+    RI_ASSERT_EQUAL(missing_hits, 1);
+    RI_ASSERT_PTR_NULL(read_file("m.rpm"));
+
+    free_downloads(list);
+}
+
+void test_run_downloads_done_fails(void) {
+    download_list_t *list = NULL;
+
+    queue(&list, "packages", "e.rpm");
+    RI_ASSERT_FALSE(run_downloads(&ri, list, fail_done, NULL));
+
+    free_downloads(list);
+}
+
+void test_run_downloads_cache(void) {
+    download_list_t *list = NULL;
+    char *contents = NULL;
+    int done = 0;
+
+    xasprintf(&ri.download_cache, "%s/cache", workdir);
+
+    /* the first run downloads and caches the package */
+    queue_key(&list, "cached", "g.rpm", "g");
+    RI_ASSERT_TRUE(run_downloads(&ri, list, count_done, &done));
+    RI_ASSERT_EQUAL(done, 1);
+    RI_ASSERT_EQUAL(cached_hits, 1);
+    free_downloads(list);
+    list = NULL;
+
+    /* the second run takes it from the cache */
+    remove_file("g.rpm");
+    queue_key(&list, "cached", "g.rpm", "g");
+    RI_ASSERT_TRUE(run_downloads(&ri, list, count_done, &done));
+    RI_ASSERT_EQUAL(done, 2);
+    RI_ASSERT_EQUAL(cached_hits, 1);
+    free_downloads(list);
+
+    contents = read_file("g.rpm");
+    RI_ASSERT_PTR_NOT_NULL(contents);
+    RI_ASSERT_STRING_EQUAL(contents, "contents of g.rpm");
+    free(contents);
+
+    /* a different key is a different package */
+    RI_ASSERT_FALSE(is_cached("h"));
+
+    free(ri.download_cache);
+    ri.download_cache = NULL;
+}
+
+void test_run_downloads_cache_prune(void) {
+    download_list_t *list = NULL;
+
+    xasprintf(&ri.download_cache, "%s/prune", workdir);
+
+    queue_key(&list, "cached", "h.rpm", "h");
+    RI_ASSERT_TRUE(run_downloads(&ri, list, NULL, NULL));
+    free_downloads(list);
+    list = NULL;
+
+    /* only room for one package, the older one goes */
+    ri.download_cache_size = strlen("contents of i.rpm");
+    queue_key(&list, "cached", "i.rpm", "i");
+    RI_ASSERT_TRUE(run_downloads(&ri, list, NULL, NULL));
+    free_downloads(list);
+
+    RI_ASSERT_TRUE(is_cached("i"));
+    RI_ASSERT_FALSE(is_cached("h"));
+
+    free(ri.download_cache);
+    ri.download_cache = NULL;
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("download", init_test_download, clean_test_download);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test run_downloads()", test_run_downloads) == NULL ||
+        CU_add_test(pSuite, "test run_downloads() in parallel", test_run_downloads_parallel) == NULL ||
+        CU_add_test(pSuite, "test run_downloads() retries", test_run_downloads_retry) == NULL ||
+        CU_add_test(pSuite, "test run_downloads() missing file", test_run_downloads_missing) == NULL ||
+        CU_add_test(pSuite, "test run_downloads() callback failure", test_run_downloads_done_fails) == NULL ||
+        CU_add_test(pSuite, "test run_downloads() download cache", test_run_downloads_cache) == NULL ||
+        CU_add_test(pSuite, "test run_downloads() download cache pruning", test_run_downloads_cache_prune) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
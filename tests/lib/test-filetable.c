@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+int init_test_filetable(void) {
+    return 0;
+}
+
+int clean_test_filetable(void) {
+    return 0;
+}
+
+static rpmfile_entry_t *add_file(rpmfile_t *files, const char *localpath, mode_t mode, off_t size)
+{
+    rpmfile_entry_t *file = NULL;
+
+    file = new_file_entry(files);
+    file->localpath = arena_strdup(files->arena, localpath);
+    file->st.st_mode = mode;
+    file->st.st_size = size;
+    file->st.st_uid = 0;
+    file->st.st_gid = 0;
+    TAILQ_INSERT_TAIL(files, file, items);
+    return file;
+}
+
+static void pair(rpmfile_entry_t *before, rpmfile_entry_t *after)
+{
+    before->peer_file = after;
+    after->peer_file = before;
+}
+
+void test_file_tables(void) {
+    struct rpminspect ri;
+    rpmpeer_entry_t *peer = NULL;
+    rpmfile_entry_t *before[3];
+    rpmfile_entry_t *after[4];
+    const file_table_t *table = NULL;
+    uint32_t rows[4];
+
+    memset(&ri, 0, sizeof(ri));
+    ri.peers = init_rpmpeer();
+    peer = calloc(1, sizeof(*peer));
+    assert(peer != NULL);
+    peer->before_files = new_files();
+    peer->after_files = new_files();
+    TAILQ_INSERT_TAIL(ri.peers, peer, items);
+
+    before[0] = add_file(peer->before_files, "/usr/bin/foo", S_IFREG | 0755, 100);
+    before[1] = add_file(peer->before_files, "/usr/share/foo", S_IFDIR | 0755, 0);
+    before[2] = add_file(peer->before_files, "/usr/lib/libfoo.so", S_IFLNK | 0777, 12);
+
+    after[0] = add_file(peer->after_files, "/usr/share/foo", S_IFDIR | 0755, 0);
+    after[1] = add_file(peer->after_files, "/usr/bin/foo", S_IFREG | 0755, 120);
+    after[2] = add_file(peer->after_files, "/usr/bin/new", S_IFREG | 0755, 50);
+    after[3] = add_file(peer->after_files, "/usr/lib/libfoo.so", S_IFLNK | 0777, 14);
+    pair(before[0], after[1]);
+    pair(before[1], after[0]);
+    pair(before[2], after[3]);
+
+    build_file_tables(&ri);
+    table = peer->after_files->table;
+    RI_ASSERT_PTR_NOT_NULL(table);
+    RI_ASSERT_EQUAL(table->count, 4);
+
+    /* rows follow the list and the columns follow the entries */
+    RI_ASSERT_TRUE(table->entries[2] == after[2]);
+    RI_ASSERT_EQUAL(table->mode[3], S_IFLNK | 0777);
+    RI_ASSERT_STRING_EQUAL(table->entries[1]->localpath, "/usr/bin/foo");
+
+    /* files with a peer are marked in both tables */
+    RI_ASSERT_EQUAL(table->peered[0], 1);
+    RI_ASSERT_EQUAL(table->peered[1], 1);
+    RI_ASSERT_EQUAL(table->peered[2], 0);
+    RI_ASSERT_EQUAL(peer->before_files->table->peered[2], 1);
+
+    /* selections */
+    RI_ASSERT_EQUAL(select_files(table, 0, false, rows), 4);
+    RI_ASSERT_EQUAL(select_files(table, 0, true, rows), 3);
+    RI_ASSERT_EQUAL(select_files(table, S_IFREG, false, rows), 2);
+    RI_ASSERT_EQUAL(rows[0], 1);
+    RI_ASSERT_EQUAL(rows[1], 2);
+    RI_ASSERT_EQUAL(select_files(table, S_IFREG, true, rows), 1);
+    RI_ASSERT_EQUAL(rows[0], 1);
+    RI_ASSERT_EQUAL(select_files(table, S_IFCHR, false, rows), 0);
+
+    free_rpmpeer(ri.peers);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("filetable", init_test_filetable, clean_test_filetable);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test file tables", test_file_tables) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+#define NKEYS 10000
+
+int init_test_hashmap(void) {
+    return 0;
+}
+
+int clean_test_hashmap(void) {
+    return 0;
+}
+
+void test_hashmap_put_get(void) {
+    hashmap_t *map = NULL;
+    char key[] = "key";
+    void *value = NULL;
+
+    map = hashmap_new(0);
+    RI_ASSERT_PTR_NOT_NULL(map);
+    RI_ASSERT_PTR_NULL(hashmap_get(map, "key"));
+
+    RI_ASSERT_TRUE(hashmap_put(map, key, "one"));
+    RI_ASSERT_STRING_EQUAL(hashmap_get(map, "key"), "one");
+
+    /* the map has its own copy of the key */
+    key[0] = 'j';
+    RI_ASSERT_PTR_NULL(hashmap_get(map, "jey"));
+    RI_ASSERT_STRING_EQUAL(hashmap_get(map, "key"), "one");
+
+    /* putting it again replaces the value */
+    RI_ASSERT_FALSE(hashmap_put(map, "key", "two"));
+    RI_ASSERT_STRING_EQUAL(hashmap_get(map, "key"), "two");
+    RI_ASSERT_EQUAL(hashmap_count(map), 1);
+
+    /* NULL values can be told apart from missing keys */
+    RI_ASSERT_TRUE(hashmap_put(map, "", NULL));
+    RI_ASSERT_TRUE(hashmap_find(map, "", &value));
+    RI_ASSERT_PTR_NULL(value);
+    RI_ASSERT_FALSE(hashmap_find(map, "missing", NULL));
+
+    hashmap_free(map, NULL);
+
+    /* lookups on a map that was never created find nothing */
+    RI_ASSERT_FALSE(hashmap_find(NULL, "key", NULL));
+    RI_ASSERT_EQUAL(hashmap_count(NULL), 0);
+}
+
+void test_hashmap_grow(void) {
+    hashmap_t *map = NULL;
+    char *key = NULL;
+    intptr_t i;
+    int bad = 0;
+
+    /* start small so the map has to grow many times */
+    map = hashmap_new(1);
+
+    for (i = 0; i < NKEYS; i++) {
+        xasprintf(&key, "/usr/share/doc/pkg/file%ld", (long) i);
+        RI_ASSERT_TRUE(hashmap_put(map, key, (void *) i));
+        free(key);
+    }
+
+    RI_ASSERT_EQUAL(hashmap_count(map), NKEYS);
+
+    for (i = 0; i < NKEYS; i++) {
+        xasprintf(&key, "/usr/share/doc/pkg/file%ld", (long) i);
+
+        if ((intptr_t) hashmap_get(map, key) != i) {
+            bad++;
+        }
+
+        free(key);
+    }
+
+    RI_ASSERT_EQUAL(bad, 0);
+    hashmap_free(map, NULL);
+}
+
+void test_hashmap_remove(void) {
+    hashmap_t *map = NULL;
+    char *key = NULL;
+    intptr_t i;
+    int round;
+
+    map = hashmap_new(16);
+
+    /*
+     * Keep adding and removing keys so the table fills with deleted
+     * slots; they have to be reused or cleared for this to finish.
+     */
+    for (round = 0; round < 100; round++) {
+        for (i = 0; i < 10; i++) {
+            xasprintf(&key, "round%d-%ld", round, (long) i);
+            hashmap_put(map, key, (void *) i);
+            free(key);
+        }
+
+        for (i = 0; i < 10; i++) {
+            xasprintf(&key, "round%d-%ld", round, (long) i);
+            RI_ASSERT_TRUE(hashmap_remove(map, key));
+            RI_ASSERT_FALSE(hashmap_find(map, key, NULL));
+            free(key);
+        }
+    }
+
+    RI_ASSERT_EQUAL(hashmap_count(map), 0);
+    RI_ASSERT_FALSE(hashmap_remove(map, "round0-0"));
+
+    /* a removed key can be added back */
+    RI_ASSERT_TRUE(hashmap_put(map, "round0-0", "back"));
+    RI_ASSERT_STRING_EQUAL(hashmap_get(map, "round0-0"), "back");
+
+    hashmap_free(map, NULL);
+}
+
+void test_hashmap_next(void) {
+    hashmap_t *map = NULL;
+    size_t iter = 0;
+    const char *key = NULL;
+    void *value = NULL;
+    int seen = 0;
+
+    map = hashmap_new(0);
+    hashmap_put(map, "a", strdup("1"));
+    hashmap_put(map, "b", strdup("2"));
+    hashmap_put(map, "c", strdup("3"));
+    free(hashmap_get(map, "b"));
+    hashmap_remove(map, "b");
+
+    while (hashmap_next(map, &iter, &key, &value)) {
+        if (!strcmp(key, "a")) {
+            RI_ASSERT_STRING_EQUAL(value, "1");
+            seen |= 1;
+        } else if (!strcmp(key, "c")) {
+            RI_ASSERT_STRING_EQUAL(value, "3");
+            seen |= 4;
+        } else {
+            seen |= 2;
+        }
+    }
+
+    RI_ASSERT_EQUAL(seen, 5);
+
+    /* frees the remaining values */
+    hashmap_free(map, free);
+}
+
+void test_arena(void) {
+    arena_t *arena = NULL;
+    char *s = NULL;
+    char *big = NULL;
+    void *p = NULL;
+    int i;
+
+    arena = arena_new();
+
+    s = arena_strdup(arena, "hello");
+    RI_ASSERT_STRING_EQUAL(s, "hello");
+    RI_ASSERT_STRING_EQUAL(arena_printf(arena, "%s/%d", "dir", 42), "dir/42");
+    RI_ASSERT_TRUE(arena_size(arena) >= ARENA_BLOCK_SIZE);
+
+    /* more than one block's worth, with an oversized request in the middle */
+    for (i = 0; i < 10000; i++) {
+        p = arena_alloc(arena, 24);
+        RI_ASSERT_EQUAL((uintptr_t) p % 16, 0);
+        memset(p, 0xff, 24);
+
+        if (i == 5000) {
+            big = arena_alloc(arena, ARENA_BLOCK_SIZE * 2);
+            memset(big, 0, ARENA_BLOCK_SIZE * 2);
+        }
+    }
+
+    /* nothing handed out later stepped on the first string */
+    RI_ASSERT_STRING_EQUAL(s, "hello");
+    RI_ASSERT_TRUE(arena_size(arena) > ARENA_BLOCK_SIZE * 3);
+    arena_free(arena);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("hashmap", init_test_hashmap, clean_test_hashmap);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test hashmap_put() and hashmap_get()", test_hashmap_put_get) == NULL ||
+        CU_add_test(pSuite, "test hashmap growth", test_hashmap_grow) == NULL ||
+        CU_add_test(pSuite, "test hashmap_remove()", test_hashmap_remove) == NULL ||
+        CU_add_test(pSuite, "test hashmap_next()", test_hashmap_next) == NULL ||
+        CU_add_test(pSuite, "test arena allocator", test_arena) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
@@ -18,6 +18,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <elf.h>
 #include <CUnit/Basic.h>
 #include "rpminspect.h"
@@ -255,6 +257,107 @@ void test_is_pic_ok(void) {
     return;
 }
 
+void test_get_elf_info(void) {
+    rpmfile_entry_t file;
+    rpmfile_entry_t other;
+    const elf_info_t *info = NULL;
+    const string_entry_t *entry = NULL;
+    bool have_libc = false;
+    size_t i;
+    bool have_text = false;
+
+    memset(&file, 0, sizeof(file));
+    file.fullpath = _BUILDDIR_"/execstack";
+    RI_ASSERT_EQUAL(stat(file.fullpath, &file.st), 0);
+
+    info = get_elf_info(&file);
+    RI_ASSERT_PTR_NOT_NULL(info);
+    RI_ASSERT_PTR_NOT_NULL(info->elf);
+    RI_ASSERT_TRUE(info->ehdr.e_type == ET_EXEC || info->ehdr.e_type == ET_DYN);
+    RI_ASSERT_TRUE(info->phnum > 0);
+
+    /* the section index has names */
+    for (i = 0; i < info->shnum; i++) {
+        if (info->shnames[i] != NULL && !strcmp(info->shnames[i], ".text")) {
+            have_text = true;
+        }
+    }
+
+    RI_ASSERT_TRUE(have_text);
+
+    /* the test program links against libc */
+    RI_ASSERT_PTR_NOT_NULL(info->needed);
+
+    TAILQ_FOREACH(entry, info->needed, items) {
+        if (strprefix(entry->data, "libc.so")) {
+            have_libc = true;
+        }
+    }
+
+    RI_ASSERT_TRUE(have_libc);
+
+    /* the dynamic symbols */
+    RI_ASSERT_TRUE(symset_contains(info->dynsyms, "__libc_start_main"));
+    RI_ASSERT_FALSE(symset_contains(info->dynsyms, "some_function"));
+
+    /* the file is only read once */
+    RI_ASSERT_TRUE(get_elf_info(&file) == info);
+
+    /* files that are not ELF objects have no ELF information */
+    memset(&other, 0, sizeof(other));
+    other.fullpath = _BUILDDIR_"/build.ninja";
+    RI_ASSERT_EQUAL(stat(other.fullpath, &other.st), 0);
+    RI_ASSERT_PTR_NULL(get_elf_info(&other));
+    RI_ASSERT_PTR_NULL(get_elf_info(&other));
+
+    free_elf_info(file.elf_info);
+    free_elf_info(other.elf_info);
+    return;
+}
+
+void test_compare_elf(void) {
+    rpmfile_entry_t before;
+    rpmfile_entry_t after;
+    rpmfile_entry_t other;
+    string_list_t *diffs = NULL;
+    const string_entry_t *entry = NULL;
+    bool have_phdr = false;
+
+    memset(&before, 0, sizeof(before));
+    memset(&after, 0, sizeof(after));
+    memset(&other, 0, sizeof(other));
+    before.fullpath = _BUILDDIR_"/execstack";
+    after.fullpath = _BUILDDIR_"/execstack";
+    other.fullpath = _BUILDDIR_"/noexecstack";
+    RI_ASSERT_EQUAL(stat(before.fullpath, &before.st), 0);
+    RI_ASSERT_EQUAL(stat(after.fullpath, &after.st), 0);
+    RI_ASSERT_EQUAL(stat(other.fullpath, &other.st), 0);
+    RI_ASSERT_PTR_NOT_NULL(get_elf_info(&before));
+    RI_ASSERT_PTR_NOT_NULL(get_elf_info(&after));
+    RI_ASSERT_PTR_NOT_NULL(get_elf_info(&other));
+
+    /* a file is the same as itself */
+    RI_ASSERT_PTR_NULL(compare_elf(before.elf_info, after.elf_info));
+
+    /* the same code linked with a different stack has a different PT_GNU_STACK */
+    diffs = compare_elf(before.elf_info, other.elf_info);
+    RI_ASSERT_PTR_NOT_NULL(diffs);
+
+    TAILQ_FOREACH(entry, diffs, items) {
+        if (strprefix(entry->data, "program header")) {
+            have_phdr = true;
+        }
+    }
+
+    RI_ASSERT_TRUE(have_phdr);
+
+    list_free(diffs, free);
+    free_elf_info(before.elf_info);
+    free_elf_info(after.elf_info);
+    free_elf_info(other.elf_info);
+    return;
+}
+
 CU_pSuite get_suite(void) {
     CU_pSuite pSuite = NULL;
 
@@ -275,7 +378,9 @@ CU_pSuite get_suite(void) {
         CU_add_test(pSuite, "test has_bind_now()", test_has_bind_now) == NULL ||
         CU_add_test(pSuite, "test get_fortified_symbols()", test_get_fortified_symbols) == NULL ||
         CU_add_test(pSuite, "test get_fortifiable_symbols()", test_get_fortifiable_symbols) == NULL ||
-        CU_add_test(pSuite, "test is_pic_ok()", test_is_pic_ok) == NULL) {
+        CU_add_test(pSuite, "test is_pic_ok()", test_is_pic_ok) == NULL ||
+        CU_add_test(pSuite, "test get_elf_info()", test_get_elf_info) == NULL ||
+        CU_add_test(pSuite, "test compare_elf()", test_compare_elf) == NULL) {
         return NULL;
     }
 
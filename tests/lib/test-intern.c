@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+#define NSTRINGS 30000
+
+int init_test_intern(void) {
+    return 0;
+}
+
+int clean_test_intern(void) {
+    intern_free();
+    return 0;
+}
+
+void test_intern_mime_types(void) {
+    /* well known types have fixed IDs, even before the pool is used */
+    RI_ASSERT_STRING_EQUAL(intern_string(MIME_GZIP), "application/x-gzip");
+    RI_ASSERT_STRING_EQUAL(intern_string(MIME_C_SOURCE), "text/x-c");
+    RI_ASSERT_PTR_NULL(intern_string(MIME_NONE));
+
+    RI_ASSERT_EQUAL(intern_id("application/x-pie-executable"), MIME_PIE_EXECUTABLE);
+    RI_ASSERT_EQUAL(intern_id("application/zip"), MIME_ZIP);
+    RI_ASSERT_EQUAL(intern_id(NULL), 0);
+    RI_ASSERT_TRUE(intern_id("text/plain") >= NUM_MIME_TYPES);
+}
+
+void test_intern_strings(void) {
+    char buf[] = "x86_64";
+    const char *arch = NULL;
+    unsigned int id;
+    unsigned int *ids = NULL;
+    char *s = NULL;
+    int i;
+    int bad = 0;
+
+    /* equal strings give the same pointer, not the caller's copy */
+    arch = intern(buf);
+    RI_ASSERT_TRUE(arch != buf);
+    RI_ASSERT_TRUE(intern("x86_64") == arch);
+    buf[0] = 'y';
+    RI_ASSERT_STRING_EQUAL(arch, "x86_64");
+    RI_ASSERT_TRUE(intern("noarch") != arch);
+
+    /* enough strings to fill several chunks */
+    id = intern_id("first");
+    ids = calloc(NSTRINGS, sizeof(*ids));
+
+    for (i = 0; i < NSTRINGS; i++) {
+        xasprintf(&s, "string%d", i);
+        ids[i] = intern_id(s);
+
+        if (strcmp(intern_string(ids[i]), s)) {
+            bad++;
+        }
+
+        free(s);
+    }
+
+    /* the earlier strings did not move */
+    for (i = 0; i < NSTRINGS; i++) {
+        xasprintf(&s, "string%d", i);
+
+        if (intern_id(s) != ids[i] || strcmp(intern_string(ids[i]), s)) {
+            bad++;
+        }
+
+        free(s);
+    }
+
+    free(ids);
+    RI_ASSERT_EQUAL(bad, 0);
+    RI_ASSERT_EQUAL(intern_id("first"), id);
+    RI_ASSERT_STRING_EQUAL(intern_string(id), "first");
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("intern", init_test_intern, clean_test_intern);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test interned MIME types", test_intern_mime_types) == NULL ||
+        CU_add_test(pSuite, "test interned strings", test_intern_strings) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
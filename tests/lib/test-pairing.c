@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <rpm/header.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+static Header before_hdr = NULL;
+static Header after_hdr = NULL;
+
+int init_test_pairing(void) {
+    before_hdr = headerNew();
+    headerPutString(before_hdr, RPMTAG_VERSION, "1.2");
+    headerPutString(before_hdr, RPMTAG_RELEASE, "1");
+
+    after_hdr = headerNew();
+    headerPutString(after_hdr, RPMTAG_VERSION, "1.3");
+    headerPutString(after_hdr, RPMTAG_RELEASE, "1");
+    return 0;
+}
+
+int clean_test_pairing(void) {
+    headerFree(before_hdr);
+    headerFree(after_hdr);
+    return 0;
+}
+
+static rpmfile_entry_t *add_file(rpmfile_t *files, Header hdr, const char *localpath)
+{
+    rpmfile_entry_t *file = NULL;
+
+    file = new_file_entry(files);
+    file->rpm_header = hdr;
+    file->localpath = arena_strdup(files->arena, localpath);
+    TAILQ_INSERT_TAIL(files, file, items);
+    return file;
+}
+
+static const char *peer_path(const rpmfile_entry_t *file)
+{
+    return (file->peer_file == NULL) ? "(none)" : file->peer_file->localpath;
+}
+
+void test_pairing_paths(void) {
+    rpmfile_t *before = new_files();
+    rpmfile_t *after = new_files();
+    rpmfile_entry_t *same = NULL;
+    rpmfile_entry_t *doc = NULL;
+    rpmfile_entry_t *vr = NULL;
+    rpmfile_entry_t *gone = NULL;
+    rpmfile_entry_t *added = NULL;
+
+    same = add_file(before, before_hdr, "/usr/bin/foo");
+    doc = add_file(before, before_hdr, "/usr/share/doc/foo-1.2/README");
+    vr = add_file(before, before_hdr, "/usr/share/foo/foo-1.2-1.jar");
+    gone = add_file(before, before_hdr, "/usr/bin/old");
+
+    add_file(after, after_hdr, "/usr/share/foo/foo-1.3-1.jar");
+    add_file(after, after_hdr, "/usr/share/doc/foo-1.3/README");
+    add_file(after, after_hdr, "/usr/bin/foo");
+    added = add_file(after, after_hdr, "/usr/bin/new");
+
+    find_file_peers(before, after);
+
+    RI_ASSERT_STRING_EQUAL(peer_path(same), "/usr/bin/foo");
+    RI_ASSERT_STRING_EQUAL(peer_path(doc), "/usr/share/doc/foo-1.3/README");
+    RI_ASSERT_STRING_EQUAL(peer_path(vr), "/usr/share/foo/foo-1.3-1.jar");
+    RI_ASSERT_PTR_NULL(gone->peer_file);
+    RI_ASSERT_PTR_NULL(added->peer_file);
+    RI_ASSERT_TRUE(doc->peer_file->peer_file == doc);
+
+    free_files(before);
+    free_files(after);
+}
+
+void test_pairing_exact_first(void) {
+    rpmfile_t *before = new_files();
+    rpmfile_t *after = new_files();
+    rpmfile_entry_t *versioned = NULL;
+    rpmfile_entry_t *plain = NULL;
+
+    /* the version substitution must not take a file another one matches exactly */
+    versioned = add_file(before, before_hdr, "/usr/share/foo/1.2");
+    plain = add_file(before, before_hdr, "/usr/share/foo/1.3");
+    add_file(after, after_hdr, "/usr/share/foo/1.3");
+
+    find_file_peers(before, after);
+
+    RI_ASSERT_PTR_NULL(versioned->peer_file);
+    RI_ASSERT_STRING_EQUAL(peer_path(plain), "/usr/share/foo/1.3");
+
+    free_files(before);
+    free_files(after);
+}
+
+void test_pairing_renames(void) {
+    rpmfile_t *before = new_files();
+    rpmfile_t *after = new_files();
+    rpmfile_entry_t *link = NULL;
+    rpmfile_entry_t *lib = NULL;
+    rpmfile_entry_t *py = NULL;
+    rpmfile_entry_t *pyc = NULL;
+
+    link = add_file(before, before_hdr, "/usr/lib64/libfoo.so.1");
+    lib = add_file(before, before_hdr, "/usr/lib64/libfoo.so.1.2.0");
+    py = add_file(before, before_hdr, "/usr/lib/python3.8/site-packages/foo/__init__.py");
+    pyc = add_file(before, before_hdr, "/usr/lib/python3.8/site-packages/foo/__pycache__/__init__.cpython-38.pyc");
+
+    add_file(after, after_hdr, "/usr/lib64/libfoo.so.2.0.0");
+    add_file(after, after_hdr, "/usr/lib64/libfoo.so.2");
+    add_file(after, after_hdr, "/usr/lib/python3.10/site-packages/foo/__init__.py");
+    add_file(after, after_hdr, "/usr/lib/python3.10/site-packages/foo/__pycache__/__init__.cpython-310.pyc");
+
+    find_file_peers(before, after);
+
+    RI_ASSERT_STRING_EQUAL(peer_path(link), "/usr/lib64/libfoo.so.2");
+    RI_ASSERT_STRING_EQUAL(peer_path(lib), "/usr/lib64/libfoo.so.2.0.0");
+    RI_ASSERT_STRING_EQUAL(peer_path(py), "/usr/lib/python3.10/site-packages/foo/__init__.py");
+    RI_ASSERT_STRING_EQUAL(peer_path(pyc), "/usr/lib/python3.10/site-packages/foo/__pycache__/__init__.cpython-310.pyc");
+
+    free_files(before);
+    free_files(after);
+}
+
+void test_pairing_ambiguous(void) {
+    rpmfile_t *before = new_files();
+    rpmfile_t *after = new_files();
+    rpmfile_entry_t *lib = NULL;
+
+    /* two candidates with the same shape, neither is picked */
+    lib = add_file(before, before_hdr, "/usr/lib64/libbar.so.1.0");
+    add_file(after, after_hdr, "/usr/lib64/libbar.so.2.0");
+    add_file(after, after_hdr, "/usr/lib64/libbar.so.3.0");
+
+    find_file_peers(before, after);
+
+    RI_ASSERT_PTR_NULL(lib->peer_file);
+
+    free_files(before);
+    free_files(after);
+}
+
+static Header new_header(const char *name, const char *arch)
+{
+    Header hdr = headerNew();
+
+    headerPutString(hdr, RPMTAG_NAME, name);
+    headerPutString(hdr, RPMTAG_VERSION, "1.0");
+    headerPutString(hdr, RPMTAG_RELEASE, "1");
+    headerPutString(hdr, RPMTAG_ARCH, arch);
+    return hdr;
+}
+
+static rpmpeer_entry_t *add_peer_entry(rpmpeer_t *peers, Header before, Header after)
+{
+    rpmpeer_entry_t *peer = NULL;
+
+    peer = calloc(1, sizeof(*peer));
+    assert(peer != NULL);
+    peer->before_hdr = before;
+    peer->after_hdr = after;
+    peer->before_files = new_files();
+    peer->after_files = new_files();
+    TAILQ_INSERT_TAIL(peers, peer, items);
+    return peer;
+}
+
+/* A regular file whose checksum is already known */
+static rpmfile_entry_t *add_data_file(rpmfile_t *files, Header hdr, const char *localpath, const char *sum)
+{
+    rpmfile_entry_t *file = add_file(files, hdr, localpath);
+
+    file->st.st_mode = S_IFREG | 0644;
+    file->st.st_size = 3;
+    file->checksum = strdup(sum);
+    return file;
+}
+
+void test_moved_files(void) {
+    struct rpminspect ri;
+    Header hdrs[4];
+    rpmpeer_entry_t *libs = NULL;
+    rpmpeer_entry_t *common = NULL;
+    rpmfile_entry_t *lib = NULL;
+    rpmfile_entry_t *data = NULL;
+    rpmfile_entry_t *renamed = NULL;
+    rpmfile_entry_t *gone = NULL;
+    rpmfile_entry_t *empty = NULL;
+    int i;
+
+    memset(&ri, 0, sizeof(ri));
+    ri.peers = init_rpmpeer();
+    hdrs[0] = new_header("foo-libs", "x86_64");
+    hdrs[1] = new_header("foo-libs", "x86_64");
+    hdrs[2] = new_header("foo-common", "noarch");
+    hdrs[3] = new_header("foo-common", "noarch");
+    libs = add_peer_entry(ri.peers, hdrs[0], hdrs[1]);
+    common = add_peer_entry(ri.peers, hdrs[2], hdrs[3]);
+
+    lib = add_data_file(libs->before_files, hdrs[0], "/usr/lib64/libfoo.so.1", "111");
+    data = add_data_file(libs->before_files, hdrs[0], "/usr/share/foo/data", "222");
+    renamed = add_data_file(libs->before_files, hdrs[0], "/usr/share/foo/old.txt", "333");
+    gone = add_data_file(libs->before_files, hdrs[0], "/usr/share/foo/gone", "444");
+    empty = add_file(libs->before_files, hdrs[0], "/usr/share/foo/empty");
+    empty->st.st_mode = S_IFREG | 0644;
+
+    add_data_file(libs->after_files, hdrs[1], "/usr/lib64/libfoo.so.1", "111");
+    add_data_file(common->after_files, hdrs[3], "/usr/share/foo/data", "999");
+    add_data_file(common->after_files, hdrs[3], "/usr/share/foo/new.txt", "333");
+    add_file(common->after_files, hdrs[3], "/usr/share/foo/also-empty")->st.st_mode = S_IFREG | 0644;
+
+    find_file_peers(libs->before_files, libs->after_files);
+    find_file_peers(common->before_files, common->after_files);
+    find_moved_files(&ri);
+
+    /* within the subpackage, by path across subpackages, by content across subpackages */
+    RI_ASSERT_TRUE(lib->peer_file->rpm_header == hdrs[1]);
+    RI_ASSERT_TRUE(data->peer_file != NULL && data->peer_file->rpm_header == hdrs[3]);
+    RI_ASSERT_STRING_EQUAL(peer_path(renamed), "/usr/share/foo/new.txt");
+    RI_ASSERT_PTR_NULL(gone->peer_file);
+
+    /* empty files all look the same, they are not matched by content */
+    RI_ASSERT_PTR_NULL(empty->peer_file);
+
+    free_rpmpeer(ri.peers);
+
+    for (i = 0; i < 4; i++) {
+        headerFree(hdrs[i]);
+    }
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("pairing", init_test_pairing, clean_test_pairing);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test pairing by path and version", test_pairing_paths) == NULL ||
+        CU_add_test(pSuite, "test exact matches come first", test_pairing_exact_first) == NULL ||
+        CU_add_test(pSuite, "test pairing renamed files", test_pairing_renames) == NULL ||
+        CU_add_test(pSuite, "test ambiguous renames", test_pairing_ambiguous) == NULL ||
+        CU_add_test(pSuite, "test files moved between subpackages", test_moved_files) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+static char outfile[] = "/tmp/test-results.XXXXXX";
+
+/* What a test sink saw */
+struct seen {
+    int count;
+    char msgs[4][32];
+    bool closed;
+};
+
+static void seen_add(results_sink_t *sink, const results_entry_t *result) {
+    struct seen *seen = sink->data;
+
+    if (seen->count < 4 && result->msg != NULL) {
+        snprintf(seen->msgs[seen->count], sizeof(seen->msgs[0]), "%s", result->msg);
+    }
+
+    seen->count++;
+}
+
+static void seen_close(results_sink_t *sink) {
+    struct seen *seen = sink->data;
+
+    seen->closed = true;
+}
+
+/* A sink counting results, read while other threads add to it */
+struct counted {
+    int count;
+    pthread_mutex_t lock;
+};
+
+static struct counted counted = { 0, PTHREAD_MUTEX_INITIALIZER };
+static bool streamed_early = false;
+
+static int counted_results(void) {
+    int count;
+
+    pthread_mutex_lock(&counted.lock);
+    count = counted.count;
+    pthread_mutex_unlock(&counted.lock);
+    return count;
+}
+
+static void counted_add(results_sink_t *sink, const results_entry_t *result) {
+    (void) sink;
+    (void) result;
+    pthread_mutex_lock(&counted.lock);
+    counted.count++;
+    pthread_mutex_unlock(&counted.lock);
+}
+
+static void counted_close(results_sink_t *sink) {
+    (void) sink;
+}
+
+/*
+ * The first file reports right away, the last one waits (up to ten
+ * seconds) for that result to reach the sink before it reports.
+ */
+static bool check_file(struct rpminspect *ri, rpmfile_entry_t *file) {
+    const struct timespec pause = { 0, 1000000 };
+    int i;
+
+    if (!strcmp(file->localpath, "/last")) {
+        for (i = 0; i < 10000 && counted_results() == 0; i++) {
+            nanosleep(&pause, NULL);
+        }
+
+        streamed_early = (counted_results() == 1);
+    }
+
+    add_result(ri, RESULT_INFO, NOT_WAIVABLE, "inspection", file->localpath, NULL, NULL);
+    return true;
+}
+
+int init_test_results(void) {
+    int fd = mkstemp(outfile);
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
+
+int clean_test_results(void) {
+    unlink(outfile);
+    return 0;
+}
+
+void test_results_sink(void) {
+    struct rpminspect ri;
+    struct seen seen;
+    results_sink_t sink;
+    results_t *list = NULL;
+    results_t *prev = NULL;
+    char msg[32];
+
+    memset(&ri, 0, sizeof(ri));
+    memset(&seen, 0, sizeof(seen));
+    sink.add = seen_add;
+    sink.close = seen_close;
+    sink.data = &seen;
+    ri.results_sink = &sink;
+
+    /* results go straight to the sink */
+    strcpy(msg, "first");
+    add_result(&ri, RESULT_INFO, NOT_WAIVABLE, "inspection", msg, NULL, NULL);
+    RI_ASSERT_EQUAL(seen.count, 1);
+    RI_ASSERT_STRING_EQUAL(seen.msgs[0], "first");
+    RI_ASSERT_PTR_NULL(ri.results);
+
+    /* results kept by a thread reach the sink when they are merged */
+    list = init_results();
+    prev = set_thread_results(list);
+    add_result(&ri, RESULT_BAD, WAIVABLE_BY_ANYONE, "inspection", "second", NULL, NULL);
+    add_result(&ri, RESULT_VERIFY, WAIVABLE_BY_ANYONE, "inspection", "third", NULL, NULL);
+    set_thread_results(prev);
+    RI_ASSERT_EQUAL(seen.count, 1);
+    RI_ASSERT_EQUAL(ri.worst_result, RESULT_INFO);
+
+    merge_results(&ri, list);
+    RI_ASSERT_EQUAL(seen.count, 3);
+    RI_ASSERT_STRING_EQUAL(seen.msgs[1], "second");
+    RI_ASSERT_STRING_EQUAL(seen.msgs[2], "third");
+    RI_ASSERT_PTR_NULL(ri.results);
+
+    /* the exit code still sees the worst result */
+    RI_ASSERT_EQUAL(ri.worst_result, RESULT_BAD);
+
+    close_results_sink(&ri);
+    RI_ASSERT_TRUE(seen.closed);
+    RI_ASSERT_PTR_NULL(ri.results_sink);
+}
+
+void test_results_parallel(void) {
+    struct rpminspect ri;
+    results_sink_t sink;
+    rpmpeer_entry_t *peer = NULL;
+    rpmfile_entry_t *file = NULL;
+
+    memset(&ri, 0, sizeof(ri));
+    sink.add = counted_add;
+    sink.close = counted_close;
+    sink.data = NULL;
+    ri.results_sink = &sink;
+    ri.jobs = 2;
+    ri.peers = init_rpmpeer();
+
+    peer = calloc(1, sizeof(*peer));
+    RI_ASSERT_PTR_NOT_NULL(peer);
+    peer->after_files = new_files();
+    TAILQ_INSERT_TAIL(ri.peers, peer, items);
+
+    file = new_file_entry(peer->after_files);
+    file->localpath = arena_strdup(peer->after_files->arena, "/first");
+    TAILQ_INSERT_TAIL(peer->after_files, file, items);
+    file = new_file_entry(peer->after_files);
+    file->localpath = arena_strdup(peer->after_files->arena, "/last");
+    TAILQ_INSERT_TAIL(peer->after_files, file, items);
+
+    /* the first file's result is passed on before the last file is done */
+    RI_ASSERT_TRUE(foreach_peer_file_parallel(&ri, check_file));
+    RI_ASSERT_TRUE(streamed_early);
+    RI_ASSERT_EQUAL(counted_results(), 2);
+    RI_ASSERT_PTR_NULL(ri.results);
+
+    close_results_sink(&ri);
+    free_rpmpeer(ri.peers);
+}
+
+void test_results_jsonl(void) {
+    struct rpminspect ri;
+    FILE *fp = NULL;
+    char line[BUFSIZ];
+    int lines = 0;
+
+    memset(&ri, 0, sizeof(ri));
+    ri.results_sink = jsonl_sink(outfile);
+    RI_ASSERT_PTR_NOT_NULL(ri.results_sink);
+
+    add_result(&ri, RESULT_OK, NOT_WAIVABLE, "emptyrpm", NULL, NULL, NULL);
+    add_result(&ri, RESULT_BAD, WAIVABLE_BY_ANYONE, "license", "Bad \"license\"", "line one\nline two", NULL);
+    close_results_sink(&ri);
+
+    fp = fopen(outfile, "r");
+    RI_ASSERT_PTR_NOT_NULL(fp);
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        lines++;
+
+        if (lines == 1) {
+            RI_ASSERT_PTR_NOT_NULL(strstr(line, "\"inspection\":\"emptyrpm\""));
+            RI_ASSERT_PTR_NULL(strstr(line, "message"));
+        } else if (lines == 2) {
+            RI_ASSERT_PTR_NOT_NULL(strstr(line, "\"message\":\"Bad \\\"license\\\"\""));
+            RI_ASSERT_PTR_NOT_NULL(strstr(line, "\"screendump\":\"line one\\nline two\""));
+        }
+    }
+
+    fclose(fp);
+
+    /* one line per result, newlines inside a result are escaped */
+    RI_ASSERT_EQUAL(lines, 2);
+    RI_ASSERT_EQUAL(ri.worst_result, RESULT_BAD);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("results", init_test_results, clean_test_results);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test streaming results to a sink", test_results_sink) == NULL ||
+        CU_add_test(pSuite, "test results streamed from parallel checks", test_results_parallel) == NULL ||
+        CU_add_test(pSuite, "test JSON Lines output", test_results_jsonl) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
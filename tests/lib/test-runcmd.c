@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+int init_test_runcmd(void) {
+    return 0;
+}
+
+int clean_test_runcmd(void) {
+    set_cmd_timeout(CMD_TIMEOUT);
+    return 0;
+}
+
+void test_run_cmd_output(void) {
+    int exitcode = -1;
+    char *output = NULL;
+
+    /* arguments are passed as-is, no shell is involved */
+    output = run_cmd(&exitcode, "echo", "a  b", ">", "/dev/null", NULL);
+    RI_ASSERT_EQUAL(exitcode, 0);
+    RI_ASSERT_PTR_NOT_NULL(output);
+    RI_ASSERT_STRING_EQUAL(output, "a  b > /dev/null");
+    free(output);
+
+    /* the command may carry options */
+    output = run_cmd(&exitcode, "printf %s", "x", NULL);
+    RI_ASSERT_STRING_EQUAL(output, "x");
+    free(output);
+
+    /* no output */
+    output = run_cmd(&exitcode, "true", NULL);
+    RI_ASSERT_EQUAL(exitcode, 0);
+    RI_ASSERT_PTR_NULL(output);
+}
+
+void test_run_cmd_exitcode(void) {
+    int exitcode = -1;
+    char *output = NULL;
+
+    output = run_cmd(&exitcode, "false", NULL);
+    RI_ASSERT_EQUAL(exitcode, 1);
+    free(output);
+
+    /* standard error is captured too */
+    output = run_cmd(&exitcode, "sh", "-c", "echo oops >&2; exit 3", NULL);
+    RI_ASSERT_EQUAL(exitcode, 3);
+    RI_ASSERT_STRING_EQUAL(output, "oops");
+    free(output);
+
+    output = run_cmd(&exitcode, "rpminspect-no-such-command", NULL);
+    RI_ASSERT_EQUAL(exitcode, -1);
+    RI_ASSERT_PTR_NULL(output);
+}
+
+void test_run_cmd_large_output(void) {
+    int exitcode = -1;
+    char *output = NULL;
+
+    output = run_cmd(&exitcode, "seq", "1", "100000", NULL);
+    RI_ASSERT_EQUAL(exitcode, 0);
+    RI_ASSERT_PTR_NOT_NULL(output);
+    RI_ASSERT_EQUAL(strlen(output), 588894);
+    RI_ASSERT_TRUE(strsuffix(output, "\n100000"));
+    free(output);
+}
+
+void test_run_cmd_timeout(void) {
+    int exitcode = -1;
+    char *output = NULL;
+    time_t start;
+
+    set_cmd_timeout(1);
+    start = time(NULL);
+    output = run_cmd(&exitcode, "sleep", "30", NULL);
+    RI_ASSERT_TRUE(time(NULL) - start < 10);
+    RI_ASSERT_EQUAL(exitcode, 128 + SIGKILL);
+    RI_ASSERT_PTR_NULL(output);
+
+    /* the timeout still applies after the command closes its output */
+    start = time(NULL);
+    output = run_cmd(&exitcode, "sh", "-c", "echo closing; exec >&- 2>&-; sleep 30", NULL);
+    RI_ASSERT_TRUE(time(NULL) - start < 10);
+    RI_ASSERT_EQUAL(exitcode, 128 + SIGKILL);
+    RI_ASSERT_STRING_EQUAL(output, "closing");
+    free(output);
+    set_cmd_timeout(CMD_TIMEOUT);
+}
+
+void test_run_cmds(void) {
+    runcmd_t cmds[3];
+    time_t start;
+    size_t i;
+
+    memset(cmds, 0, sizeof(cmds));
+    cmds[0].argv = build_argv("sh", "-c", "sleep 2; echo first", NULL);
+    cmds[1].argv = build_argv("sh", "-c", "sleep 2; echo second; exit 4", NULL);
+    cmds[2].argv = build_argv("sh", "-c", "sleep 2; echo third", NULL);
+
+    /* the commands run concurrently, not one after the other */
+    start = time(NULL);
+    run_cmds(cmds, 3);
+    RI_ASSERT_TRUE(time(NULL) - start < 5);
+
+    RI_ASSERT_STRING_EQUAL(cmds[0].output, "first");
+    RI_ASSERT_EQUAL(cmds[0].exitcode, 0);
+    RI_ASSERT_STRING_EQUAL(cmds[1].output, "second");
+    RI_ASSERT_EQUAL(cmds[1].exitcode, 4);
+    RI_ASSERT_STRING_EQUAL(cmds[2].output, "third");
+    RI_ASSERT_EQUAL(cmds[2].exitcode, 0);
+
+    for (i = 0; i < 3; i++) {
+        free_argv(cmds[i].argv);
+        free(cmds[i].output);
+    }
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("runcmd", init_test_runcmd, clean_test_runcmd);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test run_cmd() output", test_run_cmd_output) == NULL ||
+        CU_add_test(pSuite, "test run_cmd() exit codes", test_run_cmd_exitcode) == NULL ||
+        CU_add_test(pSuite, "test run_cmd() large output", test_run_cmd_large_output) == NULL ||
+        CU_add_test(pSuite, "test run_cmd() timeout", test_run_cmd_timeout) == NULL ||
+        CU_add_test(pSuite, "test run_cmds()", test_run_cmds) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+#define NSYMBOLS 5000
+
+int init_test_symset(void) {
+    return 0;
+}
+
+int clean_test_symset(void) {
+    return 0;
+}
+
+static symset_t *make_set(const char *names)
+{
+    string_list_t *list = NULL;
+    symset_t *set = NULL;
+    char *copy = strdup(names);
+    char *name = NULL;
+    string_entry_t *entry = NULL;
+
+    list = calloc(1, sizeof(*list));
+    TAILQ_INIT(list);
+
+    for (name = strtok(copy, " "); name != NULL; name = strtok(NULL, " ")) {
+        entry = calloc(1, sizeof(*entry));
+        entry->data = name;
+        TAILQ_INSERT_TAIL(list, entry, items);
+    }
+
+    set = symset_from_list(list);
+    list_free(list, NULL);
+    free(copy);
+    return set;
+}
+
+/* Return the names in a set joined by spaces */
+static char *set_string(const symset_t *set)
+{
+    string_list_t *names = symset_names(set);
+    string_entry_t *entry = NULL;
+    char *s = strdup("");
+    char *tmp = NULL;
+
+    TAILQ_FOREACH(entry, names, items) {
+        xasprintf(&tmp, "%s%s%s", s, (*s == '\0') ? "" : " ", entry->data);
+        free(s);
+        s = tmp;
+    }
+
+    list_free(names, NULL);
+    return s;
+}
+
+#define RI_ASSERT_SET(set, expected)                     \
+    do {                                                 \
+        char *_s = set_string(set);                      \
+        RI_ASSERT_STRING_EQUAL(_s, expected);            \
+        free(_s);                                        \
+    } while (0)
+
+void test_symset_contains(void) {
+    symset_t *set = NULL;
+
+    set = make_set("strcpy memcpy printf memcpy");
+    RI_ASSERT_EQUAL(symset_count(set), 3);
+    RI_ASSERT_TRUE(symset_contains(set, "memcpy"));
+    RI_ASSERT_TRUE(symset_contains(set, "printf"));
+    RI_ASSERT_FALSE(symset_contains(set, "sprintf"));
+    RI_ASSERT_FALSE(symset_contains(set, "not a symbol anywhere"));
+    RI_ASSERT_FALSE(symset_contains(NULL, "memcpy"));
+
+    /* names come back in alphabetical order, without duplicates */
+    RI_ASSERT_SET(set, "memcpy printf strcpy");
+    symset_free(set);
+
+    /* an empty set */
+    set = symset_new(NULL, 0);
+    RI_ASSERT_EQUAL(symset_count(set), 0);
+    RI_ASSERT_FALSE(symset_contains(set, "memcpy"));
+    RI_ASSERT_SET(set, "");
+    symset_free(set);
+}
+
+void test_symset_operations(void) {
+    symset_t *before = NULL;
+    symset_t *after = NULL;
+    symset_t *result = NULL;
+
+    before = make_set("gethostbyname inet_addr memcpy __memcpy_chk strcpy");
+    after = make_set("getaddrinfo memcpy strcpy __strcpy_chk");
+
+    result = symset_intersection(before, after);
+    RI_ASSERT_SET(result, "memcpy strcpy");
+    symset_free(result);
+
+    result = symset_difference(before, after);
+    RI_ASSERT_SET(result, "__memcpy_chk gethostbyname inet_addr");
+    symset_free(result);
+
+    result = symset_difference(after, before);
+    RI_ASSERT_SET(result, "__strcpy_chk getaddrinfo");
+    symset_free(result);
+
+    /* with nothing on one side */
+    result = symset_intersection(before, NULL);
+    RI_ASSERT_EQUAL(symset_count(result), 0);
+    symset_free(result);
+
+    result = symset_difference(before, NULL);
+    RI_ASSERT_EQUAL(symset_count(result), 5);
+    symset_free(result);
+
+    symset_free(before);
+    symset_free(after);
+}
+
+static bool is_chk(const char *symbol)
+{
+    return strsuffix(symbol, "_chk");
+}
+
+void test_symset_filter(void) {
+    symset_t *set = NULL;
+    symset_t *result = NULL;
+
+    set = make_set("memcpy __memcpy_chk strcpy __strcpy_chk");
+    result = symset_filter(set, is_chk);
+    RI_ASSERT_SET(result, "__memcpy_chk __strcpy_chk");
+    symset_free(result);
+    symset_free(set);
+}
+
+void test_symset_large(void) {
+    char **names = NULL;
+    const char **even_names = NULL;
+    symset_t *all = NULL;
+    symset_t *even = NULL;
+    symset_t *result = NULL;
+    char *name = NULL;
+    unsigned int i;
+    int bad = 0;
+
+    /* the sets use these names, they are freed last */
+    names = calloc(NSYMBOLS, sizeof(*names));
+    even_names = calloc(NSYMBOLS / 2, sizeof(*even_names));
+
+    for (i = 0; i < NSYMBOLS; i++) {
+        xasprintf(&names[i], "symbol%u", i);
+
+        if (i % 2 == 0) {
+            even_names[i / 2] = names[i];
+        }
+    }
+
+    all = symset_new((const char **) names, NSYMBOLS);
+    even = symset_new(even_names, NSYMBOLS / 2);
+    RI_ASSERT_EQUAL(symset_count(all), NSYMBOLS);
+    RI_ASSERT_EQUAL(symset_count(even), NSYMBOLS / 2);
+
+    /* looked up with copies of the names, not the same pointers */
+    for (i = 0; i < NSYMBOLS * 2; i++) {
+        xasprintf(&name, "symbol%u", i);
+
+        if (symset_contains(even, name) != (i < NSYMBOLS && i % 2 == 0)) {
+            bad++;
+        }
+
+        free(name);
+    }
+
+    RI_ASSERT_EQUAL(bad, 0);
+
+    result = symset_intersection(all, even);
+    RI_ASSERT_EQUAL(symset_count(result), NSYMBOLS / 2);
+    symset_free(result);
+
+    result = symset_difference(all, even);
+    RI_ASSERT_EQUAL(symset_count(result), NSYMBOLS / 2);
+    RI_ASSERT_TRUE(symset_contains(result, "symbol1"));
+    RI_ASSERT_FALSE(symset_contains(result, "symbol0"));
+    symset_free(result);
+
+    symset_free(all);
+    symset_free(even);
+
+    for (i = 0; i < NSYMBOLS; i++) {
+        free(names[i]);
+    }
+
+    free(names);
+    free(even_names);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("symset", init_test_symset, clean_test_symset);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test symset_contains()", test_symset_contains) == NULL ||
+        CU_add_test(pSuite, "test set intersection and difference", test_symset_operations) == NULL ||
+        CU_add_test(pSuite, "test symset_filter()", test_symset_filter) == NULL ||
+        CU_add_test(pSuite, "test large sets", test_symset_large) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
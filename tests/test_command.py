@@ -42,3 +42,13 @@ class RpminspectSegv(RequiresRpminspect):
         p = subprocess.Popen([self.rpminspect, '42'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
         p.communicate()
         self.assertNotEqual(p.returncode, 139)
+
+# Verify --jobs rejects values that are not a positive number
+class RpminspectBadJobs(RequiresRpminspect):
+    def runTest(self):
+        RequiresRpminspect.configFile(self)
+
+        for jobs in ['0', '-4', 'lots', '']:
+            p = subprocess.Popen([self.rpminspect, '-c', self.conffile, '--jobs=' + jobs, '42'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+            p.communicate()
+            self.assertEqual(p.returncode, 2)
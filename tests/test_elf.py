@@ -17,6 +17,9 @@
 #
 
 import os
+import subprocess
+import tempfile
+import unittest
 from baseclass import *
 
 datadir = os.environ['RPMINSPECT_TEST_DATA_PATH']
@@ -27,6 +30,23 @@ fortify_src = open(datadir + '/fortify.c').read()
 # Source code used for the forbidden IPv6 function tests
 forbidden_ipv6_src = open(datadir + '/forbidden-ipv6.c').read()
 
+# The -fPIC and TEXTREL tests build 32-bit code, which needs multilib gcc
+def have_gcc_m32():
+    with tempfile.TemporaryDirectory() as tmpdir:
+        src = os.path.join(tmpdir, 'm32.c')
+
+        with open(src, 'w') as f:
+            f.write('int main(void) { return 0; }\n')
+
+        try:
+            return subprocess.call(['gcc', '-m32', '-o', os.path.join(tmpdir, 'm32'), src],
+                                   stdout=subprocess.DEVNULL,
+                                   stderr=subprocess.DEVNULL) == 0
+        except OSError:
+            return False
+
+needs_m32 = unittest.skipUnless(have_gcc_m32(), 'gcc -m32 is not available')
+
 # Program built with noexecstack
 class WithoutExecStackRPM(TestRPMs):
     def setUp(self):
@@ -216,6 +236,7 @@ class ForbiddenIPv6FunctionCompareKoji(TestCompareKoji):
         self.result = 'VERIFY'
 
 # Program lost -fPIC in after (BAD, WAIVABLE_BY_SECURITY)
+@needs_m32
 class LostPICCompareRPMs(TestCompareRPMs):
     def setUp(self):
         TestCompareRPMs.setUp(self)
@@ -245,6 +266,7 @@ class LostPICCompareRPMs(TestCompareRPMs):
         self.waiver_auth = 'Security'
         self.result = 'BAD'
 
+@needs_m32
 class LostPICCompareKoji(TestCompareKoji):
     def setUp(self):
         TestCompareKoji.setUp(self)
@@ -274,7 +296,101 @@ class LostPICCompareKoji(TestCompareKoji):
         self.waiver_auth = 'Security'
         self.result = 'BAD'
 
+# Add a static library of copies of the simple library object, each
+# object given as a (name, compile flags) pair
+def add_archive(rpm, objects):
+    installPath = "usr/lib/libsimple.a"
+
+    rpm.add_source(rpmfluff.SourceFile('simple.c', rpmfluff.simple_library_source))
+
+    for (obj, flags) in objects:
+        rpm.section_build += "gcc -m32 %s -c simple.c -o %s\n" % (flags, obj)
+
+    rpm.section_build += "ar -crs libsimple.a %s\n" % " ".join([obj for (obj, flags) in objects])
+    rpm.create_parent_dirs(installPath)
+    rpm.section_install += "cp libsimple.a $RPM_BUILD_ROOT/%s\n" % installPath
+    sub = rpm.get_subpackage(None)
+    sub.section_files += "/%s\n" % installPath
+    rpm.add_payload_check(installPath, None)
+
+# Static library built with -fPIC before and after
+@needs_m32
+class KeptPICCompareRPMs(TestCompareRPMs):
+    def setUp(self):
+        TestCompareRPMs.setUp(self)
+        add_archive(self.before_rpm, [('simple.o', '-fPIC')])
+        add_archive(self.after_rpm, [('simple.o', '-fPIC')])
+        self.inspection = 'elf'
+        self.label = 'elf-object-properties'
+
+@needs_m32
+class KeptPICCompareKoji(TestCompareKoji):
+    def setUp(self):
+        TestCompareKoji.setUp(self)
+        add_archive(self.before_rpm, [('simple.o', '-fPIC')])
+        add_archive(self.after_rpm, [('simple.o', '-fPIC')])
+        self.inspection = 'elf'
+        self.label = 'elf-object-properties'
+
+# Static library object without -fPIC before and after
+@needs_m32
+class NeverPICCompareRPMs(TestCompareRPMs):
+    def setUp(self):
+        TestCompareRPMs.setUp(self)
+        add_archive(self.before_rpm, [('simple.o', '')])
+        add_archive(self.after_rpm, [('simple.o', '')])
+        self.inspection = 'elf'
+        self.label = 'elf-object-properties'
+
+@needs_m32
+class NeverPICCompareKoji(TestCompareKoji):
+    def setUp(self):
+        TestCompareKoji.setUp(self)
+        add_archive(self.before_rpm, [('simple.o', '')])
+        add_archive(self.after_rpm, [('simple.o', '')])
+        self.inspection = 'elf'
+        self.label = 'elf-object-properties'
+
+# One static library object lost -fPIC, the other never had it and
+# nothing is new, so only the lost -fPIC objects are listed
+@needs_m32
+class OnlyLostPICCompareRPMs(TestCompareRPMs):
+    def setUp(self):
+        TestCompareRPMs.setUp(self)
+        add_archive(self.before_rpm, [('a.o', '-fPIC'), ('b.o', '')])
+        add_archive(self.after_rpm, [('a.o', ''), ('b.o', '')])
+        self.inspection = 'elf'
+        self.label = 'elf-object-properties'
+        self.waiver_auth = 'Security'
+        self.result = 'BAD'
+
+    def runTest(self):
+        TestCompareRPMs.runTest(self)
+        screendump = self.results[self.label][0]['screendump']
+        self.assertIn('lost -fPIC:\n\ta.o\n', screendump)
+        self.assertNotIn('b.o', screendump)
+        self.assertNotIn('new objects', screendump)
+
+@needs_m32
+class OnlyLostPICCompareKoji(TestCompareKoji):
+    def setUp(self):
+        TestCompareKoji.setUp(self)
+        add_archive(self.before_rpm, [('a.o', '-fPIC'), ('b.o', '')])
+        add_archive(self.after_rpm, [('a.o', ''), ('b.o', '')])
+        self.inspection = 'elf'
+        self.label = 'elf-object-properties'
+        self.waiver_auth = 'Security'
+        self.result = 'BAD'
+
+    def runTest(self):
+        TestCompareKoji.runTest(self)
+        screendump = self.results[self.label][0]['screendump']
+        self.assertIn('lost -fPIC:\n\ta.o\n', screendump)
+        self.assertNotIn('b.o', screendump)
+        self.assertNotIn('new objects', screendump)
+
 # Program has or gained TEXTREL relocations (32-bit arches only)
+@needs_m32
 class HasTEXTRELRPMs(TestRPMs):
     def setUp(self):
         TestRPMs.setUp(self)
@@ -295,6 +411,7 @@ class HasTEXTRELRPMs(TestRPMs):
         self.waiver_auth = 'Security'
         self.result = 'BAD'
 
+@needs_m32
 class HasTEXTRELCompareRPMs(TestCompareRPMs):
     def setUp(self):
         TestCompareRPMs.setUp(self)
@@ -323,6 +440,7 @@ class HasTEXTRELCompareRPMs(TestCompareRPMs):
         self.waiver_auth = 'Security'
         self.result = 'BAD'
 
+@needs_m32
 class HasTEXTRELCompareKoji(TestCompareKoji):
     def setUp(self):
         TestCompareKoji.setUp(self)
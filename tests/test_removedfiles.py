@@ -0,0 +1,67 @@
+#
+# Copyright (C) 2020  Red Hat, Inc.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+from baseclass import *
+
+# Add a shared library built with the given SONAME to a package
+def add_library(rpm, filename, soname):
+    installPath = "usr/lib/%s" % filename
+
+    rpm.add_source(rpmfluff.SourceFile('simple.c', rpmfluff.simple_library_source))
+    rpm.section_build += "gcc -shared -fPIC -Wl,-soname,%s -o %s simple.c\n" % (soname, filename)
+    rpm.create_parent_dirs(installPath)
+    rpm.section_install += "cp %s $RPM_BUILD_ROOT/%s\n" % (filename, installPath)
+    sub = rpm.get_subpackage(None)
+    sub.section_files += "/%s\n" % installPath
+
+# Library renamed for a soname bump, the old SONAME is gone
+class SonameBumpCompareRPMs(TestCompareRPMs):
+    def setUp(self):
+        TestCompareRPMs.setUp(self)
+        add_library(self.before_rpm, 'libsimple.so.1', 'libsimple.so.1')
+        add_library(self.after_rpm, 'libsimple.so.2', 'libsimple.so.2')
+        self.inspection = 'removedfiles'
+        self.label = 'removed-files'
+        self.waiver_auth = 'Anyone'
+        self.result = 'BAD'
+
+class SonameBumpCompareKoji(TestCompareKoji):
+    def setUp(self):
+        TestCompareKoji.setUp(self)
+        add_library(self.before_rpm, 'libsimple.so.1', 'libsimple.so.1')
+        add_library(self.after_rpm, 'libsimple.so.2', 'libsimple.so.2')
+        self.inspection = 'removedfiles'
+        self.label = 'removed-files'
+        self.waiver_auth = 'Anyone'
+        self.result = 'BAD'
+
+# Library renamed for a new version with the same SONAME
+class LibraryRenamedCompareRPMs(TestCompareRPMs):
+    def setUp(self):
+        TestCompareRPMs.setUp(self)
+        add_library(self.before_rpm, 'libsimple.so.1.0', 'libsimple.so.1')
+        add_library(self.after_rpm, 'libsimple.so.1.1', 'libsimple.so.1')
+        self.inspection = 'removedfiles'
+        self.label = 'removed-files'
+
+class LibraryRenamedCompareKoji(TestCompareKoji):
+    def setUp(self):
+        TestCompareKoji.setUp(self)
+        add_library(self.before_rpm, 'libsimple.so.1.0', 'libsimple.so.1')
+        add_library(self.after_rpm, 'libsimple.so.1.1', 'libsimple.so.1')
+        self.inspection = 'removedfiles'
+        self.label = 'removed-files'
@@ -0,0 +1,52 @@
+#!/bin/sh
+#
+# Generate a fortify vendor data file from a C library.  The output
+# lists the functions that have a fortified __<function>_chk version,
+# one per line, and goes in VENDOR_DATA_DIR/fortify/<product release>.
+#
+# Usage: mkfortify.sh [path to libc.so.6]
+#
+# Copyright (C) 2020  Red Hat, Inc.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+PATH=/bin:/usr/bin
+
+LIBC="${1}"
+
+if [ -z "${LIBC}" ]; then
+    LIBC="$(ldd /bin/sh | awk '/libc\.so/ { print $3; }')"
+fi
+
+if [ ! -f "${LIBC}" ]; then
+    echo "*** Unable to find the C library, give its path as an argument" >&2
+    exit 1
+fi
+
+VERSION="$(${LIBC} 2>/dev/null | head -n 1)"
+
+echo "#"
+echo "# Functions with a fortified version in the C library.  Used by the"
+echo "# 'elf' inspection to spot objects that lost -D_FORTIFY_SOURCE."
+echo "# Blank lines and lines beginning with '#' are ignored."
+echo "#"
+echo "# Generated by utils/mkfortify.sh from:"
+echo "#     ${VERSION:-$(basename ${LIBC})}"
+echo "#"
+
+nm -D --defined-only "${LIBC}" | \
+    awk '{ print $NF; }' | \
+    sed -n -e 's/@.*$//' -e 's/^__\(.*\)_chk$/\1/p' | \
+    grep -v '^$' | sort -u